@@ -1,17 +1,38 @@
 #include <Arduino.h>
 
 #include "src/bus.h"
+#include "src/candump.h"
+#if defined(__linux__)
+#include "src/socketcan.h"
+#else
 #include "src/can.h"
+#endif
 #include "src/climate.h"
 #include "src/config.h"
 #include "src/debug.h"
+#include "src/diagnostics.h"
+#include "src/loop_monitor.h"
+#include "src/memory.h"
+#include "src/profiler.h"
 #include "src/realdash.h"
+#include "src/recorder.h"
 #include "src/serial.h"
 #include "src/settings.h"
+#include "src/slcan.h"
+#include "src/snapshot.h"
 #include "src/steering.h"
 
+#define LOG_MODULE LOG_SYSTEM
 
-class ControllerCan : public Same51Can {
+
+#if defined(__linux__)
+// Linux builds connect to SOCKETCAN_INTERFACE.
+typedef SocketCan CanNode;
+#else
+typedef Same51Can CanNode;
+#endif
+
+class ControllerCan : public CanNode {
     public:
         // Only send climate and settings frames over CAN.
         bool filter(uint32_t id) const override {
@@ -24,7 +45,10 @@ class ControllerRealDash : public RealDash {
     public:
         // Only send dashboard state frames to RealDash.
         bool filter(uint32_t id) const override {
-            return id == 0x5400 || id == 0x5700 || id == 0x5800;
+            return id == 0x5400 || id == 0x5700 || id == 0x5800 ||
+                   id == DIAGNOSTICS_FRAME_ID || id == DIAGNOSTICS_ID_FRAME_ID ||
+                   id == WATCHDOG_FRAME_ID || id == MEMORY_FRAME_ID ||
+                   (id & 0xFFFFFFF0) == DIAGNOSTICS_NODE_FRAME_ID;
         }
 };
 
@@ -32,8 +56,22 @@ ControllerCan can;
 Climate climate;
 ControllerRealDash realdash;
 Settings settings;
+Snapshot snapshot;
 SteeringKeypad steering_keypad;
+Diagnostics diagnostics;
+Recorder recorder;
+LoopMonitor loop_monitor;
+MemoryMonitor memory_monitor;
+#ifdef CAPTURE_ENABLE
+D(CandumpCapture serial_text);
+#else
 D(SerialText serial_text);
+#endif
+L(LogControl log_control(&debug_levels));
+P(Profiler profiler);
+#ifdef SLCAN_ENABLE
+Slcan slcan;
+#endif
 
 Bus* bus;
 Node* nodes[] = {
@@ -41,18 +79,96 @@ Node* nodes[] = {
     &climate,
     &realdash,
     &settings,
+    &snapshot,
     &steering_keypad,
-    D(&serial_text),
+    &diagnostics,
+    &recorder,
+    &loop_monitor,
+    &memory_monitor,
+#ifdef DEBUG_ENABLE
+    &serial_text,
+#endif
+#if defined(DEBUG_ENABLE) || defined(TRACE_ENABLE)
+    &log_control,
+#endif
+#ifdef PROFILE_ENABLE
+    &profiler,
+#endif
+#ifdef SLCAN_ENABLE
+    &slcan,
+#endif
+};
+
+// Static RAM of each node. Must match the order of nodes.
+const uint16_t node_sizes[] = {
+    sizeof(can),
+    sizeof(climate),
+    sizeof(realdash),
+    sizeof(settings),
+    sizeof(snapshot),
+    sizeof(steering_keypad),
+    sizeof(diagnostics),
+    sizeof(recorder),
+    sizeof(loop_monitor),
+    sizeof(memory_monitor),
+#ifdef DEBUG_ENABLE
+    sizeof(serial_text),
+#endif
+#if defined(DEBUG_ENABLE) || defined(TRACE_ENABLE)
+    sizeof(log_control),
+#endif
+#ifdef PROFILE_ENABLE
+    sizeof(profiler),
+#endif
+#ifdef SLCAN_ENABLE
+    sizeof(slcan),
+#endif
+};
+static_assert(sizeof(node_sizes)/sizeof(node_sizes[0]) == sizeof(nodes)/sizeof(nodes[0]),
+        "node_sizes must have an entry for each node");
+
+// The profiler is last so it excludes the overhead of the other monitors.
+BusMonitor* monitors[] = {
+    &diagnostics,
+    &recorder,
+    &loop_monitor,
+#ifdef PROFILE_ENABLE
+    &profiler,
+#endif
 };
+MultiMonitor bus_monitor(monitors, sizeof(monitors)/sizeof(monitors[0]));
+
+void setup_memory() {
+    // Paint free RAM before setup uses the stack. Debug builds write the
+    // memory report to the debug serial through SerialText.
+    memory_monitor.begin(D(serial_text.text()));
+    memory_monitor.nodeSizes(node_sizes, sizeof(node_sizes)/sizeof(node_sizes[0]));
+    diagnostics.nodeSizes(node_sizes);
+}
 
 void setup_debug() {
     DEBUG_BEGIN();
-    serial_text.begin(&DEBUG_SERIAL);
-    #ifdef DEBUG_WAIT_FOR_SERIAL
+    D(serial_text.begin(&DEBUG_SERIAL));
+    P(profiler.begin(serial_text.text()));
+    #if defined(DEBUG_WAIT_FOR_SERIAL) && (defined(DEBUG_ENABLE) || defined(TRACE_ENABLE))
     WAIT_FOR_SERIAL(DEBUG_SERIAL, 100, nullptr);
     #endif
 }
 
+void setup_recorder() {
+    INFO_MSG("setup: recovering flight recorder");
+    // debug builds write the recording to the debug serial through SerialText
+    recorder.begin(D(serial_text.text()));
+}
+
+void setup_slcan() {
+    #ifdef SLCAN_ENABLE
+    INFO_MSG("setup: starting slcan");
+    SLCAN_SERIAL.begin(SLCAN_BAUDRATE);
+    slcan.begin(&SLCAN_SERIAL);
+    #endif
+}
+
 void setup_realdash() {
     INFO_MSG("setup: connecting to realdash");
     REALDASH_SERIAL.begin(REALDASH_BAUDRATE);
@@ -62,24 +178,56 @@ void setup_realdash() {
     realdash.begin(&REALDASH_SERIAL);
 }
 
+void setup_watchdog() {
+    // Started after any optional waits for serial connections. Blocking
+    // setup after this point is limited by the watchdog.
+    INFO_MSG("setup: starting watchdog");
+    loop_monitor.begin();
+}
+
 void setup_can() {
     INFO_MSG("setup: connecting to can bus");
     can.begin();
 }
 
+void setup_snapshot() {
+    INFO_MSG("setup: restoring state snapshot");
+    snapshot.begin();
+}
+
+void setup_climate() {
+    INFO_MSG("setup: attaching climate outputs");
+    climate.begin();
+}
+
+void setup_steering() {
+    INFO_MSG("setup: sampling steering keypad");
+    steering_keypad.begin();
+}
+
 void setup_bus() {
     INFO_MSG("setup: initializing bus");
-    bus = new Bus(nodes, sizeof(nodes)/sizeof(nodes[0]));
+    bus = new Bus(nodes, sizeof(nodes)/sizeof(nodes[0]), TimerWheel::real(), &bus_monitor);
 }
 
 void setup() {
-    D(setup_debug());
+    setup_memory();
+    setup_debug();
+    setup_recorder();
     setup_realdash();
+    setup_slcan();
+    setup_watchdog();
     setup_can();
+    setup_snapshot();
+    setup_climate();
+    setup_steering();
     setup_bus();
     INFO_MSG("setup: ecu started");
+    // The main loop drains the log from here on.
+    DEBUG_ASYNC();
 }
 
 void loop() {
     bus->loop();
+    DEBUG_DRAIN();
 }
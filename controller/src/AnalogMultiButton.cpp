@@ -56,14 +56,18 @@ AnalogMultiButton::AnalogMultiButton(int pin, int total, const int values[],
 }
 
 void AnalogMultiButton::update()
+{
+  update(gpio->analogRead(pin));
+}
+
+void AnalogMultiButton::update(int value)
 {
   buttonOnPress = -1;
   buttonOnRelease = -1;
   lastUpdateTime = thisUpdateTime;
   thisUpdateTime = clock->millis();
   
-  int a = gpio->analogRead(pin);
-  int button = getButtonForAnalogValue(a);
+  int button = getButtonForAnalogValue(value);
   if(debounceButton(button) && button != buttonPressed) 
   {
     releasedButtonPressTime = buttonPressTime;
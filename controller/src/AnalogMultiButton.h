@@ -64,7 +64,8 @@ class AnalogMultiButton
     int getPressDuration(); // gets the duration that the current button has been pressed for, in milliseconds
     int getLastReleasePressDuration() { return millis() - releasedButtonPressTime; } // gets the duration that the last released button was pressed for, in milliseconds
     
-    void update();
+    void update(); // reads the analog pin and updates the button state
+    void update(int value); // updates the button state from a value sampled elsewhere
     
   private:
     int pin;
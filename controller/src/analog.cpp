@@ -0,0 +1,120 @@
+#include "analog.h"
+
+#include "debug.h"
+#include "gpio.h"
+
+#define LOG_MODULE LOG_STEERING
+
+
+#if defined(__SAMD51__)
+
+#include <wiring_private.h>
+
+// Samples pins round-robin on ADC0. Each conversion averages 16 samples in
+// hardware and the result ready interrupt stores the value and starts the
+// next pin. With a 48MHz ADC clock divided by 256 each averaged conversion
+// takes roughly 7ms so every pin is refreshed at a fixed rate without any
+// work in the main loop.
+class Same51AnalogSampler : public AnalogSampler {
+    public:
+        Same51AnalogSampler() : count_(0), current_(0) {
+            for (uint8_t i = 0; i < kMaxPins; i++) {
+                values_[i] = kFullScale;
+            }
+        }
+
+        bool begin(const uint32_t* pins, uint8_t count) override {
+            if (count_ + count > kMaxPins) {
+                ERROR_MSG("analog: too many pins");
+                return false;
+            }
+            bool start = count_ == 0;
+            for (uint8_t i = 0; i < count; i++) {
+                pinPeripheral(pins[i], PIO_ANALOG);
+                pins_[count_] = pins[i];
+                channels_[count_] = g_APinDescription[pins[i]].ulADCChannelNumber;
+                ++count_;
+            }
+            if (start) {
+                configure();
+            }
+            return true;
+        }
+
+        uint16_t read(uint32_t pin) override {
+            for (uint8_t i = 0; i < count_; i++) {
+                if (pins_[i] == pin) {
+                    return values_[i];
+                }
+            }
+            return kFullScale;
+        }
+
+        // Store the completed conversion and start the next pin. Called from
+        // the ADC result ready interrupt.
+        void handleResult() {
+            // 12-bit averaged result scaled to 10 bits
+            values_[current_] = ADC0->RESULT.reg >> 2;
+            if (++current_ >= count_) {
+                current_ = 0;
+            }
+            ADC0->INPUTCTRL.bit.MUXPOS = channels_[current_];
+            while (ADC0->SYNCBUSY.bit.INPUTCTRL);
+            ADC0->SWTRIG.bit.START = 1;
+        }
+
+    private:
+        uint32_t pins_[kMaxPins];
+        uint8_t channels_[kMaxPins];
+        volatile uint16_t values_[kMaxPins];
+        uint8_t count_;
+        volatile uint8_t current_;
+
+        void configure() {
+            ADC0->CTRLA.bit.ENABLE = 0;
+            while (ADC0->SYNCBUSY.bit.ENABLE);
+
+            ADC0->CTRLA.bit.PRESCALER = ADC_CTRLA_PRESCALER_DIV256_Val;
+            ADC0->REFCTRL.bit.REFSEL = ADC_REFCTRL_REFSEL_INTVCC1_Val;
+            ADC0->CTRLB.bit.RESSEL = ADC_CTRLB_RESSEL_16BIT_Val;
+            ADC0->AVGCTRL.reg = ADC_AVGCTRL_SAMPLENUM_16 | ADC_AVGCTRL_ADJRES(4);
+            ADC0->SAMPCTRL.bit.SAMPLEN = 63;
+            ADC0->INPUTCTRL.reg = ADC_INPUTCTRL_MUXNEG_GND | ADC_INPUTCTRL_MUXPOS(channels_[0]);
+            while (ADC0->SYNCBUSY.reg);
+
+            current_ = 0;
+            ADC0->INTENSET.bit.RESRDY = 1;
+            NVIC_SetPriority(ADC0_1_IRQn, 3);
+            NVIC_EnableIRQ(ADC0_1_IRQn);
+
+            ADC0->CTRLA.bit.ENABLE = 1;
+            while (ADC0->SYNCBUSY.bit.ENABLE);
+            ADC0->SWTRIG.bit.START = 1;
+        }
+};
+
+Same51AnalogSampler real_analog;
+
+void ADC0_1_Handler() {
+    real_analog.handleResult();
+}
+
+#else
+
+// Fallback for other boards. Reads block on analogRead.
+class BlockingAnalogSampler : public AnalogSampler {
+    public:
+        bool begin(const uint32_t*, uint8_t) override { return true; }
+
+        uint16_t read(uint32_t pin) override {
+            return GPIO::real()->analogRead(pin);
+        }
+};
+
+BlockingAnalogSampler real_analog;
+
+#endif  // __SAMD51__
+
+AnalogSampler* AnalogSampler::real() {
+    return &real_analog;
+}
@@ -0,0 +1,36 @@
+#ifndef __R51_ANALOG__
+#define __R51_ANALOG__
+
+#include <Arduino.h>
+
+
+// Base background analog sampler interface. Allows analog sampling to be
+// mocked. The real implementation on the SAME51 converts the registered pins
+// in the background with the ADC and reads return the latest filtered value
+// without blocking. Other boards fall back to a blocking analogRead.
+//
+// Values are 10-bit to match the default Arduino analog resolution.
+class AnalogSampler {
+    public:
+        // The maximum number of pins which may be sampled.
+        static const uint8_t kMaxPins = 4;
+
+        // The value returned for pins which have not been sampled yet.
+        static const uint16_t kFullScale = 1023;
+
+        // Return the real sampler.
+        static AnalogSampler* real();
+
+        AnalogSampler() = default;
+        virtual ~AnalogSampler() = default;
+
+        // Start sampling the given analog pins in the background. Pins are
+        // added to any previously registered pins. Return false if there is
+        // no room for all of the pins.
+        virtual bool begin(const uint32_t* pins, uint8_t count) = 0;
+
+        // Return the latest sampled value for a pin.
+        virtual uint16_t read(uint32_t pin) = 0;
+};
+
+#endif  // __R51_ANALOG__
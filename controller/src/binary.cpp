@@ -32,3 +32,18 @@ bool setBitXor(byte* b, uint8_t offset, uint8_t bit, bool value) {
 bool toggleBit(byte* b, uint8_t offset, uint8_t bit) {
     return b[offset] ^= (1 << bit);
 }
+
+void setLE16(byte* b, uint32_t value) {
+  if (value > 0xFFFF) {
+    value = 0xFFFF;
+  }
+  b[0] = value;
+  b[1] = value >> 8;
+}
+
+void setLE32(byte* b, uint32_t value) {
+  b[0] = value;
+  b[1] = value >> 8;
+  b[2] = value >> 16;
+  b[3] = value >> 24;
+}
@@ -20,5 +20,12 @@ bool setBitXor(byte* b, uint8_t offset, uint8_t bit, bool value);
 // Toggle a bit in a byte array. Return the resulting bit.
 bool toggleBit(byte* b, uint8_t offset, uint8_t bit);
 
+// Write a 16-bit little endian value to a byte array. Values over 0xFFFF are
+// written as 0xFFFF.
+void setLE16(byte* b, uint32_t value);
+
+// Write a 32-bit little endian value to a byte array.
+void setLE32(byte* b, uint32_t value);
+
 
 #endif  // __R51_BINARY_H__
@@ -15,16 +15,98 @@ void copyFrame(Frame* dest, const Frame& src) {
     memcpy(dest, &src, sizeof(Frame));
 }
 
+void MultiMonitor::attach(Node** nodes, uint8_t count) {
+    for (uint8_t i = 0; i < count_; i++) {
+        monitors_[i]->attach(nodes, count);
+    }
+}
+
+void MultiMonitor::loopStart() {
+    for (uint8_t i = 0; i < count_; i++) {
+        monitors_[i]->loopStart();
+    }
+}
+
+void MultiMonitor::loopEnd() {
+    for (uint8_t i = count_; i > 0; i--) {
+        monitors_[i - 1]->loopEnd();
+    }
+}
+
+void MultiMonitor::receiveStart(uint8_t node) {
+    for (uint8_t i = 0; i < count_; i++) {
+        monitors_[i]->receiveStart(node);
+    }
+}
+
+void MultiMonitor::receiveEnd(uint8_t node) {
+    for (uint8_t i = count_; i > 0; i--) {
+        monitors_[i - 1]->receiveEnd(node);
+    }
+}
+
+void MultiMonitor::broadcast(uint8_t source, const Frame& frame) {
+    for (uint8_t i = 0; i < count_; i++) {
+        monitors_[i]->broadcast(source, frame);
+    }
+}
+
+void MultiMonitor::sendStart(uint8_t node, const Frame& frame) {
+    for (uint8_t i = 0; i < count_; i++) {
+        monitors_[i]->sendStart(node, frame);
+    }
+}
+
+void MultiMonitor::sendEnd(uint8_t node) {
+    for (uint8_t i = count_; i > 0; i--) {
+        monitors_[i - 1]->sendEnd(node);
+    }
+}
+
+Bus::Bus(Node** nodes, uint8_t count, TimerWheel* timers, BusMonitor* monitor) :
+        nodes_(nodes), count_(count), timers_(timers), monitor_(monitor),
+        source_(0), broadcast_(this) {
+    if (monitor_ != nullptr) {
+        monitor_->attach(nodes_, count_);
+    }
+}
+
 void Bus::loop() {
+    timers_->update();
+    if (monitor_ == nullptr) {
+        for (uint8_t i = 0; i < count_; i++) {
+            nodes_[i]->receive(broadcast_);
+        }
+        return;
+    }
+
+    monitor_->loopStart();
     for (uint8_t i = 0; i < count_; i++) {
+        source_ = i;
+        monitor_->receiveStart(i);
         nodes_[i]->receive(broadcast_);
+        monitor_->receiveEnd(i);
     }
+    monitor_->loopEnd();
 }
 
 void Bus::BroadcastImpl::operator()(const Frame& frame) const {
+    BusMonitor* monitor = bus_->monitor_;
+    if (monitor == nullptr) {
+        for (uint8_t i = 0; i < bus_->count_; i++) {
+            if (bus_->nodes_[i]->filter(frame.id)) {
+                bus_->nodes_[i]->send(frame);
+            }
+        }
+        return;
+    }
+
+    monitor->broadcast(bus_->source_, frame);
     for (uint8_t i = 0; i < bus_->count_; i++) {
         if (bus_->nodes_[i]->filter(frame.id)) {
+            monitor->sendStart(i, frame);
             bus_->nodes_[i]->send(frame);
+            monitor->sendEnd(i);
         }
     }
 }
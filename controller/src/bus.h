@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 
+#include "timer.h"
+
 
 // A data frame.
 struct Frame {
@@ -47,6 +49,59 @@ class Node {
         // Filter sent frames to this node. Return true for frame IDs that
         // should be sent to this node.
         virtual bool filter(uint32_t id) const = 0;
+
+        // The number of frames the node dropped due to errors. Reported by
+        // the diagnostics node. Nodes which cannot drop frames return 0.
+        virtual uint32_t dropped() const { return 0; }
+};
+
+// Observes bus activity. Nodes are identified by their index in the bus node
+// array. All calls are made from the bus loop. Sends are nested within the
+// receive of the node which broadcast the frame.
+class BusMonitor {
+    public:
+        BusMonitor() = default;
+        virtual ~BusMonitor() = default;
+
+        // Called once when the monitor is attached to a bus.
+        virtual void attach(Node** nodes, uint8_t count) = 0;
+
+        // Called at the start and end of each loop iteration.
+        virtual void loopStart() = 0;
+        virtual void loopEnd() = 0;
+
+        // Called around a node's receive() call.
+        virtual void receiveStart(uint8_t node) = 0;
+        virtual void receiveEnd(uint8_t node) = 0;
+
+        // Called when a node broadcasts a frame.
+        virtual void broadcast(uint8_t source, const Frame& frame) = 0;
+
+        // Called around a node's send() call.
+        virtual void sendStart(uint8_t node, const Frame& frame) = 0;
+        virtual void sendEnd(uint8_t node) = 0;
+};
+
+// Forwards bus activity to several monitors. Start events are forwarded in
+// order and end events in reverse order so the last monitor observes the
+// innermost interval.
+class MultiMonitor : public BusMonitor {
+    public:
+        MultiMonitor(BusMonitor** monitors, uint8_t count) :
+            monitors_(monitors), count_(count) {}
+
+        void attach(Node** nodes, uint8_t count) override;
+        void loopStart() override;
+        void loopEnd() override;
+        void receiveStart(uint8_t node) override;
+        void receiveEnd(uint8_t node) override;
+        void broadcast(uint8_t source, const Frame& frame) override;
+        void sendStart(uint8_t node, const Frame& frame) override;
+        void sendEnd(uint8_t node) override;
+
+    private:
+        BusMonitor** monitors_;
+        uint8_t count_;
 };
 
 // Bus connects a series of nodes which send and receive frames. Frames are
@@ -56,11 +111,14 @@ class Node {
 class Bus {
     public:
         // Construct a bus that connects the provided set of nodes. Count is
-        // the number of nodes in the array.
-        Bus(Node** nodes, uint8_t count) : nodes_(nodes), count_(count), broadcast_(this) {}
-
-        // Called on each main loop iteration. Calls receive on each node and
-        // broadcasts any received frames.
+        // the number of nodes in the array. The timer wheel is updated at the
+        // start of each loop. An optional monitor observes all bus activity.
+        Bus(Node** nodes, uint8_t count, TimerWheel* timers = TimerWheel::real(),
+                BusMonitor* monitor = nullptr);
+
+        // Called on each main loop iteration. Updates the timer wheel, which
+        // samples the clock once for the iteration, then calls receive on
+        // each node and broadcasts any received frames.
         void loop();
 
     private:
@@ -77,6 +135,9 @@ class Bus {
 
         Node** nodes_;
         uint8_t count_;
+        TimerWheel* timers_;
+        BusMonitor* monitor_;
+        uint8_t source_;
         Frame frame_;
         BroadcastImpl broadcast_;
 };
@@ -0,0 +1,155 @@
+#include "calibration.h"
+
+#include "debug.h"
+
+#define LOG_MODULE LOG_STEERING
+
+
+static void clearStats(LadderLevelStats* stats) {
+    stats->count = 0;
+    stats->min = 0xFFFF;
+    stats->max = 0;
+    stats->total = 0;
+}
+
+// Return true if two readings are within tolerance of each other.
+static bool near(uint16_t a, uint16_t b, uint16_t tolerance) {
+    return (a > b ? a - b : b - a) <= tolerance;
+}
+
+LadderCalibration::LadderCalibration(uint8_t count, uint16_t min_samples, uint16_t max_glitch,
+        uint16_t tolerance, uint16_t debounce_margin, uint16_t min_debounce) :
+        count_(count < kMaxLevels ? count : kMaxLevels), min_samples_(min_samples),
+        max_glitch_(max_glitch), tolerance_(tolerance), debounce_margin_(debounce_margin),
+        min_debounce_(min_debounce) {
+    reset();
+}
+
+void LadderCalibration::reset() {
+    for (uint8_t i = 0; i <= kMaxLevels; i++) {
+        clearStats(&levels_[i]);
+    }
+    level_ = -1;
+    run_valid_ = false;
+    run_matches_ = false;
+    seen_level_ = false;
+    max_glitch_seen_ = 0;
+}
+
+void LadderCalibration::setLabel(uint8_t mask) {
+    int8_t level = -1;
+    if (mask == 0) {
+        level = count_;
+    } else if ((mask & (mask - 1)) == 0) {
+        for (uint8_t i = 0; i < count_; i++) {
+            if (mask == 1 << i) {
+                level = i;
+            }
+        }
+    }
+    if (level == level_) {
+        return;
+    }
+    level_ = level;
+    run_valid_ = false;
+    seen_level_ = false;
+}
+
+void LadderCalibration::record(uint16_t value, uint32_t now) {
+    if (level_ < 0) {
+        return;
+    }
+
+    bool joins = run_matches_ ? matchesLevel(value) : near(value, run_ref_, tolerance_);
+    if (!run_valid_ || !joins) {
+        bool matches = matchesLevel(value);
+        if (run_valid_ && run_matches_) {
+            seen_level_ = true;
+            level_end_ = now;
+        } else if (run_valid_ && matches && seen_level_) {
+            // noise between two runs at the level's reading
+            uint32_t glitch = now - level_end_;
+            if (glitch < max_glitch_ && glitch > max_glitch_seen_) {
+                max_glitch_seen_ = glitch;
+            }
+        }
+        startRun(value, now);
+        run_matches_ = matches;
+    }
+
+    ++run_.count;
+    run_.total += value;
+    if (value < run_.min) {
+        run_.min = value;
+    }
+    if (value > run_.max) {
+        run_.max = value;
+    }
+
+    if (now - run_start_ < max_glitch_) {
+        return;
+    }
+    LadderLevelStats* level = &levels_[level_];
+    if (!run_matches_ && run_.count > level->count) {
+        // A longer stable run replaces readings taken before the user
+        // pressed or after they released the button.
+        clearStats(level);
+        run_matches_ = true;
+        seen_level_ = false;
+    }
+    if (run_matches_) {
+        merge(level);
+    }
+}
+
+bool LadderCalibration::compute(uint16_t* boundaries, uint16_t* debounce) const {
+    for (uint8_t i = 0; i <= count_; i++) {
+        if (levels_[i].count < min_samples_) {
+            ERROR_MSG_VAL("calibration: not enough samples for level ", i);
+            return false;
+        }
+        INFO_MSG_VAL("calibration: level ", i);
+        INFO_MSG_VAL("calibration:   min ", levels_[i].min);
+        INFO_MSG_VAL("calibration:   max ", levels_[i].max);
+        INFO_MSG_VAL("calibration:   mean ", levels_[i].mean());
+    }
+    for (uint8_t i = 0; i < count_; i++) {
+        if (levels_[i].max >= levels_[i + 1].min) {
+            ERROR_MSG_VAL("calibration: overlapping levels ", i);
+            return false;
+        }
+        boundaries[i] = (levels_[i].max + levels_[i + 1].min + 1) / 2;
+    }
+    uint32_t value = max_glitch_seen_ + debounce_margin_;
+    *debounce = value < min_debounce_ ? min_debounce_ : value;
+    INFO_MSG_VAL("calibration: max glitch ", max_glitch_seen_);
+    return true;
+}
+
+bool LadderCalibration::matchesLevel(uint16_t value) const {
+    const LadderLevelStats& level = levels_[level_];
+    return level.count > 0 && near(value, level.mean(), tolerance_);
+}
+
+void LadderCalibration::startRun(uint16_t value, uint32_t now) {
+    clearStats(&run_);
+    run_ref_ = value;
+    run_start_ = now;
+    run_valid_ = true;
+    run_matches_ = false;
+}
+
+void LadderCalibration::merge(LadderLevelStats* stats) {
+    if (run_.count == 0) {
+        return;
+    }
+    stats->count += run_.count;
+    stats->total += run_.total;
+    if (run_.min < stats->min) {
+        stats->min = run_.min;
+    }
+    if (run_.max > stats->max) {
+        stats->max = run_.max;
+    }
+    clearStats(&run_);
+}
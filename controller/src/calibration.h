@@ -0,0 +1,90 @@
+#ifndef __R51_CALIBRATION__
+#define __R51_CALIBRATION__
+
+#include <Arduino.h>
+
+
+// Range of the analog readings recorded for a single ladder level.
+struct LadderLevelStats {
+    uint32_t count;
+    uint16_t min;
+    uint16_t max;
+    uint32_t total;
+
+    // The average reading. Returns 0 if nothing was recorded.
+    uint16_t mean() const { return count == 0 ? 0 : total / count; }
+};
+
+// Records the analog readings of a resistor ladder while the user holds each
+// button in turn and computes the thresholds and debounce duration for the
+// ladder.
+//
+// Raw readings are recorded under the label the user was prompted with. They
+// are grouped into runs of stable readings which stay within the tolerance of
+// the first reading of the run. The current thresholds are not used so a
+// button whose reading has drifted into a neighboring level is still
+// calibrated. Runs which last at least the maximum glitch duration are added
+// to the level's statistics. If the user was slow to press or release the
+// button the level keeps the longest stable run seen under the label. Shorter
+// runs between two runs at the level's reading are treated as noise and the
+// longest sets the debounce duration.
+//
+// Full per-reading histograms would need several kB of RAM per ladder so only
+// the range of each level is kept. The ranges are all that is needed to place
+// a boundary midway between neighboring levels.
+class LadderCalibration {
+    public:
+        // The maximum number of buttons on a ladder.
+        static const uint8_t kMaxLevels = 8;
+
+        // Create a calibration for a ladder with count buttons. Level count
+        // is the idle level when no buttons are pressed.
+        // Readings within tolerance of each other belong to the same run.
+        LadderCalibration(uint8_t count, uint16_t min_samples, uint16_t max_glitch,
+                uint16_t tolerance, uint16_t debounce_margin, uint16_t min_debounce);
+
+        // Discard all recorded readings.
+        void reset();
+
+        // Set the buttons which the user is holding down. A mask of 0 records
+        // the idle level. Masks with more than one button are not recorded.
+        void setLabel(uint8_t mask);
+
+        // Record a raw reading taken at the given time.
+        void record(uint16_t value, uint32_t now);
+
+        // Compute count boundaries and the debounce duration. Readings below
+        // boundaries[i] belong to button i. Return false if a level does not
+        // have enough samples or neighboring levels overlap.
+        bool compute(uint16_t* boundaries, uint16_t* debounce) const;
+
+        // Return the statistics for a level.
+        const LadderLevelStats& stats(uint8_t level) const { return levels_[level]; }
+
+        // The longest glitch seen in ms.
+        uint16_t maxGlitch() const { return max_glitch_seen_; }
+
+    private:
+        const uint8_t count_;
+        const uint16_t min_samples_;
+        const uint16_t max_glitch_;
+        const uint16_t tolerance_;
+        const uint16_t debounce_margin_;
+        const uint16_t min_debounce_;
+        LadderLevelStats levels_[kMaxLevels + 1];
+        int8_t level_;
+        LadderLevelStats run_;
+        uint16_t run_ref_;
+        uint32_t run_start_;
+        bool run_valid_;
+        bool run_matches_;
+        bool seen_level_;
+        uint32_t level_end_;
+        uint16_t max_glitch_seen_;
+
+        bool matchesLevel(uint16_t value) const;
+        void startRun(uint16_t value, uint32_t now);
+        void merge(LadderLevelStats* stats);
+};
+
+#endif  // __R51_CALIBRATION__
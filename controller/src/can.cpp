@@ -3,6 +3,8 @@
 #include "debug.h"
 #include "same51_can.h"
 
+#define LOG_MODULE LOG_CAN
+
 
 void Same51Can::begin() {
     while (!init_) {
@@ -27,6 +29,7 @@ void Same51Can::receive(const Broadcast& broadcast) {
         return;
     }
     if (err != CAN_NOMSG) {
+        ++dropped_;
         ERROR_MSG_VAL("can: read failed: error code ", err);
     }
 }
@@ -44,6 +47,7 @@ void Same51Can::send(const Frame& frame) {
     } while (err != CAN_OK && attempts <= retries_);
 
     if (err != CAN_OK) {
+        ++dropped_;
         ERROR_MSG_VAL("can: write failed: error code ", err);
         ERROR_MSG_FRAME("can: dropped frame ", frame);
     }
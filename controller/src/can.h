@@ -9,7 +9,7 @@ class Same51Can : public Node {
     public:
         Same51Can(uint32_t baudrate = CAN_500KBPS) :
             client_(), init_(false),
-            baudrate_(baudrate), retries_(5) {}
+            baudrate_(baudrate), retries_(5), dropped_(0) {}
 
         // Initialize the CAN controller. 
         void begin();
@@ -19,11 +19,15 @@ class Same51Can : public Node {
 
         // Send a frame to the CAN bus.
         virtual void send(const Frame& frame) override;
+
+        // The number of frames which failed to be read or written.
+        uint32_t dropped() const override { return dropped_; }
     private:
         SAME51_CAN client_;
         bool init_;
         uint32_t baudrate_;
         uint8_t retries_;
+        uint32_t dropped_;
         Frame frame_;
 };
 
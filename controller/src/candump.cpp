@@ -0,0 +1,193 @@
+#include "candump.h"
+
+#include "debug.h"
+#include "hex.h"
+
+#define LOG_MODULE LOG_SERIAL
+
+
+size_t formatCandump(char* buffer, uint64_t micros, const char* iface,
+        uint32_t id, const byte* data, uint8_t len) {
+    char* p = buffer;
+    *p++ = '(';
+    p = writeDecimal(p, micros / 1000000, 10);
+    *p++ = '.';
+    p = writeDecimal(p, micros % 1000000, 6);
+    *p++ = ')';
+    *p++ = ' ';
+    for (uint8_t i = 0; iface[i] != 0 && i < 15; i++) {
+        *p++ = iface[i];
+    }
+    *p++ = ' ';
+    p = writeHex(p, id, id <= 0x7FF ? 3 : 8);
+    *p++ = '#';
+    if (len > 8) {
+        *p++ = '#';
+        *p++ = '0';
+    }
+    p = writeHexBytes(p, data, len);
+    *p = 0;
+    return p - buffer;
+}
+
+bool parseCandump(const char* line, uint64_t* micros, Frame* frame) {
+    const char* p = line;
+    while (*p == ' ') {
+        ++p;
+    }
+    if (*p++ != '(') {
+        return false;
+    }
+    uint64_t seconds = 0;
+    for (; *p >= '0' && *p <= '9'; p++) {
+        seconds = seconds * 10 + (*p - '0');
+    }
+    if (*p++ != '.') {
+        return false;
+    }
+    uint32_t fraction = 0;
+    uint8_t digits = 0;
+    for (; *p >= '0' && *p <= '9'; p++) {
+        if (digits < 6) {
+            fraction = fraction * 10 + (*p - '0');
+            ++digits;
+        }
+    }
+    for (; digits < 6; digits++) {
+        fraction *= 10;
+    }
+    if (*p++ != ')') {
+        return false;
+    }
+    *micros = seconds * 1000000 + fraction;
+
+    // skip the interface name
+    while (*p == ' ') {
+        ++p;
+    }
+    while (*p != ' ' && *p != 0) {
+        ++p;
+    }
+    while (*p == ' ') {
+        ++p;
+    }
+
+    uint32_t id = 0;
+    uint8_t id_len = 0;
+    for (int8_t v; (v = hexValue(*p)) >= 0; p++) {
+        id = (id << 4) | v;
+        ++id_len;
+    }
+    if (id_len == 0 || id_len > 8 || *p++ != '#') {
+        return false;
+    }
+
+    uint8_t max_len = 8;
+    if (*p == '#') {
+        // CAN FD frame followed by a flags digit
+        if (hexValue(p[1]) < 0) {
+            return false;
+        }
+        p += 2;
+        max_len = 64;
+    }
+
+    uint8_t len = 0;
+    for (int8_t hi, lo; (hi = hexValue(p[0])) >= 0; p += 2) {
+        lo = hexValue(p[1]);
+        if (lo < 0 || len >= max_len) {
+            return false;
+        }
+        frame->data[len++] = (hi << 4) | lo;
+    }
+    if (*p != 0 && *p != '\r' && *p != '\n' && *p != ' ') {
+        return false;
+    }
+    frame->id = id;
+    frame->len = len;
+    return true;
+}
+
+CandumpReplay::CandumpReplay(TimerWheel* timers) :
+        timers_(timers), stream_(nullptr), speed_(1), line_len_(0), overflow_(false),
+        frame_time_(0), pending_(false), started_(false), log_start_(0), elapsed_(0),
+        last_(0), count_(0), dropped_(0) {}
+
+void CandumpReplay::begin(Stream* stream, uint16_t speed) {
+    stream_ = stream;
+    speed_ = speed;
+    line_len_ = 0;
+    overflow_ = false;
+    pending_ = false;
+    started_ = false;
+}
+
+void CandumpReplay::receive(const Broadcast& broadcast) {
+    if (stream_ == nullptr) {
+        return;
+    }
+    uint32_t now = timers_->micros();
+    elapsed_ += now - last_;
+    last_ = now;
+
+    for (uint8_t i = 0; i < CANDUMP_REPLAY_BATCH; i++) {
+        if (!pending_ && !next()) {
+            return;
+        }
+        if (!started_) {
+            started_ = true;
+            log_start_ = frame_time_;
+            elapsed_ = 0;
+        }
+        if (speed_ != 0 && frame_time_ > log_start_ &&
+                (frame_time_ - log_start_) / speed_ > elapsed_) {
+            return;
+        }
+        pending_ = false;
+        ++count_;
+        broadcast(frame_);
+    }
+}
+
+bool CandumpReplay::next() {
+    while (stream_->available()) {
+        char c = stream_->read();
+        if (c != '\n' && c != '\r') {
+            if (line_len_ < kCandumpLineSize - 1) {
+                line_[line_len_++] = c;
+            } else {
+                overflow_ = true;
+            }
+            continue;
+        }
+        if (line_len_ == 0 && !overflow_) {
+            continue;
+        }
+        line_[line_len_] = 0;
+        bool valid = !overflow_ && parseCandump(line_, &frame_time_, &frame_);
+        line_len_ = 0;
+        overflow_ = false;
+        if (valid) {
+            pending_ = true;
+            return true;
+        }
+        ERROR_MSG("candump: invalid log line");
+        ++dropped_;
+    }
+    return false;
+}
+
+void CandumpCapture::send(const Frame& frame) {
+    if (stream_ == nullptr || !filter_.pass(frame.id, timers_->now())) {
+        return;
+    }
+    uint32_t now = timers_->micros();
+    elapsed_ += now - last_;
+    last_ = now;
+
+    char line[kCandumpLineSize];
+    size_t len = formatCandump(line, elapsed_, CANDUMP_INTERFACE,
+            frame.id, frame.data, frame.len);
+    line[len++] = '\n';
+    stream_->write((const uint8_t*)line, len);
+}
@@ -0,0 +1,105 @@
+#ifndef __R51_CANDUMP__
+#define __R51_CANDUMP__
+
+#include <Arduino.h>
+
+#include "bus.h"
+#include "config.h"
+#include "serial.h"
+#include "timer.h"
+
+#if defined(CAPTURE_ENABLE) && !defined(DEBUG_ENABLE)
+#error DEBUG_ENABLE must be set with CAPTURE_ENABLE
+#endif
+
+
+// The longest candump log line including the terminating null. Fits a 64 byte
+// CAN FD frame and an interface name of up to 15 characters.
+static const size_t kCandumpLineSize = 192;
+
+// Format a frame as a candump log line:
+//   (SSSSSSSSSS.UUUUUU) IFACE III#DDDDDDDDDDDDDDDD
+//
+// Standard IDs are written with 3 digits and extended IDs with 8. Frames
+// longer than 8 bytes are written as CAN FD frames with an ID##0 separator.
+// The buffer must hold kCandumpLineSize bytes. The line is null terminated and
+// has no line ending. Return the length of the line.
+size_t formatCandump(char* buffer, uint64_t micros, const char* iface,
+        uint32_t id, const byte* data, uint8_t len);
+
+// Parse a candump log line into a frame and its timestamp in microseconds.
+// Return false if the line is not a valid data frame. Remote frames are not
+// supported.
+bool parseCandump(const char* line, uint64_t* micros, Frame* frame);
+
+// Replays a candump log through the bus. Frames are broadcast with the timing
+// of the log scaled by the replay speed. The first frame is broadcast on the
+// first loop. Up to CANDUMP_REPLAY_BATCH frames are broadcast per loop so
+// other nodes continue to run during a fast replay. Lines which cannot be
+// parsed are dropped.
+class CandumpReplay : public Node {
+    public:
+        CandumpReplay(TimerWheel* timers = TimerWheel::real());
+
+        // Start replaying the log read from the stream. Speed is a multiple
+        // of real time. A speed of 0 replays frames as fast as possible.
+        void begin(Stream* stream, uint16_t speed = 1);
+
+        // Broadcast frames which are due.
+        void receive(const Broadcast& broadcast) override;
+
+        // Does nothing. The replay does not accept frames.
+        void send(const Frame&) override {}
+
+        // Does not match any frames.
+        bool filter(uint32_t) const override { return false; }
+
+        // The number of log lines which could not be parsed.
+        uint32_t dropped() const override { return dropped_; }
+
+        // The number of frames replayed.
+        uint32_t count() const { return count_; }
+
+    private:
+        TimerWheel* timers_;
+        Stream* stream_;
+        uint16_t speed_;
+
+        char line_[kCandumpLineSize];
+        size_t line_len_;
+        bool overflow_;
+
+        Frame frame_;
+        uint64_t frame_time_;
+        bool pending_;
+
+        bool started_;
+        uint64_t log_start_;
+        uint64_t elapsed_;
+        uint32_t last_;
+
+        uint32_t count_;
+        uint32_t dropped_;
+
+        bool next();
+};
+
+// Captures frames in candump log format. Frames and filter commands are read
+// from the stream as in SerialText and every frame which passes the filters is
+// written to the stream as a candump log line on interface CANDUMP_INTERFACE.
+// Timestamps are the loop time since boot. The output may be saved with any
+// serial terminal and read with standard SocketCAN tools such as canplayer.
+class CandumpCapture : public SerialText {
+    public:
+        CandumpCapture(TimerWheel* timers = TimerWheel::real()) :
+            SerialText(timers), elapsed_(0), last_(0) {}
+
+        // Write the frame in candump format.
+        void send(const Frame& frame) override;
+
+    private:
+        uint64_t elapsed_;
+        uint32_t last_;
+};
+
+#endif  // __R51_CANDUMP__
@@ -4,9 +4,11 @@
 #include "config.h"
 #include "debug.h"
 
+#define LOG_MODULE LOG_CLIMATE
 
-Climate::Climate(Clock* clock, GPIO* gpio) : clock_(clock),
-        rear_defrost_(REAR_DEFROST_PIN, REAR_DEFROST_TRIGGER_MS, clock, gpio) {
+
+Climate::Climate(TimerWheel* timers, GPIO* gpio, Pulse* pulse) : timers_(timers),
+        rear_defrost_(REAR_DEFROST_PIN, REAR_DEFROST_TRIGGER_MS, timers, gpio, pulse) {
     // Init operational state.
     state_ = STATE_OFF;
     mode_ = MODE_OFF;
@@ -15,13 +17,13 @@ Climate::Climate(Clock* clock, GPIO* gpio) : clock_(clock),
     // Init state storage.
     state_init_ = 0;
     state_changed_ = false;
-    state_last_broadcast_ = 0;
+    timers_->start(&state_timer_, CLIMATE_STATE_FRAME_HB);
     initFrame(&state_frame_, CLIMATE_STATE_FRAME_ID, 8);
 
     // Init control storage.
     control_init_ = false;
     control_changed_ = true;
-    control_last_broadcast_ = 0;
+    timers_->start(&control_init_timer_, CLIMATE_CONTROL_INIT_EXPIRE);
     initFrame(&control_frame_540_, 0x540, 8);
     control_frame_540_.data[0] = 0x80;
     initFrame(&control_frame_541_, 0x541, 8);
@@ -29,11 +31,15 @@ Climate::Climate(Clock* clock, GPIO* gpio) : clock_(clock),
     memset(control_state_, 0, 8);
 }
 
+void Climate::begin() {
+    rear_defrost_.begin();
+}
+
 void Climate::receive(const Broadcast& broadcast) {
     uint32_t control_hb = control_init_ ? CLIMATE_CONTROL_FRAME_HB : CLIMATE_CONTROL_INIT_HB;
     rear_defrost_.update();
 
-    if (!control_init_ && clock_->millis() >= CLIMATE_CONTROL_INIT_EXPIRE) {
+    if (!control_init_ && !control_init_timer_.active()) {
         control_frame_540_.data[0] = 0x60;
         control_frame_540_.data[1] = 0x40;
         control_frame_540_.data[6] = 0x04;
@@ -41,23 +47,22 @@ void Climate::receive(const Broadcast& broadcast) {
         control_init_ = true;
     }
 
-    if (control_changed_ ||
-            clock_->millis() - control_last_broadcast_ >= control_hb) {
+    if (control_changed_ || !control_timer_.active()) {
         control_changed_ = false;
-        control_last_broadcast_ = clock_->millis();
+        timers_->start(&control_timer_, control_hb);
         broadcast(control_frame_540_);
         broadcast(control_frame_541_);
     }
 
-    if (state_init_ == 0x03 && (state_changed_ ||
-            clock_->millis() - state_last_broadcast_ >= CLIMATE_STATE_FRAME_HB)) {
+    if (state_init_ == 0x03 && (state_changed_ || !state_timer_.active())) {
         state_changed_ = false;
-        state_last_broadcast_ = clock_->millis();
+        timers_->start(&state_timer_, CLIMATE_STATE_FRAME_HB);
         broadcast(state_frame_);
     }
 }
 
 void Climate::send(const Frame& frame) {
+    TRACE_FRAME("climate: received ", frame);
     switch (frame.id) {
         case 0x54A:
             handle54A(frame);
@@ -4,9 +4,10 @@
 #include <Arduino.h>
 
 #include "bus.h"
-#include "clock.h"
 #include "gpio.h"
 #include "momentary_output.h"
+#include "pulse.h"
+#include "timer.h"
 
 
 // Manages vehicle climate control system and sends state changes via a single
@@ -33,7 +34,10 @@
 //   Byte 4: Heating Elements
 //     Bit 0: rear window heating element
 //     Bit 1-7: unused
-//   Bytes 5-6: unused
+//   Byte 5: unused
+//   Byte 6: Snapshot
+//     Bit 0-6: unused
+//     Bit 7: stale; set when restored from storage on boot
 //   Byte 7: Outside Temperature
 //
 // Frame 0x5401: Climate Control Frame
@@ -62,7 +66,11 @@
 //   Bytes 5-7: unused
 class Climate : public Node {
     public:
-        Climate(Clock* clock = Clock::real(), GPIO* gpio = GPIO::real());
+        Climate(TimerWheel* timers = TimerWheel::real(), GPIO* gpio = GPIO::real(),
+                Pulse* pulse = Pulse::real());
+
+        // Attach the rear defrost output to its hardware pulse timer.
+        void begin();
 
         // Receive translated state frames.
         void receive(const Broadcast& broadcast) override;
@@ -76,7 +84,7 @@ class Climate : public Node {
         bool filter(uint32_t id) const override;
 
     private:
-        Clock* clock_;
+        TimerWheel* timers_;
 
         // Hardware control.
         MomentaryOutput rear_defrost_;
@@ -107,13 +115,14 @@ class Climate : public Node {
         // State frame storage.
         uint8_t state_init_;
         bool state_changed_;
-        uint32_t state_last_broadcast_;
+        Timer state_timer_;
         Frame state_frame_;
 
         // Control frame storage.
         bool control_init_;
         bool control_changed_;
-        uint32_t control_last_broadcast_;
+        Timer control_timer_;
+        Timer control_init_timer_;
         Frame control_frame_540_;
         Frame control_frame_541_;
         byte control_state_[8];
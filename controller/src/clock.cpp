@@ -3,6 +3,7 @@
 
 // Unshasow Arduino functions.
 inline uint32_t arduino_millis() { return millis(); }
+inline uint32_t arduino_micros() { return micros(); }
 inline void arduino_delay(uint32_t ms) { delay(ms); }
 
 class RealClock : public Clock {
@@ -11,6 +12,14 @@ class RealClock : public Clock {
             return arduino_millis();
         }
 
+        uint32_t micros() override {
+            return arduino_micros();
+        }
+
+        Tick tick() override {
+            return {arduino_millis(), arduino_micros()};
+        }
+
         void delay(uint32_t ms) override {
             arduino_delay(ms);
         }
@@ -4,6 +4,13 @@
 #include <Arduino.h>
 
 
+// A snapshot of the clock. Taken once per main loop iteration so every node
+// sees the same time.
+struct Tick {
+    uint32_t millis;
+    uint32_t micros;
+};
+
 // Base clock interface. Allows the clock to be mocked.
 class Clock {
     public:
@@ -16,6 +23,15 @@ class Clock {
         // Return the number of milliseconds since the Arduino started.
         virtual uint32_t millis() = 0;
 
+        // Return the number of microseconds since the Arduino started.
+        // Overflows roughly every 71 minutes.
+        virtual uint32_t micros() = 0;
+
+        // Return the current time in milliseconds and microseconds.
+        virtual Tick tick() {
+            return {millis(), micros()};
+        }
+
         // Pause the Arduino for the given number of milliseconds.
         virtual void delay(uint32_t) = 0;
 };
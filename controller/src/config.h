@@ -10,10 +10,97 @@
 
 // Uncomment the following line to enable debug output.
 //#define DEBUG_ENABLE
+// Uncomment the following line to enable binary trace output instead. Trace
+// records are much smaller than debug messages and may be left on in the car.
+// They are decoded on the host with tools/decode_trace.py.
+//#define TRACE_ENABLE
 #define DEBUG_SERIAL Serial1
 #define DEBUG_BAUDRATE 115200
 // Uncomment to block boot until debug serial is connected.
 //#define DEBUG_WAIT_FOR_SERIAL
+// Debug serial output filters. Up to FILTER_RULES allow and deny rules are
+// set at runtime. Decisions for up to FILTER_SLOTS IDs are cached. SLOTS must
+// be a power of 2.
+#define SERIAL_FILTER_RULES 8
+#define SERIAL_FILTER_SLOTS 32
+// Size of the RAM ring which buffers debug and trace messages until the serial
+// port can accept them. Must be a power of 2. Messages are dropped when it is
+// full.
+#define DEBUG_LOG_SIZE 2048
+// Debug and trace messages are filtered per module. The compile-time floor of
+// each module removes messages below it from the build. The runtime level of
+// each module starts at info and is changed with the 0x5F01 frame. Levels are
+// LOG_LEVEL_INFO, LOG_LEVEL_ERROR and LOG_LEVEL_OFF.
+#define LOG_CONTROL_FRAME_ID 0x5F01
+#define LOG_FLOOR_SYSTEM LOG_LEVEL_INFO
+#define LOG_FLOOR_CAN LOG_LEVEL_INFO
+#define LOG_FLOOR_REALDASH LOG_LEVEL_INFO
+#define LOG_FLOOR_SERIAL LOG_LEVEL_INFO
+#define LOG_FLOOR_CLIMATE LOG_LEVEL_INFO
+#define LOG_FLOOR_SETTINGS LOG_LEVEL_INFO
+#define LOG_FLOOR_STEERING LOG_LEVEL_INFO
+
+// Diagnostics frames are published every DIAGNOSTICS_FRAME_HB ms. Node frames
+// start at DIAGNOSTICS_NODE_FRAME_ID and are offset by the node index. Up to
+// MAX_NODES nodes and ID_SLOTS distinct frame IDs are tracked. ID_SLOTS must
+// be a power of 2.
+#define DIAGNOSTICS_FRAME_ID 0x5F00
+#define DIAGNOSTICS_ID_FRAME_ID 0x5F02
+#define DIAGNOSTICS_NODE_FRAME_ID 0x5F10
+#define DIAGNOSTICS_FRAME_HB 1000
+#define DIAGNOSTICS_MAX_NODES 16
+#define DIAGNOSTICS_ID_SLOTS 32
+
+// The hardware watchdog resets the controller if the bus loop does not complete
+// within WATCHDOG_TIMEOUT ms. Loops longer than LOOP_DEADLINE ms are counted
+// as overruns. The reset cause and the node which blocked the loop are
+// published every FRAME_HB ms.
+#define WATCHDOG_TIMEOUT 2000
+#define WATCHDOG_LOOP_DEADLINE 50
+#define WATCHDOG_FRAME_ID 0x5F05
+#define WATCHDOG_FRAME_HB 1000
+
+// Free RAM is painted at boot to measure the stack high-water mark. Painting
+// stops STACK_MARGIN bytes below the stack pointer. Up to SCAN_WORDS words are
+// checked per loop. Memory use is published every FRAME_HB ms and the layout
+// and node sizes are written to DEBUG_SERIAL through SerialText when requested
+// with the 0x5F07 frame.
+#define MEMORY_FRAME_ID 0x5F06
+#define MEMORY_CONTROL_FRAME_ID 0x5F07
+#define MEMORY_FRAME_HB 1000
+#define MEMORY_STACK_MARGIN 256
+#define MEMORY_SCAN_WORDS 256
+
+// Uncomment to profile the bus with the CPU cycle counter. Requires
+// DEBUG_ENABLE. Stats are written to DEBUG_SERIAL through SerialText when
+// requested with the 0x5F03 frame. Up to MAX_NODES nodes and ID_SLOTS frame
+// IDs are tracked. ID_SLOTS must be a power of 2.
+//#define PROFILE_ENABLE
+#define PROFILE_CONTROL_FRAME_ID 0x5F03
+#define PROFILE_MAX_NODES 16
+#define PROFILE_ID_SLOTS 32
+
+// The flight recorder keeps the last RECORDER_SIZE broadcast frames in RAM
+// which is not cleared on reset. The recording is written to DEBUG_SERIAL
+// through SerialText in candump format when requested with the 0x5F04 frame.
+// RECORDER_SIZE must be a power of 2.
+#define RECORDER_CONTROL_FRAME_ID 0x5F04
+#define RECORDER_SIZE 64
+
+// Uncomment to write frames to DEBUG_SERIAL in candump log format instead of
+// the SerialText format. Requires DEBUG_ENABLE. Captured frames are written on
+// interface CANDUMP_INTERFACE. A candump replay broadcasts up to REPLAY_BATCH
+// frames per loop.
+//#define CAPTURE_ENABLE
+#define CANDUMP_INTERFACE "can0"
+#define CANDUMP_REPLAY_BATCH 16
+
+// Uncomment to speak the SLCAN protocol on SLCAN_SERIAL so the controller can
+// be attached to Linux with slcand. Cannot be set with DEBUG_ENABLE or
+// TRACE_ENABLE as the port is shared with DEBUG_SERIAL.
+//#define SLCAN_ENABLE
+#define SLCAN_SERIAL Serial1
+#define SLCAN_BAUDRATE 115200
 
 // RealDash serial interface. This should not require a DTR to begin as
 // RealDash does not send a DTR. On CanBed (and other Leonardos) this needs to
@@ -31,6 +118,10 @@
 #define CAN_CLOCK MCP_16MHZ
 // Uncomment to disable writes to the CAN bus.
 //#define CAN_LISTEN_ONLY
+// SocketCAN interface used by Linux builds. Up to BATCH frames are read and
+// written per system call.
+#define SOCKETCAN_INTERFACE "vcan0"
+#define SOCKETCAN_BATCH 32
 
 // Climate control configuration.
 #define CLIMATE_STATE_FRAME_ID 0x5400
@@ -48,17 +139,58 @@
 #define STEERING_SWITCH_B_PIN A3
 // The number of steering wheel buttons. This is the same for each analog pin.
 #define STEERING_SWITCH_COUNT 3
-// The analog values to expect for each button press.
+// The analog values to expect for each button press. Values are read at the
+// given resolution. A lookup table of this size is generated at compile time
+// to map each reading to a button.
 #define STEERING_SWITCH_VALUES {50, 280, 640}
+#define STEERING_SWITCH_RESOLUTION 1024
 // Frame configuration. HB is the heartbeat interval in ms.
 #define STEERING_SWITCH_FRAME_ID 0x5800
 #define STEERING_SWITCH_FRAME_LEN 8
 #define STEERING_SWITCH_FRAME_HB 500
+// Button timing in ms. A long press is reported once a button is held for
+// LONG_PRESS. Held buttons repeat every REPEAT ms after REPEAT_DELAY.
+#define STEERING_SWITCH_LONG_PRESS 800
+#define STEERING_SWITCH_REPEAT_DELAY 500
+#define STEERING_SWITCH_REPEAT 100
+// Steering keypad calibration. Calibration is controlled with the 0x5801
+// frame. Each level needs MIN_SAMPLES readings before thresholds are
+// computed. Readings within TOLERANCE counts of each other are treated as the
+// same level. Noise shorter than MAX_GLITCH ms between readings of the held
+// button sets the debounce duration, plus a margin and no less than
+// DEBOUNCE_MIN ms. Calibrated thresholds are stored at STORAGE_OFFSET.
+#define STEERING_CALIBRATION_FRAME_ID 0x5801
+#define STEERING_CALIBRATION_MIN_SAMPLES 50
+#define STEERING_CALIBRATION_MAX_GLITCH 100
+#define STEERING_CALIBRATION_TOLERANCE 40
+#define STEERING_CALIBRATION_DEBOUNCE_MARGIN 5
+#define STEERING_CALIBRATION_DEBOUNCE_MIN 5
+#define STEERING_CALIBRATION_STORAGE_OFFSET 32
 
-// Settings response timeout.
+// Settings frame configuration. The response timeout is the longest wait in
+// ms for the BCM to respond to each request. Requests which time out are
+// resent up to SETTINGS_RESPONSE_RETRIES times.
 #define SETTINGS_STATE_FRAME_ID 0x5700
 #define SETTINGS_STATE_FRAME_HB 500
 #define SETTINGS_CONTROL_FRAME_ID 0x5701
-#define SETTINGS_RESPONSE_TIMEOUT 500
+#define SETTINGS_RESPONSE_TIMEOUT 200
+#define SETTINGS_RESPONSE_RETRIES 2
+// ISO-TP flow control sent to the BCM for multi-frame responses. A block size
+// of 0 lets the BCM send every consecutive frame without waiting for another
+// flow control frame. STmin is the minimum gap between consecutive frames in
+// ms. The ISO-TP timeout is the longest wait for the next frame of a
+// multi-frame message.
+#define SETTINGS_ISOTP_BLOCK_SIZE 0
+#define SETTINGS_ISOTP_ST_MIN 10
+#define SETTINGS_ISOTP_TIMEOUT 250
+
+// State snapshot configuration. The last climate and settings state frames are
+// stored in SmartEEPROM and broadcast with the stale bit set on boot. Changed
+// frames are written at most once per write interval to limit flash wear.
+#define SNAPSHOT_STORAGE_OFFSET 0
+#define SNAPSHOT_WRITE_INTERVAL 60000
+#define SNAPSHOT_STALE_HB 500
+#define SNAPSHOT_STALE_BYTE 6
+#define SNAPSHOT_STALE_BIT 7
 
 #endif  // __R51_CONFIG__
@@ -0,0 +1,61 @@
+#include "cycles.h"
+
+
+#if defined(__SAMD51__)
+
+// Counts CPU cycles with the Cortex-M4 DWT cycle counter.
+class DwtCycleCounter : public CycleCounter {
+    public:
+        DwtCycleCounter() {
+            CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+            DWT->CYCCNT = 0;
+            DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        }
+
+        uint32_t read() override {
+            return DWT->CYCCNT;
+        }
+
+        uint32_t frequency() override {
+            return SystemCoreClock;
+        }
+};
+
+DwtCycleCounter real_cycles;
+
+#elif defined(__linux__) || defined(__APPLE__)
+
+#include <time.h>
+
+// Counts nanoseconds of the host's monotonic clock.
+class MonotonicCycleCounter : public CycleCounter {
+    public:
+        uint32_t read() override {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (uint32_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+        }
+
+        uint32_t frequency() override {
+            return 1000000000u;
+        }
+};
+
+MonotonicCycleCounter real_cycles;
+
+#else
+
+// Fallback for other boards. Counts microseconds.
+class MicrosCycleCounter : public CycleCounter {
+    public:
+        uint32_t read() override { return micros(); }
+        uint32_t frequency() override { return 1000000; }
+};
+
+MicrosCycleCounter real_cycles;
+
+#endif  // __SAMD51__
+
+CycleCounter* CycleCounter::real() {
+    return &real_cycles;
+}
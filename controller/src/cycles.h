@@ -0,0 +1,25 @@
+#ifndef __R51_CYCLES__
+#define __R51_CYCLES__
+
+#include <Arduino.h>
+
+
+// Base cycle counter interface. Allows the counter to be mocked. The real
+// counter is the DWT cycle counter on the SAME51, the monotonic clock in
+// nanoseconds on a host build, and micros() on other boards.
+class CycleCounter {
+    public:
+        // Return the real cycle counter.
+        static CycleCounter* real();
+
+        CycleCounter() = default;
+        virtual ~CycleCounter() = default;
+
+        // Return the current count. Wraps at 32 bits.
+        virtual uint32_t read() = 0;
+
+        // Return the number of counts per second.
+        virtual uint32_t frequency() = 0;
+};
+
+#endif  // __R51_CYCLES__
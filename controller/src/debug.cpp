@@ -4,22 +4,40 @@
 #include "config.h"
 
 
+#if defined(DEBUG_ENABLE) || defined(TRACE_ENABLE)
+
+static_assert((DEBUG_LOG_SIZE & (DEBUG_LOG_SIZE - 1)) == 0,
+        "DEBUG_LOG_SIZE must be a power of 2");
+
+LogLevels debug_levels;
+
+#endif  // DEBUG_ENABLE || TRACE_ENABLE
+
 #ifdef DEBUG_ENABLE
 
+static uint8_t debug_log_buffer[DEBUG_LOG_SIZE];
+LogRing debug_log(debug_log_buffer, DEBUG_LOG_SIZE);
+
 size_t printDebugFrame(const Frame& frame) {
     size_t n = 0;
-    n += DEBUG_SERIAL.print(frame.id, HEX);
-    n += DEBUG_SERIAL.print("#");
+    n += debug_log.print(frame.id, HEX);
+    n += debug_log.print("#");
     for (int i = 0; i < frame.len; i++) {
         if (frame.data[i] <= 0x0F) {
-            n += DEBUG_SERIAL.print("0");
+            n += debug_log.print("0");
         }
-        n += DEBUG_SERIAL.print(frame.data[i], HEX);
+        n += debug_log.print(frame.data[i], HEX);
         if (i < frame.len-1) {
-            n += DEBUG_SERIAL.print(":");
+            n += debug_log.print(":");
         }
     }
     return n;
 }
 
+#elif defined(TRACE_ENABLE)
+
+static uint8_t debug_log_buffer[DEBUG_LOG_SIZE];
+LogRing debug_log(debug_log_buffer, DEBUG_LOG_SIZE);
+Trace debug_trace(&debug_log);
+
 #endif  // DEBUG_ENABLE
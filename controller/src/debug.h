@@ -5,8 +5,40 @@
 
 #include "bus.h"
 #include "config.h"
+#include "log.h"
+#include "trace.h"
 
 
+// Return the compile-time log level floor of a module.
+constexpr LogLevel logFloor(LogModule module) {
+    return module == LOG_CAN ? LOG_FLOOR_CAN :
+        module == LOG_REALDASH ? LOG_FLOOR_REALDASH :
+        module == LOG_SERIAL ? LOG_FLOOR_SERIAL :
+        module == LOG_CLIMATE ? LOG_FLOOR_CLIMATE :
+        module == LOG_SETTINGS ? LOG_FLOOR_SETTINGS :
+        module == LOG_STEERING ? LOG_FLOOR_STEERING :
+        LOG_FLOOR_SYSTEM;
+}
+
+#if defined(DEBUG_ENABLE) || defined(TRACE_ENABLE)
+
+// Runtime log level of each module.
+extern LogLevels debug_levels;
+
+#define L(x) x
+
+// Return true if messages at LEVEL are logged for the calling file. Files which
+// log must define LOG_MODULE to their LogModule after their includes. Messages
+// below the module's floor are removed at compile time.
+#define LOG_ENABLED(LEVEL) \
+    ((LEVEL) >= logFloor(LOG_MODULE) && debug_levels.enabled(LOG_MODULE, LEVEL))
+
+#else
+
+#define L(x)
+
+#endif  // DEBUG_ENABLE || TRACE_ENABLE
+
 #ifdef DEBUG_ENABLE
 
 #ifndef DEBUG_SERIAL
@@ -19,65 +51,154 @@
 
 // Update these to change debug output settings.
 
+// Debug messages are buffered in RAM and written to DEBUG_SERIAL by
+// DEBUG_DRAIN() in the main loop so logging never blocks on the port. Messages
+// are written as they are logged from DEBUG_BEGIN() until DEBUG_ASYNC() is
+// called at the end of setup so messages from blocking setup code are not held
+// in the ring.
+extern LogRing debug_log;
+
 size_t printDebugFrame(const Frame& frame);
 
 #define D(x) x
-#define DEBUG_BEGIN() DEBUG_SERIAL.begin(DEBUG_BAUDRATE)
+#define DEBUG_BEGIN() ({\
+    DEBUG_SERIAL.begin(DEBUG_BAUDRATE);\
+    debug_log.sync(&DEBUG_SERIAL);\
+})
+#define DEBUG_ASYNC() debug_log.sync(nullptr)
+#define DEBUG_DRAIN() debug_log.drain(&DEBUG_SERIAL)
 
 #define INFO_MSG(MSG) ({\
-    DEBUG_SERIAL.print("[INFO]  ");\
-    DEBUG_SERIAL.println(MSG);\
-    DEBUG_SERIAL.flush();\
+    if (LOG_ENABLED(LOG_LEVEL_INFO)) {\
+        debug_log.print("[INFO]  ");\
+        debug_log.println(MSG);\
+        debug_log.commit();\
+    }\
 })
 #define INFO_MSG_VAL(MSG, VAL) ({\
-    DEBUG_SERIAL.print("[INFO]  ");\
-    DEBUG_SERIAL.print(MSG);\
-    DEBUG_SERIAL.println(VAL);\
-    DEBUG_SERIAL.flush();\
+    if (LOG_ENABLED(LOG_LEVEL_INFO)) {\
+        debug_log.print("[INFO]  ");\
+        debug_log.print(MSG);\
+        debug_log.println(VAL);\
+        debug_log.commit();\
+    }\
 })
 #define INFO_MSG_VAL_FMT(MSG, VAL, FMT) ({\
-    DEBUG_SERIAL.print("[INFO]  ");\
-    DEBUG_SERIAL.print(MSG);\
-    DEBUG_SERIAL.println(VAL, FMT);\
-    DEBUG_SERIAL.flush();\
+    if (LOG_ENABLED(LOG_LEVEL_INFO)) {\
+        debug_log.print("[INFO]  ");\
+        debug_log.print(MSG);\
+        debug_log.println(VAL, FMT);\
+        debug_log.commit();\
+    }\
 })
 #define INFO_MSG_FRAME(MSG, FRAME) ({\
-    DEBUG_SERIAL.print("[INFO]  ");\
-    DEBUG_SERIAL.print(MSG);\
-    printDebugFrame(FRAME);\
-    DEBUG_SERIAL.println("");\
-    DEBUG_SERIAL.flush();\
+    if (LOG_ENABLED(LOG_LEVEL_INFO)) {\
+        debug_log.print("[INFO]  ");\
+        debug_log.print(MSG);\
+        printDebugFrame(FRAME);\
+        debug_log.println("");\
+        debug_log.commit();\
+    }\
 })
 
 #define ERROR_MSG(MSG) ({\
-    DEBUG_SERIAL.print("[ERROR] ");\
-    DEBUG_SERIAL.println(MSG);\
-    DEBUG_SERIAL.flush();\
+    if (LOG_ENABLED(LOG_LEVEL_ERROR)) {\
+        debug_log.print("[ERROR] ");\
+        debug_log.println(MSG);\
+        debug_log.commit();\
+    }\
 })
 #define ERROR_MSG_VAL(MSG, VAL) ({\
-    DEBUG_SERIAL.print("[ERROR] ");\
-    DEBUG_SERIAL.print(MSG);\
-    DEBUG_SERIAL.println(VAL);\
-    DEBUG_SERIAL.flush();\
+    if (LOG_ENABLED(LOG_LEVEL_ERROR)) {\
+        debug_log.print("[ERROR] ");\
+        debug_log.print(MSG);\
+        debug_log.println(VAL);\
+        debug_log.commit();\
+    }\
 })
 #define ERROR_MSG_VAL_FMT(MSG, VAL, FMT) ({\
-    DEBUG_SERIAL.print("[ERROR] ");\
-    DEBUG_SERIAL.print(MSG);\
-    DEBUG_SERIAL.println(VAL, FMT);\
-    DEBUG_SERIAL.flush();\
+    if (LOG_ENABLED(LOG_LEVEL_ERROR)) {\
+        debug_log.print("[ERROR] ");\
+        debug_log.print(MSG);\
+        debug_log.println(VAL, FMT);\
+        debug_log.commit();\
+    }\
 })
 #define ERROR_MSG_FRAME(MSG, FRAME) ({\
-    DEBUG_SERIAL.print("[ERROR] ");\
-    DEBUG_SERIAL.print(MSG);\
-    printDebugFrame(FRAME);\
-    DEBUG_SERIAL.println("");\
-    DEBUG_SERIAL.flush();\
+    if (LOG_ENABLED(LOG_LEVEL_ERROR)) {\
+        debug_log.print("[ERROR] ");\
+        debug_log.print(MSG);\
+        printDebugFrame(FRAME);\
+        debug_log.println("");\
+        debug_log.commit();\
+    }\
+})
+
+#define TRACE_FRAME(MSG, FRAME)
+
+#elif defined(TRACE_ENABLE)
+
+#ifndef DEBUG_SERIAL
+#error DEBUG_SERIAL must be defined with TRACE_ENABLE is set
+#endif
+
+#ifndef DEBUG_BAUDRATE
+#error DEBUG_BAUDRATE must be defined with TRACE_ENABLE is set
+#endif
+
+// Debug messages are written to DEBUG_SERIAL as binary trace records which
+// reference the message by its trace ID. Decode them with
+// tools/decode_trace.py. Records are buffered the same as debug messages.
+extern LogRing debug_log;
+extern Trace debug_trace;
+
+#define D(x)
+#define DEBUG_BEGIN() ({\
+    DEBUG_SERIAL.begin(DEBUG_BAUDRATE);\
+    debug_log.sync(&DEBUG_SERIAL);\
 })
+#define DEBUG_ASYNC() debug_log.sync(nullptr)
+#define DEBUG_DRAIN() debug_log.drain(&DEBUG_SERIAL)
+
+#define TRACE_MSG(LEVEL, MSG) ({\
+    if (LOG_ENABLED(LEVEL)) {\
+        constexpr uint32_t __trace_id = traceId(MSG);\
+        debug_trace.message(LOG_MODULE, LEVEL, __trace_id);\
+    }\
+})
+#define TRACE_MSG_VAL(LEVEL, MSG, VAL, FMT) ({\
+    if (LOG_ENABLED(LEVEL)) {\
+        constexpr uint32_t __trace_id = traceId(MSG);\
+        debug_trace.value(LOG_MODULE, LEVEL, __trace_id, (uint32_t)(VAL), FMT);\
+    }\
+})
+#define TRACE_MSG_FRAME(LEVEL, MSG, FRAME) ({\
+    if (LOG_ENABLED(LEVEL)) {\
+        constexpr uint32_t __trace_id = traceId(MSG);\
+        debug_trace.frame(LOG_MODULE, LEVEL, __trace_id, FRAME);\
+    }\
+})
+
+#define INFO_MSG(MSG) TRACE_MSG(LOG_LEVEL_INFO, MSG)
+#define INFO_MSG_VAL(MSG, VAL) TRACE_MSG_VAL(LOG_LEVEL_INFO, MSG, VAL, DEC)
+#define INFO_MSG_VAL_FMT(MSG, VAL, FMT) TRACE_MSG_VAL(LOG_LEVEL_INFO, MSG, VAL, FMT)
+#define INFO_MSG_FRAME(MSG, FRAME) TRACE_MSG_FRAME(LOG_LEVEL_INFO, MSG, FRAME)
+
+#define ERROR_MSG(MSG) TRACE_MSG(LOG_LEVEL_ERROR, MSG)
+#define ERROR_MSG_VAL(MSG, VAL) TRACE_MSG_VAL(LOG_LEVEL_ERROR, MSG, VAL, DEC)
+#define ERROR_MSG_VAL_FMT(MSG, VAL, FMT) TRACE_MSG_VAL(LOG_LEVEL_ERROR, MSG, VAL, FMT)
+#define ERROR_MSG_FRAME(MSG, FRAME) TRACE_MSG_FRAME(LOG_LEVEL_ERROR, MSG, FRAME)
+
+// Trace a frame. Only enabled in trace builds as it is too verbose for text
+// output.
+#define TRACE_FRAME(MSG, FRAME) TRACE_MSG_FRAME(LOG_LEVEL_INFO, MSG, FRAME)
 
 #else
 
 #define D(x)
 #define DEBUG_BEGIN()
+#define DEBUG_ASYNC()
+#define DEBUG_DRAIN()
 
 #define INFO_MSG(MSG)
 #define INFO_MSG_VAL(MSG, VAL)
@@ -89,6 +210,8 @@ size_t printDebugFrame(const Frame& frame);
 #define ERROR_MSG_VAL_FMT(MSG, VAL, FMT)
 #define ERROR_MSG_FRAME(MSG, FRAME)
 
+#define TRACE_FRAME(MSG, FRAME)
+
 #endif  // DEBUG_ENABLE
 
 #endif  // __R51_DEBUG_H__
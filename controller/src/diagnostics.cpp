@@ -0,0 +1,175 @@
+#include "diagnostics.h"
+
+#include "binary.h"
+#include "config.h"
+
+
+static_assert((DIAGNOSTICS_ID_SLOTS & (DIAGNOSTICS_ID_SLOTS - 1)) == 0,
+        "DIAGNOSTICS_ID_SLOTS must be a power of 2");
+
+// Scale a count over elapsed ms to a rate per second.
+static uint32_t perSecond(uint32_t count, uint32_t elapsed) {
+    if (elapsed == 0) {
+        return 0;
+    }
+    return (uint64_t)count * 1000 / elapsed;
+}
+
+Diagnostics::Diagnostics(TimerWheel* timers, Clock* clock) :
+        timers_(timers), clock_(clock), period_start_(timers->now()),
+        nodes_(nullptr), node_sizes_(nullptr), count_(0), id_cursor_(0),
+        loop_start_(0), last_(0), receive_start_(0), send_start_(0),
+        nested_(0), receiving_(false) {
+    reset();
+    timers_->startPeriodic(&timer_, DIAGNOSTICS_FRAME_HB);
+}
+
+void Diagnostics::attach(Node** nodes, uint8_t count) {
+    nodes_ = nodes;
+    count_ = count > DIAGNOSTICS_MAX_NODES ? DIAGNOSTICS_MAX_NODES : count;
+}
+
+void Diagnostics::loopStart() {
+    // The wheel sampled the clock at the start of the loop.
+    loop_start_ = timers_->micros();
+    last_ = loop_start_;
+}
+
+void Diagnostics::loopEnd() {
+    uint32_t duration = last_ - loop_start_;
+    if (duration > loop_max_) {
+        loop_max_ = duration;
+    }
+    ++loops_;
+}
+
+void Diagnostics::receiveStart(uint8_t) {
+    // Each receive starts when the previous one ended so the clock is read
+    // once per node.
+    receive_start_ = last_;
+    nested_ = 0;
+    receiving_ = true;
+}
+
+void Diagnostics::receiveEnd(uint8_t node) {
+    last_ = clock_->micros();
+    receiving_ = false;
+    if (node >= count_) {
+        return;
+    }
+    uint32_t duration = last_ - receive_start_ - nested_;
+    if (duration > stats_[node].receive_max) {
+        stats_[node].receive_max = duration;
+    }
+}
+
+void Diagnostics::broadcast(uint8_t, const Frame& frame) {
+    ++frames_in_;
+    IdStats* stats = findId(frame.id);
+    if (stats != nullptr && stats->in < 0xFFFF) {
+        ++stats->in;
+    }
+}
+
+void Diagnostics::sendStart(uint8_t, const Frame& frame) {
+    ++frames_out_;
+    IdStats* stats = findId(frame.id);
+    if (stats != nullptr && stats->out < 0xFFFF) {
+        ++stats->out;
+    }
+    send_start_ = clock_->micros();
+}
+
+void Diagnostics::sendEnd(uint8_t node) {
+    last_ = clock_->micros();
+    uint32_t duration = last_ - send_start_;
+    if (receiving_) {
+        nested_ += duration;
+    }
+    if (node < count_ && duration > stats_[node].send_max) {
+        stats_[node].send_max = duration;
+    }
+}
+
+Diagnostics::IdStats* Diagnostics::findId(uint32_t id) {
+    bool added;
+    IdStats* stats = ids_.insert(id, &added);
+    if (added) {
+        stats->in = 0;
+        stats->out = 0;
+    }
+    return stats;
+}
+
+void Diagnostics::reset() {
+    memset(stats_, 0, sizeof(stats_));
+    for (uint8_t i = 0; i < DIAGNOSTICS_ID_SLOTS; i++) {
+        ids_[i].in = 0;
+        ids_[i].out = 0;
+    }
+    loops_ = 0;
+    loop_max_ = 0;
+    frames_in_ = 0;
+    frames_out_ = 0;
+}
+
+void Diagnostics::receive(const Broadcast& broadcast) {
+    if (!timer_.expired()) {
+        return;
+    }
+
+    uint32_t now = timers_->now();
+    uint32_t elapsed = now - period_start_;
+    period_start_ = now;
+
+    uint32_t dropped = 0;
+    for (uint8_t i = 0; i < count_; i++) {
+        dropped += nodes_[i]->dropped();
+    }
+
+    initFrame(&frame_, DIAGNOSTICS_FRAME_ID, 16);
+    setLE16(frame_.data, perSecond(loops_, elapsed));
+    setLE16(frame_.data + 2, loop_max_);
+    setLE16(frame_.data + 4, perSecond(frames_in_, elapsed));
+    setLE16(frame_.data + 6, perSecond(frames_out_, elapsed));
+    setLE32(frame_.data + 8, dropped);
+    frame_.data[12] = count_;
+    frame_.data[13] = ids_.count();
+
+    // Report the next tracked ID in turn.
+    Frame id_frame;
+    id_frame.len = 0;
+    for (uint8_t i = 0; i < DIAGNOSTICS_ID_SLOTS; i++) {
+        IdStats* id = &ids_[id_cursor_];
+        id_cursor_ = (id_cursor_ + 1) & (DIAGNOSTICS_ID_SLOTS - 1);
+        if (id->used) {
+            initFrame(&id_frame, DIAGNOSTICS_ID_FRAME_ID, 8);
+            setLE32(id_frame.data, id->id);
+            setLE16(id_frame.data + 4, perSecond(id->in, elapsed));
+            setLE16(id_frame.data + 6, perSecond(id->out, elapsed));
+            break;
+        }
+    }
+
+    // Frames broadcast below are counted in the next period.
+    NodeStats stats[DIAGNOSTICS_MAX_NODES];
+    memcpy(stats, stats_, sizeof(stats));
+    reset();
+
+    broadcast(frame_);
+
+    for (uint8_t i = 0; i < count_; i++) {
+        initFrame(&frame_, DIAGNOSTICS_NODE_FRAME_ID + i, 8);
+        setLE16(frame_.data, stats[i].receive_max);
+        setLE16(frame_.data + 2, stats[i].send_max);
+        setLE16(frame_.data + 4, nodes_[i]->dropped());
+        if (node_sizes_ != nullptr) {
+            setLE16(frame_.data + 6, node_sizes_[i]);
+        }
+        broadcast(frame_);
+    }
+
+    if (id_frame.len != 0) {
+        broadcast(id_frame);
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef __R51_DIAGNOSTICS__
+#define __R51_DIAGNOSTICS__
+
+#include <Arduino.h>
+
+#include "bus.h"
+#include "clock.h"
+#include "config.h"
+#include "id_table.h"
+#include "timer.h"
+
+
+// Monitors the bus and publishes controller health frames. Attach to the bus
+// as both a node and its monitor. Rates are per second and durations are the
+// worst case in microseconds over the last DIAGNOSTICS_FRAME_HB period. Node
+// receive durations exclude the time spent sending the node's broadcasts to
+// other nodes.
+//
+// Diagnostics Frame: 0x5F00
+//   Bytes 0-1: Loop iterations per second
+//   Bytes 2-3: Worst loop duration
+//   Bytes 4-5: Frames broadcast per second
+//   Bytes 6-7: Frames sent to nodes per second
+//   Bytes 8-11: Total frames dropped by all nodes
+//   Byte 12: Number of nodes
+//   Byte 13: Number of tracked frame IDs
+//   Bytes 14-15: unused
+//
+// Frame ID Diagnostics Frame: 0x5F02
+//   Reports one tracked frame ID per period in turn.
+//   Bytes 0-3: Frame ID
+//   Bytes 4-5: Frames broadcast per second
+//   Bytes 6-7: Frames sent to nodes per second
+//
+// Node Diagnostics Frames: 0x5F10 + node index
+//   Bytes 0-1: Worst receive() duration
+//   Bytes 2-3: Worst send() duration
+//   Bytes 4-5: Frames dropped by the node
+//   Bytes 6-7: Static RAM of the node in bytes or 0 if not set
+//
+// All values are little endian and saturate at their maximum.
+class Diagnostics : public Node, public BusMonitor {
+    public:
+        Diagnostics(TimerWheel* timers = TimerWheel::real(), Clock* clock = Clock::real());
+
+        // Set the static RAM of each node in bus order. The array must have an
+        // entry for every node on the bus and outlive the monitor.
+        void nodeSizes(const uint16_t* sizes) { node_sizes_ = sizes; }
+
+        // Publish diagnostics frames.
+        void receive(const Broadcast& broadcast) override;
+
+        // Does nothing. Frames are counted by the monitor interface.
+        void send(const Frame&) override {}
+
+        // Does not match any frames.
+        bool filter(uint32_t) const override { return false; }
+
+        void attach(Node** nodes, uint8_t count) override;
+        void loopStart() override;
+        void loopEnd() override;
+        void receiveStart(uint8_t node) override;
+        void receiveEnd(uint8_t node) override;
+        void broadcast(uint8_t source, const Frame& frame) override;
+        void sendStart(uint8_t node, const Frame& frame) override;
+        void sendEnd(uint8_t node) override;
+
+    private:
+        struct NodeStats {
+            uint32_t receive_max;
+            uint32_t send_max;
+        };
+
+        struct IdStats {
+            uint32_t id;
+            uint16_t in;
+            uint16_t out;
+            bool used;
+        };
+
+        TimerWheel* timers_;
+        Clock* clock_;
+        Timer timer_;
+        uint32_t period_start_;
+
+        Node** nodes_;
+        const uint16_t* node_sizes_;
+        uint8_t count_;
+        NodeStats stats_[DIAGNOSTICS_MAX_NODES];
+        IdTable<IdStats, DIAGNOSTICS_ID_SLOTS> ids_;
+        uint8_t id_cursor_;
+
+        // Timestamps in microseconds.
+        uint32_t loop_start_;
+        uint32_t last_;
+        uint32_t receive_start_;
+        uint32_t send_start_;
+        uint32_t nested_;
+        bool receiving_;
+
+        // Per period counters.
+        uint32_t loops_;
+        uint32_t loop_max_;
+        uint32_t frames_in_;
+        uint32_t frames_out_;
+
+        Frame frame_;
+
+        IdStats* findId(uint32_t id);
+        void reset();
+};
+
+#endif  // __R51_DIAGNOSTICS__
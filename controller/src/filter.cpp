@@ -0,0 +1,123 @@
+#include "filter.h"
+
+
+static_assert((SERIAL_FILTER_SLOTS & (SERIAL_FILTER_SLOTS - 1)) == 0,
+        "SERIAL_FILTER_SLOTS must be a power of 2");
+
+IdFilter::IdFilter() : count_(0), allow_count_(0) {}
+
+bool IdFilter::allow(uint32_t id, uint32_t mask, uint16_t rate) {
+    return add(id, mask, rate, true);
+}
+
+bool IdFilter::deny(uint32_t id, uint32_t mask) {
+    return add(id, mask, 0, false);
+}
+
+bool IdFilter::add(uint32_t id, uint32_t mask, uint16_t rate, bool allow) {
+    if (count_ >= SERIAL_FILTER_RULES) {
+        return false;
+    }
+    rules_[count_++] = {id & mask, mask, rate, allow};
+    if (allow) {
+        ++allow_count_;
+    }
+    flush();
+    return true;
+}
+
+void IdFilter::clear() {
+    count_ = 0;
+    allow_count_ = 0;
+    flush();
+}
+
+void IdFilter::flush() {
+    cache_.clear();
+}
+
+void IdFilter::evaluate(uint32_t id, bool* match, uint16_t* rate) const {
+    bool allowed = allow_count_ == 0;
+    *rate = 0;
+    for (uint8_t i = 0; i < count_; i++) {
+        const Rule& rule = rules_[i];
+        if ((id & rule.mask) != rule.id) {
+            continue;
+        }
+        if (!rule.allow) {
+            *match = false;
+            return;
+        }
+        if (!allowed) {
+            allowed = true;
+            *rate = rule.rate;
+        }
+    }
+    *match = allowed;
+}
+
+IdFilter::Entry* IdFilter::find(uint32_t id) const {
+    bool added;
+    Entry* entry = cache_.insert(id, &added);
+    if (added) {
+        entry->sent = false;
+        evaluate(id, &entry->match, &entry->rate);
+    }
+    return entry;
+}
+
+bool IdFilter::match(uint32_t id) const {
+    if (count_ == 0) {
+        return true;
+    }
+    Entry* entry = find(id);
+    if (entry == nullptr) {
+        bool match;
+        uint16_t rate;
+        evaluate(id, &match, &rate);
+        return match;
+    }
+    return entry->match;
+}
+
+bool IdFilter::pass(uint32_t id, uint32_t now) {
+    if (count_ == 0) {
+        return true;
+    }
+    Entry* entry = find(id);
+    if (entry == nullptr) {
+        // The cache is full. Check the rules without probing it again.
+        bool match;
+        uint16_t rate;
+        evaluate(id, &match, &rate);
+        return match;
+    }
+    if (!entry->match) {
+        return false;
+    }
+    if (entry->rate == 0) {
+        return true;
+    }
+    if (entry->sent && now - entry->last < entry->rate) {
+        return false;
+    }
+    entry->sent = true;
+    entry->last = now;
+    return true;
+}
+
+void IdFilter::print(Print* out) const {
+    for (uint8_t i = 0; i < count_; i++) {
+        const Rule& rule = rules_[i];
+        out->print(rule.allow ? "filter: allow " : "filter: deny ");
+        out->print(rule.id, HEX);
+        out->print("/");
+        out->print(rule.mask, HEX);
+        if (rule.rate != 0) {
+            out->print(" every ");
+            out->print(rule.rate);
+            out->print("ms");
+        }
+        out->println();
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef __R51_FILTER__
+#define __R51_FILTER__
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "id_table.h"
+
+
+// Runtime allow and deny lists of ID/mask pairs. An ID matches a rule when
+// (id & mask) == (rule id & mask). An ID passes the filter if it matches no
+// deny rule and either the allow list is empty or it matches an allow rule.
+// Allow rules may limit matching IDs to one frame every rate ms.
+//
+// Decisions are cached per ID in a hash table so repeated lookups of an ID
+// are a single probe. The cache is cleared whenever the rules change. IDs
+// which do not fit in the cache are checked against the rules on every lookup
+// and are not rate limited.
+class IdFilter {
+    public:
+        IdFilter();
+
+        // Add an allow rule. A rate of 0 does not limit the rate. Return
+        // false if the rule list is full.
+        bool allow(uint32_t id, uint32_t mask = 0xFFFFFFFF, uint16_t rate = 0);
+
+        // Add a deny rule. Return false if the rule list is full.
+        bool deny(uint32_t id, uint32_t mask = 0xFFFFFFFF);
+
+        // Remove all rules. All IDs pass.
+        void clear();
+
+        // Return true if the ID passes the filter.
+        bool match(uint32_t id) const;
+
+        // Return true if a frame with the ID may be sent at time now in ms.
+        // Records the send for rate limiting. Should be called after match().
+        bool pass(uint32_t id, uint32_t now);
+
+        // Write the rules in text form.
+        void print(Print* out) const;
+
+        // The number of rules.
+        uint8_t count() const { return count_; }
+
+    private:
+        struct Rule {
+            uint32_t id;
+            uint32_t mask;
+            uint16_t rate;
+            bool allow;
+        };
+
+        struct Entry {
+            uint32_t id;
+            uint32_t last;
+            uint16_t rate;
+            bool used;
+            bool match;
+            bool sent;
+        };
+
+        Rule rules_[SERIAL_FILTER_RULES];
+        uint8_t count_;
+        uint8_t allow_count_;
+
+        // Filled on lookup by the const match() method.
+        mutable IdTable<Entry, SERIAL_FILTER_SLOTS> cache_;
+
+        bool add(uint32_t id, uint32_t mask, uint16_t rate, bool allow);
+        void evaluate(uint32_t id, bool* match, uint16_t* rate) const;
+        Entry* find(uint32_t id) const;
+        void flush();
+};
+
+#endif  // __R51_FILTER__
@@ -0,0 +1,66 @@
+#include "hex.h"
+
+
+static const char kHexDigits[] = "0123456789ABCDEF";
+
+// Value of each character as a hex digit or -1.
+static const int8_t kHexValues[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+int8_t hexValue(char c) {
+    return kHexValues[(uint8_t)c];
+}
+
+int16_t hexByte(const char* p) {
+    int8_t hi = kHexValues[(uint8_t)p[0]];
+    int8_t lo = kHexValues[(uint8_t)p[1]];
+    if ((hi | lo) < 0) {
+        return -1;
+    }
+    return (hi << 4) | lo;
+}
+
+char* writeHex(char* p, uint32_t value, uint8_t digits) {
+    for (int8_t i = digits - 1; i >= 0; i--) {
+        p[i] = kHexDigits[value & 0x0F];
+        value >>= 4;
+    }
+    return p + digits;
+}
+
+char* writeHexBytes(char* p, const byte* data, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) {
+        *p++ = kHexDigits[data[i] >> 4];
+        *p++ = kHexDigits[data[i] & 0x0F];
+    }
+    return p;
+}
+
+char* writeHexTrimmed(char* p, uint32_t value) {
+    uint8_t digits = value == 0 ? 1 : (35 - __builtin_clz(value)) / 4;
+    return writeHex(p, value, digits);
+}
+
+char* writeDecimal(char* p, uint32_t value, uint8_t width) {
+    for (int8_t i = width - 1; i >= 0; i--) {
+        p[i] = '0' + value % 10;
+        value /= 10;
+    }
+    return p + width;
+}
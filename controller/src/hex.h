@@ -0,0 +1,35 @@
+#ifndef __R51_HEX_H__
+#define __R51_HEX_H__
+
+#include <Arduino.h>
+
+
+// Hex and decimal conversion for the text protocols. Decoding is a table
+// lookup per digit and encoding writes into a caller provided buffer so a
+// whole frame can be written to a stream at once.
+
+// Return the value of a hex digit or -1 if c is not a hex digit. Accepts upper
+// and lower case.
+int8_t hexValue(char c);
+
+// Return the value of the two hex digits at p or -1 if either is not a hex
+// digit.
+int16_t hexByte(const char* p);
+
+// Write the low digits nibbles of value as uppercase hex. Return a pointer to
+// the character after the last digit.
+char* writeHex(char* p, uint32_t value, uint8_t digits);
+
+// Write value as uppercase hex without leading zeros. Zero is written as a
+// single digit. Return a pointer to the character after the last digit.
+char* writeHexTrimmed(char* p, uint32_t value);
+
+// Write bytes as uppercase hex with two digits per byte. Return a pointer to
+// the character after the last digit.
+char* writeHexBytes(char* p, const byte* data, uint8_t len);
+
+// Write value as a zero padded decimal number of width digits. Return a
+// pointer to the character after the last digit.
+char* writeDecimal(char* p, uint32_t value, uint8_t width);
+
+#endif  // __R51_HEX_H__
@@ -0,0 +1,83 @@
+#ifndef __R51_ID_TABLE__
+#define __R51_ID_TABLE__
+
+#include <Arduino.h>
+
+
+// Fixed size hash table of entries keyed by frame ID. Uses open addressing
+// with linear probing so a lookup of a stored ID is usually a single probe.
+// Entries are only removed by clearing the whole table.
+//
+// Entry must have a uint32_t id and a bool used member. Other members of a
+// new entry are left as they were and should be set by the caller when the
+// entry is added. SLOTS must be a power of 2.
+template <typename Entry, size_t SLOTS>
+class IdTable {
+    public:
+        static_assert((SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of 2");
+        static_assert(SLOTS <= 256, "SLOTS must be at most 256");
+
+        IdTable() { clear(); }
+
+        // Return the entry for the ID or nullptr if it is not stored.
+        Entry* find(uint32_t id) {
+            return probe(id, false, nullptr);
+        }
+
+        // Return the entry for the ID and add it if it is not stored. Sets
+        // added if the entry is new. Return nullptr if the table is full.
+        Entry* insert(uint32_t id, bool* added = nullptr) {
+            return probe(id, true, added);
+        }
+
+        // Remove all entries.
+        void clear() {
+            for (size_t i = 0; i < SLOTS; i++) {
+                entries_[i].used = false;
+            }
+            count_ = 0;
+        }
+
+        // The number of stored IDs.
+        size_t count() const { return count_; }
+
+        // The number of slots.
+        static constexpr size_t slots() { return SLOTS; }
+
+        // The entry in the given slot. Check used before reading it.
+        Entry& operator[](size_t slot) { return entries_[slot]; }
+        const Entry& operator[](size_t slot) const { return entries_[slot]; }
+
+    private:
+        Entry entries_[SLOTS];
+        uint16_t count_;
+
+        Entry* probe(uint32_t id, bool insert, bool* added) {
+            if (added != nullptr) {
+                *added = false;
+            }
+            size_t slot = ((id * 2654435761u) >> 24) & (SLOTS - 1);
+            for (size_t i = 0; i < SLOTS; i++) {
+                Entry* entry = &entries_[slot];
+                if (entry->used && entry->id == id) {
+                    return entry;
+                }
+                if (!entry->used) {
+                    if (!insert) {
+                        return nullptr;
+                    }
+                    entry->used = true;
+                    entry->id = id;
+                    ++count_;
+                    if (added != nullptr) {
+                        *added = true;
+                    }
+                    return entry;
+                }
+                slot = (slot + 1) & (SLOTS - 1);
+            }
+            return nullptr;
+        }
+};
+
+#endif  // __R51_ID_TABLE__
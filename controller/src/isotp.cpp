@@ -0,0 +1,244 @@
+#include "isotp.h"
+
+#include "debug.h"
+
+#define LOG_MODULE LOG_SETTINGS
+
+
+// Protocol control information types. Stored in the high nibble of byte 0.
+enum IsoTpFrameType : uint8_t {
+    ISOTP_SINGLE = 0x00,
+    ISOTP_FIRST = 0x10,
+    ISOTP_CONSECUTIVE = 0x20,
+    ISOTP_FLOW_CONTROL = 0x30,
+};
+
+// Flow control status. Stored in the low nibble of byte 0.
+enum IsoTpFlowStatus : uint8_t {
+    ISOTP_CONTINUE = 0x00,
+    ISOTP_WAIT = 0x01,
+    ISOTP_OVERFLOW = 0x02,
+};
+
+// Convert an STmin byte to microseconds. Values up to 0x7F are milliseconds
+// and 0xF1 to 0xF9 are multiples of 100us. Reserved values are treated as the
+// maximum.
+inline uint32_t stMinMicros(uint8_t st_min) {
+    if (st_min <= 0x7F) {
+        return st_min * 1000;
+    } else if (st_min >= 0xF1 && st_min <= 0xF9) {
+        return (st_min - 0xF0) * 100;
+    }
+    return 0x7F * 1000;
+}
+
+// Reset a frame for transmission. All data bytes are padded with 0xFF.
+inline void initPaddedFrame(Frame* frame, uint32_t id) {
+    frame->id = id;
+    frame->len = 8;
+    memset(frame->data, 0xFF, 8);
+}
+
+IsoTp::IsoTp(uint32_t tx_id, uint32_t rx_id, uint8_t block_size, uint8_t st_min,
+        uint32_t timeout, TimerWheel* timers) :
+        tx_id_(tx_id), rx_id_(rx_id), block_size_(block_size), st_min_(st_min),
+        timeout_(timeout), timers_(timers), tx_state_(TX_IDLE), tx_len_(0),
+        tx_offset_(0), tx_seq_(0), tx_block_(0), tx_block_size_(0), tx_gap_(0),
+        tx_st_min_(0), tx_last_(0), tx_last_us_(0), rx_state_(RX_IDLE), rx_len_(0), rx_expect_(0),
+        rx_offset_(0), rx_seq_(0), rx_block_(0), rx_status_(ISOTP_CONTINUE),
+        rx_last_(0) {}
+
+bool IsoTp::write(const byte* data, uint16_t len) {
+    if (tx_state_ != TX_IDLE) {
+        return false;
+    }
+    if (len == 0 || len > kMaxLength) {
+        ERROR_MSG_VAL("isotp: invalid message length ", len);
+        return false;
+    }
+    memcpy(tx_, data, len);
+    tx_len_ = len;
+    tx_offset_ = 0;
+    tx_state_ = TX_START;
+    return true;
+}
+
+bool IsoTp::receive(Frame* frame) {
+    if (tx_state_ == TX_IDLE && rx_state_ == RX_IDLE) {
+        return false;
+    }
+    uint32_t now = timers_->now();
+
+    // flow control takes priority so the peer is not kept waiting
+    if (rx_state_ == RX_SEND_FC) {
+        fillFlowControl(frame);
+        rx_last_ = now;
+        rx_state_ = rx_status_ == ISOTP_OVERFLOW ? RX_IDLE : RX_CONSECUTIVE;
+        return true;
+    }
+    if (rx_state_ == RX_CONSECUTIVE && now - rx_last_ >= timeout_) {
+        ERROR_MSG_VAL_FMT("isotp: consecutive frame timeout: ", rx_id_, HEX);
+        rx_state_ = RX_IDLE;
+    }
+
+    uint8_t n;
+    switch (tx_state_) {
+        case TX_IDLE:
+            return false;
+        case TX_START:
+            initPaddedFrame(frame, tx_id_);
+            if (tx_len_ <= 7) {
+                frame->data[0] = ISOTP_SINGLE | tx_len_;
+                memcpy(frame->data + 1, tx_, tx_len_);
+                tx_state_ = TX_IDLE;
+            } else {
+                frame->data[0] = ISOTP_FIRST | ((tx_len_ >> 8) & 0x0F);
+                frame->data[1] = tx_len_ & 0xFF;
+                memcpy(frame->data + 2, tx_, 6);
+                tx_offset_ = 6;
+                tx_seq_ = 1;
+                tx_last_ = now;
+                tx_state_ = TX_WAIT_FC;
+            }
+            return true;
+        case TX_WAIT_FC:
+            if (now - tx_last_ >= timeout_) {
+                ERROR_MSG_VAL_FMT("isotp: flow control timeout: ", tx_id_, HEX);
+                tx_state_ = TX_IDLE;
+            }
+            return false;
+        case TX_CONSECUTIVE:
+            if (timers_->micros() - tx_last_us_ < tx_gap_) {
+                return false;
+            }
+            initPaddedFrame(frame, tx_id_);
+            frame->data[0] = ISOTP_CONSECUTIVE | tx_seq_;
+            n = tx_len_ - tx_offset_ < 7 ? tx_len_ - tx_offset_ : 7;
+            memcpy(frame->data + 1, tx_ + tx_offset_, n);
+            tx_offset_ += n;
+            tx_seq_ = (tx_seq_ + 1) & 0x0F;
+            tx_last_ = now;
+            tx_last_us_ = timers_->micros();
+            tx_gap_ = tx_st_min_;
+            if (tx_offset_ >= tx_len_) {
+                tx_state_ = TX_IDLE;
+            } else if (tx_block_size_ != 0 && --tx_block_ == 0) {
+                tx_state_ = TX_WAIT_FC;
+            }
+            return true;
+    }
+    return false;
+}
+
+bool IsoTp::send(const Frame& frame) {
+    if (frame.id != rx_id_ || frame.len == 0) {
+        return false;
+    }
+
+    uint8_t n;
+    switch (frame.data[0] & 0xF0) {
+        case ISOTP_SINGLE:
+            n = frame.data[0] & 0x0F;
+            if (n == 0 || n > 7 || n > frame.len - 1) {
+                ERROR_MSG_FRAME("isotp: invalid single frame: ", frame);
+                return false;
+            }
+            memcpy(rx_, frame.data + 1, n);
+            rx_len_ = n;
+            rx_state_ = RX_IDLE;
+            return true;
+        case ISOTP_FIRST:
+            if (frame.len < 8) {
+                return false;
+            }
+            rx_expect_ = ((frame.data[0] & 0x0F) << 8) | frame.data[1];
+            if (rx_expect_ < 8) {
+                ERROR_MSG_FRAME("isotp: invalid first frame: ", frame);
+                rx_state_ = RX_IDLE;
+                return false;
+            }
+            rx_state_ = RX_SEND_FC;
+            if (rx_expect_ > kMaxLength) {
+                ERROR_MSG_VAL("isotp: message too long: ", rx_expect_);
+                rx_status_ = ISOTP_OVERFLOW;
+                return false;
+            }
+            memcpy(rx_, frame.data + 2, 6);
+            rx_offset_ = 6;
+            rx_seq_ = 1;
+            rx_block_ = 0;
+            rx_status_ = ISOTP_CONTINUE;
+            return false;
+        case ISOTP_CONSECUTIVE:
+            if (rx_state_ != RX_CONSECUTIVE) {
+                return false;
+            }
+            if ((frame.data[0] & 0x0F) != rx_seq_) {
+                ERROR_MSG_FRAME("isotp: out of sequence frame: ", frame);
+                rx_state_ = RX_IDLE;
+                return false;
+            }
+            n = rx_expect_ - rx_offset_ < 7 ? rx_expect_ - rx_offset_ : 7;
+            if (n > frame.len - 1) {
+                n = frame.len - 1;
+            }
+            memcpy(rx_ + rx_offset_, frame.data + 1, n);
+            rx_offset_ += n;
+            rx_seq_ = (rx_seq_ + 1) & 0x0F;
+            rx_last_ = timers_->now();
+            if (rx_offset_ >= rx_expect_) {
+                rx_len_ = rx_expect_;
+                rx_state_ = RX_IDLE;
+                return true;
+            }
+            if (block_size_ != 0 && ++rx_block_ >= block_size_) {
+                rx_block_ = 0;
+                rx_state_ = RX_SEND_FC;
+            }
+            return false;
+        case ISOTP_FLOW_CONTROL:
+            handleFlowControl(frame);
+            return false;
+        default:
+            return false;
+    }
+}
+
+bool IsoTp::busy() const {
+    return tx_state_ != TX_IDLE || rx_state_ != RX_IDLE;
+}
+
+void IsoTp::reset() {
+    tx_state_ = TX_IDLE;
+    rx_state_ = RX_IDLE;
+}
+
+void IsoTp::fillFlowControl(Frame* frame) {
+    initPaddedFrame(frame, tx_id_);
+    frame->data[0] = ISOTP_FLOW_CONTROL | rx_status_;
+    frame->data[1] = block_size_;
+    frame->data[2] = st_min_;
+}
+
+void IsoTp::handleFlowControl(const Frame& frame) {
+    if (tx_state_ != TX_WAIT_FC || frame.len < 3) {
+        return;
+    }
+    switch (frame.data[0] & 0x0F) {
+        case ISOTP_CONTINUE:
+            tx_block_size_ = frame.data[1];
+            tx_block_ = frame.data[1];
+            tx_st_min_ = stMinMicros(frame.data[2]);
+            tx_gap_ = 0;
+            tx_state_ = TX_CONSECUTIVE;
+            break;
+        case ISOTP_WAIT:
+            tx_last_ = timers_->now();
+            break;
+        case ISOTP_OVERFLOW:
+        default:
+            ERROR_MSG_FRAME("isotp: transfer aborted by peer: ", frame);
+            tx_state_ = TX_IDLE;
+            break;
+    }
+}
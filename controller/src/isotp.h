@@ -0,0 +1,105 @@
+#ifndef __R51_ISOTP__
+#define __R51_ISOTP__
+
+#include <Arduino.h>
+
+#include "bus.h"
+#include "timer.h"
+
+
+// ISO 15765-2 (ISO-TP) transport for a single request/response channel.
+// Segments outgoing messages into single, first, and consecutive frames and
+// reassembles incoming frames into whole messages. Flow control frames are
+// generated and honored automatically.
+//
+// This is not a bus node. It is owned by a node which forwards frames for the
+// channel to it and broadcasts the frames it produces. All frames are padded
+// to 8 bytes with 0xFF.
+class IsoTp {
+    public:
+        // The maximum message length in either direction.
+        static const uint16_t kMaxLength = 64;
+
+        // Create a transport which transmits on tx_id and receives on rx_id.
+        // Block size and STmin are sent to the peer in flow control frames
+        // when it transmits a segmented message. A block size of 0 requests
+        // all consecutive frames without further flow control. The timeout is
+        // the maximum wait in milliseconds for the next flow control or
+        // consecutive frame of a segmented message. Time is read from the
+        // tick sampled by the timer wheel at the start of the loop.
+        IsoTp(uint32_t tx_id, uint32_t rx_id, uint8_t block_size = 0, uint8_t st_min = 0,
+                uint32_t timeout = 1000, TimerWheel* timers = TimerWheel::real());
+
+        // Queue a message for transmission. Return false if a message is
+        // already being transmitted or the message is too long.
+        bool write(const byte* data, uint16_t len);
+
+        // Fill the next frame to transmit. Return true if the frame should be
+        // sent or false if there is nothing to send.
+        bool receive(Frame* frame);
+
+        // Process a frame received from the peer. Return true when a complete
+        // message has been received. Frames with other IDs are ignored.
+        bool send(const Frame& frame);
+
+        // The most recently received message. Valid until the next frame is
+        // sent to the transport.
+        const byte* message() const { return rx_; }
+
+        // The length of the most recently received message.
+        uint16_t length() const { return rx_len_; }
+
+        // Return true if a message is being transmitted or received.
+        bool busy() const;
+
+        // Abort all transfers.
+        void reset();
+
+    private:
+        enum TxState : uint8_t {
+            TX_IDLE,
+            TX_START,
+            TX_WAIT_FC,
+            TX_CONSECUTIVE,
+        };
+
+        enum RxState : uint8_t {
+            RX_IDLE,
+            RX_SEND_FC,
+            RX_CONSECUTIVE,
+        };
+
+        const uint32_t tx_id_;
+        const uint32_t rx_id_;
+        const uint8_t block_size_;
+        const uint8_t st_min_;
+        const uint32_t timeout_;
+        TimerWheel* timers_;
+
+        TxState tx_state_;
+        byte tx_[kMaxLength];
+        uint16_t tx_len_;
+        uint16_t tx_offset_;
+        uint8_t tx_seq_;
+        uint8_t tx_block_;
+        uint8_t tx_block_size_;
+        uint32_t tx_gap_;
+        uint32_t tx_st_min_;
+        uint32_t tx_last_;
+        uint32_t tx_last_us_;
+
+        RxState rx_state_;
+        byte rx_[kMaxLength];
+        uint16_t rx_len_;
+        uint16_t rx_expect_;
+        uint16_t rx_offset_;
+        uint8_t rx_seq_;
+        uint8_t rx_block_;
+        uint8_t rx_status_;
+        uint32_t rx_last_;
+
+        void fillFlowControl(Frame* frame);
+        void handleFlowControl(const Frame& frame);
+};
+
+#endif  // __R51_ISOTP__
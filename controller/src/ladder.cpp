@@ -0,0 +1,54 @@
+#include "ladder.h"
+
+
+void LadderInput::setTable(const uint8_t* masks, uint16_t size, uint16_t debounce) {
+    masks_ = masks;
+    size_ = size;
+    boundaries_ = nullptr;
+    count_ = 0;
+    debounce_ = debounce;
+}
+
+void LadderInput::setBoundaries(const uint16_t* boundaries, uint8_t count, uint16_t debounce) {
+    boundaries_ = boundaries;
+    count_ = count;
+    debounce_ = debounce;
+}
+
+uint8_t LadderInput::decodeBoundaries(uint16_t value) const {
+    for (uint8_t i = 0; i < count_; i++) {
+        if (value < boundaries_[i]) {
+            return 1 << i;
+        }
+    }
+    return 0;
+}
+
+void LadderInput::reset() {
+    pressed_ = 0;
+    on_press_ = 0;
+    on_release_ = 0;
+    candidate_ = 0;
+}
+
+bool LadderInput::update(uint16_t value, uint32_t now) {
+    on_press_ = 0;
+    on_release_ = 0;
+
+    uint8_t mask = decode(value);
+    if (mask != candidate_) {
+        candidate_ = mask;
+        candidate_time_ = now;
+    }
+    if (candidate_ == pressed_ || now - candidate_time_ <= debounce_) {
+        return false;
+    }
+
+    on_press_ = candidate_ & ~pressed_;
+    on_release_ = pressed_ & ~candidate_;
+    if (candidate_ != 0) {
+        press_time_ = now;
+    }
+    pressed_ = candidate_;
+    return true;
+}
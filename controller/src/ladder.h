@@ -0,0 +1,179 @@
+#ifndef __R51_LADDER__
+#define __R51_LADDER__
+
+#include <Arduino.h>
+
+
+// A single level on a resistor ladder. The value is the analog reading when
+// the buttons in the mask are held down. Ladders which produce a distinct
+// reading when several buttons are held may list those combinations as
+// additional levels with more than one bit set in the mask.
+struct LadderLevel {
+    int value;
+    uint8_t mask;
+};
+
+// Lookup table from analog reading to the mask of pressed buttons. Generated
+// at compile time with makeLadderTable so decoding a reading is a single
+// array access.
+template <size_t N>
+struct LadderTable {
+    uint8_t masks[N];
+
+    // Return the mask of buttons pressed for an analog reading. Readings
+    // outside of the table return 0.
+    uint8_t decode(uint16_t value) const {
+        return value < N ? masks[value] : 0;
+    }
+};
+
+namespace ladder {
+
+// Compile time integer sequence. Built by doubling so the template depth is
+// logarithmic in the table size.
+template <size_t... I>
+struct Sequence {};
+
+template <typename, typename>
+struct Concat;
+
+template <size_t... A, size_t... B>
+struct Concat<Sequence<A...>, Sequence<B...>> {
+    typedef Sequence<A..., (sizeof...(A) + B)...> type;
+};
+
+template <size_t N>
+struct MakeSequence {
+    typedef typename Concat<
+        typename MakeSequence<N / 2>::type,
+        typename MakeSequence<N - N / 2>::type>::type type;
+};
+
+template <>
+struct MakeSequence<0> {
+    typedef Sequence<> type;
+};
+
+template <>
+struct MakeSequence<1> {
+    typedef Sequence<0> type;
+};
+
+// Return the boundary between level i and the next. Readings below the
+// boundary belong to level i. The last level extends halfway to full scale.
+constexpr int boundary(const int* values, size_t count, size_t full_scale, size_t i) {
+    return (values[i] + (i + 1 < count ? values[i + 1] : (int)full_scale)) / 2;
+}
+
+constexpr int boundary(const LadderLevel* levels, size_t count, size_t full_scale, size_t i) {
+    return (levels[i].value + (i + 1 < count ? levels[i + 1].value : (int)full_scale)) / 2;
+}
+
+// Return the mask for a reading. Values are button indexes so the mask for
+// value i is bit i.
+constexpr uint8_t mask(const int* values, size_t count, size_t full_scale, size_t code, size_t i = 0) {
+    return i >= count ? 0 :
+        (int)code < boundary(values, count, full_scale, i) ? (uint8_t)(1 << i) :
+        mask(values, count, full_scale, code, i + 1);
+}
+
+constexpr uint8_t mask(const LadderLevel* levels, size_t count, size_t full_scale, size_t code, size_t i = 0) {
+    return i >= count ? 0 :
+        (int)code < boundary(levels, count, full_scale, i) ? levels[i].mask :
+        mask(levels, count, full_scale, code, i + 1);
+}
+
+template <typename T, size_t... I>
+constexpr LadderTable<sizeof...(I)> makeTable(const T* levels, size_t count, Sequence<I...>) {
+    return LadderTable<sizeof...(I)>{{mask(levels, count, sizeof...(I), I)...}};
+}
+
+}  // namespace ladder
+
+// Build a lookup table for a ladder with the given button values in
+// ascending order. N is the analog resolution. Readings are assigned to the
+// closest value using the same boundaries as AnalogMultiButton.
+template <size_t N>
+constexpr LadderTable<N> makeLadderTable(const int* values, size_t count) {
+    return ladder::makeTable(values, count, typename ladder::MakeSequence<N>::type());
+}
+
+// Build a lookup table for a ladder with the given levels in ascending order
+// of value.
+template <size_t N>
+constexpr LadderTable<N> makeLadderTable(const LadderLevel* levels, size_t count) {
+    return ladder::makeTable(levels, count, typename ladder::MakeSequence<N>::type());
+}
+
+// Debounces the buttons on a single resistor ladder. A new button mask must
+// be read continuously for longer than the debounce duration before it
+// replaces the pressed buttons.
+class LadderInput {
+    public:
+        static const uint16_t kDefaultDebounce = 20;
+
+        // Create an input which decodes readings with the given table.
+        template <size_t N>
+        LadderInput(const LadderTable<N>* table, uint16_t debounce = kDefaultDebounce) :
+            masks_(table->masks), size_(N), boundaries_(nullptr), count_(0),
+            debounce_(debounce), pressed_(0),
+            on_press_(0), on_release_(0), candidate_(0), candidate_time_(0),
+            press_time_(0) {}
+
+        // Replace the lookup table and debounce duration.
+        void setTable(const uint8_t* masks, uint16_t size, uint16_t debounce);
+
+        // Decode readings by comparing them to the boundaries between button
+        // levels instead of a lookup table. Readings below boundaries[i] map
+        // to button i and readings at or above the last boundary map to no
+        // buttons. Used to apply calibrated thresholds without a full table
+        // in RAM. The boundaries must outlive the input.
+        void setBoundaries(const uint16_t* boundaries, uint8_t count, uint16_t debounce);
+
+        // Decode a reading without debouncing.
+        uint8_t decode(uint16_t value) const {
+            if (boundaries_ != nullptr) {
+                return decodeBoundaries(value);
+            }
+            return value < size_ ? masks_[value] : 0;
+        }
+
+        // The current debounce duration.
+        uint16_t debounce() const { return debounce_; }
+
+        // Forget the pressed buttons without reporting a release.
+        void reset();
+
+        // Decode a reading taken at the given time in milliseconds. Return
+        // true if the pressed buttons changed.
+        bool update(uint16_t value, uint32_t now);
+
+        // The buttons currently held down.
+        uint8_t pressed() const { return pressed_; }
+
+        // The buttons pressed by the last update.
+        uint8_t onPress() const { return on_press_; }
+
+        // The buttons released by the last update.
+        uint8_t onRelease() const { return on_release_; }
+
+        // The time the current buttons were pressed.
+        uint32_t pressTime() const { return press_time_; }
+
+    private:
+        const uint8_t* masks_;
+        uint16_t size_;
+        const uint16_t* boundaries_;
+        uint8_t count_;
+        uint16_t debounce_;
+        uint8_t pressed_;
+        uint8_t on_press_;
+        uint8_t on_release_;
+        uint8_t candidate_;
+        uint32_t candidate_time_;
+        uint32_t press_time_;
+
+        uint8_t decodeBoundaries(uint16_t value) const;
+};
+
+#endif  // __R51_LADDER__
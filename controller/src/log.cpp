@@ -0,0 +1,137 @@
+#include "log.h"
+
+#include "config.h"
+
+
+// Bytes before each message which hold its length.
+static const size_t kLogHeaderSize = 2;
+
+LogRing::LogRing(uint8_t* buffer, size_t size) :
+    buffer_(buffer), mask_(size - 1), head_(0), tail_(0), pending_(0),
+    overflow_(false), committed_(0), drained_(0), dropped_(0), reported_(0),
+    room_max_(0), sync_(nullptr) {}
+
+size_t LogRing::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t LogRing::write(const uint8_t* buffer, size_t size) {
+    if (overflow_) {
+        return 0;
+    }
+    // reserve the length header at the start of a message
+    size_t header = pending_ == head_ ? kLogHeaderSize : 0;
+    // one slot is kept free to distinguish full from empty
+    size_t free = mask_ - (pending_ - tail_);
+    if (size + header > free) {
+        overflow_ = true;
+        return 0;
+    }
+    pending_ += header;
+    for (size_t i = 0; i < size; i++) {
+        buffer_[(pending_ + i) & mask_] = buffer[i];
+    }
+    pending_ += size;
+    return size;
+}
+
+bool LogRing::commit() {
+    if (overflow_) {
+        pending_ = head_;
+        overflow_ = false;
+        dropped_ = dropped_ + 1;
+        return false;
+    }
+    if (pending_ != head_) {
+        size_t len = pending_ - head_ - kLogHeaderSize;
+        buffer_[head_ & mask_] = len;
+        buffer_[(head_ + 1) & mask_] = len >> 8;
+        head_ = pending_;
+        committed_ = committed_ + 1;
+    }
+    if (sync_ != nullptr) {
+        flush(sync_);
+    }
+    return true;
+}
+
+size_t LogRing::available() const {
+    return committed_ - drained_;
+}
+
+size_t LogRing::drain(Print* out) {
+    return drain(out, false);
+}
+
+size_t LogRing::flush(Print* out) {
+    return drain(out, true);
+}
+
+void LogRing::sync(Print* out) {
+    sync_ = out;
+    if (sync_ != nullptr) {
+        flush(sync_);
+    }
+}
+
+size_t LogRing::drain(Print* out, bool block) {
+    size_t head = head_;
+    size_t tail = tail_;
+    int room = 0;
+    if (!block) {
+        room = out->availableForWrite();
+        if (room > room_max_) {
+            room_max_ = room;
+        }
+    }
+    size_t n = 0;
+    while (tail != head) {
+        size_t len = buffer_[tail & mask_] | (buffer_[(tail + 1) & mask_] << 8);
+        if (!block && (int)len > room && (int)len <= room_max_) {
+            // wait until the port has room for the whole message
+            break;
+        }
+        tail += kLogHeaderSize;
+        // write contiguous chunks up to the end of the buffer
+        size_t first = mask_ + 1 - (tail & mask_);
+        if (first > len) {
+            first = len;
+        }
+        n += out->write(buffer_ + (tail & mask_), first);
+        if (first < len) {
+            n += out->write(buffer_, len - first);
+        }
+        tail += len;
+        room -= len;
+        ++drained_;
+    }
+    tail_ = tail;
+
+    uint32_t dropped = dropped_;
+    if (tail == head && dropped != reported_) {
+        char msg[40];
+        int len = snprintf(msg, sizeof(msg), "[ERROR] log: dropped %lu\r\n",
+                (unsigned long)(dropped - reported_));
+        if (len > 0 && (block || room >= len)) {
+            n += out->write((const uint8_t*)msg, len);
+            reported_ = dropped;
+        }
+    }
+    return n;
+}
+
+void LogControl::send(const Frame& frame) {
+    if (frame.id != LOG_CONTROL_FRAME_ID || frame.len < 2 || frame.data[1] > LOG_LEVEL_OFF) {
+        return;
+    }
+    LogLevel level = (LogLevel)frame.data[1];
+    if (frame.data[0] == 0xFF) {
+        levels_->set(level);
+    } else if (frame.data[0] < LOG_MODULE_COUNT) {
+        levels_->set((LogModule)frame.data[0], level);
+    }
+}
+
+bool LogControl::filter(uint32_t id) const {
+    return id == LOG_CONTROL_FRAME_ID;
+}
@@ -0,0 +1,152 @@
+#ifndef __R51_LOG__
+#define __R51_LOG__
+
+#include <Arduino.h>
+
+#include "bus.h"
+
+
+// Lock-free single producer, single consumer ring buffer for log messages.
+// Messages are written with the Print interface and published with commit().
+// The main loop drains published messages to a serial port only as fast as the
+// port accepts them without blocking. A message which does not fit in the ring
+// is dropped whole and counted.
+//
+// Messages are stored with a length header and only drained whole so they are
+// never split by other output written to the same port between drains. A
+// message longer than the port's transmit buffer can ever hold is written
+// whole even though the write blocks.
+//
+// The producer owns the write position and the consumer owns the read
+// position. Logging from an interrupt while the main loop is also logging is
+// not supported.
+class LogRing : public Print {
+    public:
+        // Create a ring over the given buffer. Size must be a power of 2. Does
+        // not take ownership of the buffer.
+        LogRing(uint8_t* buffer, size_t size);
+
+        // Append bytes to the current message.
+        size_t write(uint8_t b) override;
+        size_t write(const uint8_t* buffer, size_t size) override;
+        using Print::write;
+
+        // Publish the current message to the consumer. Return false if the
+        // message overflowed the ring and was dropped.
+        bool commit();
+
+        // Write whole published messages to the stream without blocking.
+        // Stops at the first message which does not fit in
+        // availableForWrite(). Reports dropped messages once the ring is
+        // empty. Return the number of bytes written.
+        size_t drain(Print* out);
+
+        // Write all published messages to the stream. Blocks until the port
+        // accepts them. Return the number of bytes written.
+        size_t flush(Print* out);
+
+        // Flush each message to out as soon as it is committed. Used during
+        // setup and other blocking code where the main loop does not drain
+        // the ring. Pass nullptr to return to draining from the main loop.
+        void sync(Print* out);
+
+        // The number of published messages waiting to be drained.
+        size_t available() const;
+
+        // The number of messages dropped since creation.
+        uint32_t dropped() const { return dropped_; }
+
+    private:
+        uint8_t* buffer_;
+        size_t mask_;
+        volatile size_t head_;
+        volatile size_t tail_;
+        size_t pending_;
+        bool overflow_;
+        volatile size_t committed_;
+        size_t drained_;
+        volatile uint32_t dropped_;
+        uint32_t reported_;
+        int room_max_;
+        Print* sync_;
+
+        size_t drain(Print* out, bool block);
+};
+
+// Modules which log messages. Source files set LOG_MODULE to their module
+// before logging.
+enum LogModule : uint8_t {
+    LOG_SYSTEM = 0,
+    LOG_CAN = 1,
+    LOG_REALDASH = 2,
+    LOG_SERIAL = 3,
+    LOG_CLIMATE = 4,
+    LOG_SETTINGS = 5,
+    LOG_STEERING = 6,
+    LOG_MODULE_COUNT,
+};
+
+// Log message levels. Messages at or above the level of their module are
+// logged.
+enum LogLevel : uint8_t {
+    LOG_LEVEL_INFO = 0,
+    LOG_LEVEL_ERROR = 1,
+    LOG_LEVEL_OFF = 2,
+};
+
+// Runtime log level of each module. All modules log at the info level by
+// default.
+class LogLevels {
+    public:
+        LogLevels() { set(LOG_LEVEL_INFO); }
+
+        // Return true if messages at the given level are logged for the
+        // module.
+        bool enabled(LogModule module, LogLevel level) const {
+            return level >= levels_[module];
+        }
+
+        // Return the level of a module.
+        LogLevel level(LogModule module) const {
+            return (LogLevel)levels_[module];
+        }
+
+        // Set the level of a single module.
+        void set(LogModule module, LogLevel level) {
+            levels_[module] = level;
+        }
+
+        // Set the level of all modules.
+        void set(LogLevel level) {
+            memset(levels_, level, LOG_MODULE_COUNT);
+        }
+
+    private:
+        uint8_t levels_[LOG_MODULE_COUNT];
+};
+
+// Changes runtime log levels from a control frame. The frame may be sent over
+// SerialText to adjust logging in the field.
+//
+// Log Control Frame: 0x5F01
+//   Byte 0: Module, see LogModule. 0xFF sets all modules.
+//   Byte 1: Level, see LogLevel.
+//   Bytes 2-7: unused
+class LogControl : public Node {
+    public:
+        LogControl(LogLevels* levels) : levels_(levels) {}
+
+        // Does nothing.
+        void receive(const Broadcast&) override {}
+
+        // Set log levels from control frames.
+        void send(const Frame& frame) override;
+
+        // Matches the log control frame.
+        bool filter(uint32_t id) const override;
+
+    private:
+        LogLevels* levels_;
+};
+
+#endif  // __R51_LOG__
@@ -0,0 +1,103 @@
+#include "loop_monitor.h"
+
+#include "debug.h"
+#include "memory.h"
+
+#define LOG_MODULE LOG_SYSTEM
+
+
+// Marks valid state. RAM holds random data after power on.
+static const uint32_t kLoopMonitorMagic = 0x57443531;
+
+#if defined(__SAMD51__)
+// Kept across a reset only if the linker script places .noinit outside .data
+// and .bss and below the heap. See retainedOnReset().
+__attribute__((section(".noinit"))) static LoopMonitorState real_state;
+#else
+static LoopMonitorState real_state;
+#endif
+
+LoopMonitorState* LoopMonitorState::real() {
+    return &real_state;
+}
+
+LoopMonitor::LoopMonitor(Watchdog* watchdog, LoopMonitorState* state,
+        TimerWheel* timers, Clock* clock) :
+        watchdog_(watchdog), state_(state), timers_(timers), clock_(clock),
+        reset_cause_(RESET_CAUSE_UNKNOWN), reset_node_(kNoNode), reset_send_node_(kNoNode),
+        loop_start_(0), last_(0), slowest_duration_(0), slowest_(kNoNode),
+        overruns_(0), overrun_node_(kNoNode) {}
+
+void LoopMonitor::begin() {
+    reset_cause_ = watchdog_->resetCause();
+    if (!retainedOnReset(state_, sizeof(*state_))) {
+        ERROR_MSG("watchdog: state is not retained on reset");
+    } else if (reset_cause_ == RESET_CAUSE_WATCHDOG && state_->magic == kLoopMonitorMagic) {
+        reset_node_ = state_->node;
+        reset_send_node_ = state_->send_node;
+        ERROR_MSG_VAL("watchdog: reset while running node ", reset_node_);
+    }
+    state_->magic = kLoopMonitorMagic;
+    state_->node = kNoNode;
+    state_->send_node = kNoNode;
+
+    if (!watchdog_->begin(WATCHDOG_TIMEOUT)) {
+        INFO_MSG("watchdog: not supported");
+    }
+    timers_->startPeriodic(&timer_, WATCHDOG_FRAME_HB);
+}
+
+void LoopMonitor::receive(const Broadcast& broadcast) {
+    if (!timer_.expired()) {
+        return;
+    }
+    initFrame(&frame_, WATCHDOG_FRAME_ID, 8);
+    frame_.data[0] = reset_cause_;
+    frame_.data[1] = reset_node_;
+    frame_.data[2] = reset_send_node_;
+    frame_.data[3] = overrun_node_;
+    frame_.data[4] = overruns_;
+    frame_.data[5] = overruns_ >> 8;
+    frame_.data[6] = overruns_ >> 16;
+    frame_.data[7] = overruns_ >> 24;
+    broadcast(frame_);
+}
+
+void LoopMonitor::loopStart() {
+    // The wheel sampled the clock at the start of the loop.
+    loop_start_ = timers_->micros();
+    last_ = loop_start_;
+    slowest_duration_ = 0;
+    slowest_ = kNoNode;
+}
+
+void LoopMonitor::loopEnd() {
+    watchdog_->feed();
+    if (last_ - loop_start_ > WATCHDOG_LOOP_DEADLINE * 1000) {
+        ++overruns_;
+        overrun_node_ = slowest_;
+        ERROR_MSG_VAL("watchdog: loop deadline missed in node ", slowest_);
+    }
+}
+
+void LoopMonitor::receiveStart(uint8_t node) {
+    state_->node = node;
+}
+
+void LoopMonitor::receiveEnd(uint8_t node) {
+    state_->node = kNoNode;
+    uint32_t now = clock_->micros();
+    if (now - last_ >= slowest_duration_) {
+        slowest_duration_ = now - last_;
+        slowest_ = node;
+    }
+    last_ = now;
+}
+
+void LoopMonitor::sendStart(uint8_t node, const Frame&) {
+    state_->send_node = node;
+}
+
+void LoopMonitor::sendEnd(uint8_t) {
+    state_->send_node = kNoNode;
+}
@@ -0,0 +1,99 @@
+#ifndef __R51_LOOP_MONITOR__
+#define __R51_LOOP_MONITOR__
+
+#include <Arduino.h>
+
+#include "bus.h"
+#include "clock.h"
+#include "config.h"
+#include "timer.h"
+#include "watchdog.h"
+
+
+// Marks the node which was running when the watchdog reset the controller.
+// The real state is placed in RAM which is not cleared by the startup code.
+struct LoopMonitorState {
+    // Return the state which survives a reset.
+    static LoopMonitorState* real();
+
+    uint32_t magic;
+    uint8_t node;
+    uint8_t send_node;
+};
+
+// Feeds the hardware watchdog at the end of every bus loop and checks each
+// loop against a soft deadline. Attach to the bus as both a node and a
+// monitor. The node currently receiving and the node currently being sent a
+// frame are written to state which survives a reset so the node which blocked
+// the loop is known after the watchdog fires. Loops which exceed
+// WATCHDOG_LOOP_DEADLINE ms are counted along with their slowest node.
+//
+// Watchdog Frame: 0x5F05
+//   Byte 0: Cause of the last reset
+//     0: Unknown, 1: Power on, 2: Brown out, 3: External, 4: Watchdog,
+//     5: Software, 6: Other
+//   Byte 1: Node receiving when the watchdog fired or 0xFF
+//   Byte 2: Node being sent a frame when the watchdog fired or 0xFF
+//   Byte 3: Slowest node of the last loop which missed the deadline or 0xFF
+//   Bytes 4-7: Loops which missed the deadline since boot
+//
+// Nodes are identified by their index in the bus. Values are little endian.
+class LoopMonitor : public Node, public BusMonitor {
+    public:
+        // Index reported when no node is running.
+        static const uint8_t kNoNode = 0xFF;
+
+        LoopMonitor(Watchdog* watchdog = Watchdog::real(),
+                LoopMonitorState* state = LoopMonitorState::real(),
+                TimerWheel* timers = TimerWheel::real(), Clock* clock = Clock::real());
+
+        // Read the cause of the last reset and start the watchdog. Blocking
+        // code after this call must complete within WATCHDOG_TIMEOUT ms.
+        void begin();
+
+        // Publish the watchdog frame.
+        void receive(const Broadcast& broadcast) override;
+
+        // Does nothing. The monitor does not accept frames.
+        void send(const Frame&) override {}
+
+        // Does not match any frames.
+        bool filter(uint32_t) const override { return false; }
+
+        void attach(Node**, uint8_t) override {}
+        void loopStart() override;
+        void loopEnd() override;
+        void receiveStart(uint8_t node) override;
+        void receiveEnd(uint8_t node) override;
+        void broadcast(uint8_t, const Frame&) override {}
+        void sendStart(uint8_t node, const Frame&) override;
+        void sendEnd(uint8_t) override;
+
+        ResetCause resetCause() const { return reset_cause_; }
+        uint8_t resetNode() const { return reset_node_; }
+        uint8_t resetSendNode() const { return reset_send_node_; }
+        uint32_t overruns() const { return overruns_; }
+        uint8_t overrunNode() const { return overrun_node_; }
+
+    private:
+        Watchdog* watchdog_;
+        LoopMonitorState* state_;
+        TimerWheel* timers_;
+        Clock* clock_;
+        Timer timer_;
+
+        ResetCause reset_cause_;
+        uint8_t reset_node_;
+        uint8_t reset_send_node_;
+
+        uint32_t loop_start_;
+        uint32_t last_;
+        uint32_t slowest_duration_;
+        uint8_t slowest_;
+        uint32_t overruns_;
+        uint8_t overrun_node_;
+
+        Frame frame_;
+};
+
+#endif  // __R51_LOOP_MONITOR__
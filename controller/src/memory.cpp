@@ -0,0 +1,197 @@
+#include "memory.h"
+
+#include "binary.h"
+#include "debug.h"
+
+#define LOG_MODULE LOG_SYSTEM
+
+
+// Fills free RAM at boot. Words which no longer hold the pattern were written
+// by the stack.
+static const uint32_t kMemoryPaint = 0xA5A5A5A5;
+
+#if defined(__SAMD51__)
+
+#include <malloc.h>
+
+extern "C" {
+// Provided by the linker script. The heap starts at the end of .bss and the
+// stack starts at the end of RAM.
+extern uint32_t __data_start__;
+extern uint32_t __bss_end__;
+extern uint32_t __StackTop;
+// The start of the heap. Required by newlib's sbrk.
+extern uint32_t end;
+
+char* sbrk(int incr);
+}
+
+class Same51MemoryLayout : public MemoryLayout {
+    public:
+        uint8_t* heapEnd() override {
+            return (uint8_t*)sbrk(0);
+        }
+
+        uint8_t* stackTop() override {
+            return (uint8_t*)&__StackTop;
+        }
+
+        uint8_t* stackPointer() override {
+            return (uint8_t*)__get_MSP();
+        }
+
+        uint32_t heapUsed() override {
+            return mallinfo().uordblks;
+        }
+
+        uint32_t staticSize() override {
+            return (uint8_t*)&__bss_end__ - (uint8_t*)&__data_start__;
+        }
+};
+
+Same51MemoryLayout real_layout;
+
+bool retainedOnReset(const void* data, size_t size) {
+    const uint8_t* start = (const uint8_t*)data;
+    const uint8_t* stop = start + size;
+    if (stop <= (uint8_t*)&__data_start__) {
+        return true;
+    }
+    return start >= (uint8_t*)&__bss_end__ && stop <= (uint8_t*)&end;
+}
+
+#else
+
+// Fallback for other boards. The layout is unknown.
+class UnsupportedMemoryLayout : public MemoryLayout {
+    public:
+        uint8_t* heapEnd() override { return nullptr; }
+        uint8_t* stackTop() override { return nullptr; }
+        uint8_t* stackPointer() override { return nullptr; }
+        uint32_t heapUsed() override { return 0; }
+        uint32_t staticSize() override { return 0; }
+};
+
+UnsupportedMemoryLayout real_layout;
+
+bool retainedOnReset(const void*, size_t) {
+    return true;
+}
+
+#endif  // __SAMD51__
+
+MemoryLayout* MemoryLayout::real() {
+    return &real_layout;
+}
+
+MemoryMonitor::MemoryMonitor(MemoryLayout* layout, TimerWheel* timers) :
+        node_sizes_(nullptr), node_count_(0), layout_(layout),
+        timers_(timers), out_(nullptr), report_(false), low_(nullptr),
+        cursor_(nullptr) {}
+
+uint32_t* MemoryMonitor::heapWord() const {
+    return (uint32_t*)(((uintptr_t)layout_->heapEnd() + 3) & ~(uintptr_t)3);
+}
+
+void MemoryMonitor::begin(Print* out) {
+    out_ = out;
+    if (layout_->heapEnd() == nullptr) {
+        INFO_MSG("memory: layout not supported");
+        return;
+    }
+
+    // Leave a margin below the stack pointer for this call and interrupts.
+    uint32_t* start = heapWord();
+    uint32_t* end = (uint32_t*)(((uintptr_t)layout_->stackPointer() - MEMORY_STACK_MARGIN) &
+            ~(uintptr_t)3);
+    for (uint32_t* p = start; p < end; p++) {
+        *p = kMemoryPaint;
+    }
+    low_ = end;
+    cursor_ = start;
+    timers_->startPeriodic(&timer_, MEMORY_FRAME_HB);
+}
+
+void MemoryMonitor::scan() {
+    uint32_t* heap = heapWord();
+    if (cursor_ < heap) {
+        cursor_ = heap;
+    }
+    for (uint16_t i = 0; i < kScanWords; i++) {
+        if (cursor_ >= low_) {
+            cursor_ = heap;
+            return;
+        }
+        if (*cursor_ != kMemoryPaint) {
+            low_ = cursor_;
+            cursor_ = heap;
+            return;
+        }
+        ++cursor_;
+    }
+}
+
+void MemoryMonitor::receive(const Broadcast& broadcast) {
+    if (!supported()) {
+        return;
+    }
+    scan();
+
+    if (report_ && out_ != nullptr) {
+        report(out_);
+    }
+    report_ = false;
+
+    if (!timer_.expired()) {
+        return;
+    }
+    initFrame(&frame_, MEMORY_FRAME_ID, 16);
+    setLE32(frame_.data, stackHighWater());
+    setLE32(frame_.data + 4, layout_->heapUsed());
+    setLE32(frame_.data + 8, freeRam());
+    setLE32(frame_.data + 12, layout_->staticSize());
+    broadcast(frame_);
+}
+
+void MemoryMonitor::send(const Frame& frame) {
+    if (frame.id != MEMORY_CONTROL_FRAME_ID || frame.len < 1) {
+        return;
+    }
+    report_ |= (frame.data[0] & 0x01) != 0;
+}
+
+bool MemoryMonitor::filter(uint32_t id) const {
+    return id == MEMORY_CONTROL_FRAME_ID;
+}
+
+uint32_t MemoryMonitor::stackHighWater() const {
+    if (!supported()) {
+        return 0;
+    }
+    return layout_->stackTop() - (uint8_t*)low_;
+}
+
+uint32_t MemoryMonitor::freeRam() const {
+    if (!supported()) {
+        return 0;
+    }
+    uint8_t* heap = layout_->heapEnd();
+    return (uint8_t*)low_ > heap ? (uint8_t*)low_ - heap : 0;
+}
+
+void MemoryMonitor::report(Print* out) const {
+    out->print("memory: static ");
+    out->print(layout_->staticSize());
+    out->print(" heap ");
+    out->print(layout_->heapUsed());
+    out->print(" stack ");
+    out->print(stackHighWater());
+    out->print(" free ");
+    out->println(freeRam());
+    for (uint8_t i = 0; i < node_count_; i++) {
+        out->print("memory: node ");
+        out->print(i);
+        out->print(" size ");
+        out->println(node_sizes_[i]);
+    }
+}
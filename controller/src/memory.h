@@ -0,0 +1,126 @@
+#ifndef __R51_MEMORY__
+#define __R51_MEMORY__
+
+#include <Arduino.h>
+
+#include "bus.h"
+#include "config.h"
+#include "timer.h"
+
+
+// Base RAM layout interface. Allows the layout to be mocked. The heap grows up
+// from the end of static RAM and the stack grows down from the top of RAM. The
+// real implementation on the SAME51 reads the linker symbols and newlib's
+// allocator. Other boards do not report their layout and return null
+// pointers and zero sizes.
+class MemoryLayout {
+    public:
+        // Return the real layout.
+        static MemoryLayout* real();
+
+        MemoryLayout() = default;
+        virtual ~MemoryLayout() = default;
+
+        // The current end of the heap.
+        virtual uint8_t* heapEnd() = 0;
+
+        // The top of the stack. This is the end of RAM.
+        virtual uint8_t* stackTop() = 0;
+
+        // The current stack pointer.
+        virtual uint8_t* stackPointer() = 0;
+
+        // Bytes allocated from the heap and not yet freed.
+        virtual uint32_t heapUsed() = 0;
+
+        // Bytes of initialized and zeroed static RAM.
+        virtual uint32_t staticSize() = 0;
+};
+
+// Return true if the RAM at data is kept across a reset. The startup code
+// copies .data and zeroes .bss, and MemoryMonitor paints free RAM from the
+// start of the heap, so RAM is only kept if it sits outside .data and .bss and
+// below the heap. Used to check that objects placed in .noinit by the
+// attribute were placed there by the linker script. Always returns true on
+// boards where the layout is not known.
+bool retainedOnReset(const void* data, size_t size);
+
+// Measures RAM use. The free RAM between the heap and the stack is painted
+// with a pattern at boot and scanned for the lowest overwritten word to find
+// the stack high-water mark. The scan is spread over loop iterations so it
+// does not stall the bus.
+//
+// Attach to the bus as a node. The layout and the static RAM of each node are
+// written to the output when requested with the 0x5F07 frame:
+//
+// Memory Control Frame: 0x5F07
+//   Byte 0: Bit 0 writes the report to the output.
+//
+// Memory Frame: 0x5F06
+//   Bytes 0-3: Stack high-water mark
+//   Bytes 4-7: Heap allocated
+//   Bytes 8-11: Free RAM between the heap and the stack high-water mark
+//   Bytes 12-15: Static RAM
+//
+// Values are in bytes and little endian.
+class MemoryMonitor : public Node {
+    public:
+        // Words of free RAM checked per loop.
+        static const uint16_t kScanWords = MEMORY_SCAN_WORDS;
+
+        MemoryMonitor(MemoryLayout* layout = MemoryLayout::real(),
+                TimerWheel* timers = TimerWheel::real());
+
+        // Set the static RAM of each node in bus order. The array must
+        // outlive the monitor.
+        void nodeSizes(const uint16_t* sizes, uint8_t count) {
+            node_sizes_ = sizes;
+            node_count_ = count;
+        }
+
+        // Paint free RAM and write reports to out. This should be called as
+        // early as possible in setup so the stack used by setup is included
+        // in the high-water mark.
+        void begin(Print* out = nullptr);
+
+        // Scan the stack and publish the memory frame.
+        void receive(const Broadcast& broadcast) override;
+
+        // Handle the control frame.
+        void send(const Frame& frame) override;
+
+        // Match the control frame.
+        bool filter(uint32_t id) const override;
+
+        // Return true if the layout is known and RAM was painted.
+        bool supported() const { return low_ != nullptr; }
+
+        // Most bytes of stack used since boot.
+        uint32_t stackHighWater() const;
+
+        // Free bytes between the heap and the stack high-water mark.
+        uint32_t freeRam() const;
+
+        // Write the layout and node sizes to out.
+        void report(Print* out) const;
+
+    private:
+        const uint16_t* node_sizes_;
+        uint8_t node_count_;
+        MemoryLayout* layout_;
+        TimerWheel* timers_;
+        Timer timer_;
+        Print* out_;
+        bool report_;
+
+        // Lowest overwritten word and the next word to check.
+        uint32_t* low_;
+        uint32_t* cursor_;
+
+        Frame frame_;
+
+        uint32_t* heapWord() const;
+        void scan();
+};
+
+#endif  // __R51_MEMORY__
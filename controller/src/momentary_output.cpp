@@ -1,27 +1,47 @@
 #include "momentary_output.h"
 
+#include "debug.h"
+
+#define LOG_MODULE LOG_CLIMATE
+
 
 MomentaryOutput::MomentaryOutput(int pin, uint16_t trigger_ms, int32_t cooldown_ms, bool high,
-        Clock* clock, GPIO* gpio)
-    : clock_(clock), gpio_(gpio),
-      pin_(pin), high_(high), triggered_(false), 
-      trigger_ms_(trigger_ms), trigger_time_(0),
+        TimerWheel* timers, GPIO* gpio, Pulse* pulse)
+    : timers_(timers), gpio_(gpio), pulse_(pulse),
+      pin_(pin), high_(high), hardware_(false), triggered_(false), cooldown_(false),
+      trigger_ms_(trigger_ms),
       cooldown_ms_(cooldown_ms < 0 ? trigger_ms : (uint16_t)cooldown_ms) {
     gpio_->pinMode(pin_, OUTPUT);
     gpio_->digitalWrite(pin_, high_ ? LOW : HIGH);
 }
 
-MomentaryOutput::MomentaryOutput(int pin, uint16_t trigger_ms, Clock* clock, GPIO* gpio)
-    : MomentaryOutput(pin, trigger_ms, -1, true, clock, gpio) {}
+MomentaryOutput::MomentaryOutput(int pin, uint16_t trigger_ms, TimerWheel* timers, GPIO* gpio,
+        Pulse* pulse)
+    : MomentaryOutput(pin, trigger_ms, -1, true, timers, gpio, pulse) {}
 
-void MomentaryOutput::update() {
+bool MomentaryOutput::begin() {
     if (triggered_) {
-        if (clock_->millis() - trigger_time_ >= trigger_ms_ + cooldown_ms_) {
-            triggered_ = false;
-        } else if (clock_->millis() - trigger_time_ >= trigger_ms_) {
-            gpio_->digitalWrite(pin_, high_ ? LOW : HIGH);
-        }
+        return hardware_;
+    }
+    hardware_ = pulse_->begin(pin_, high_);
+    if (!hardware_) {
+        INFO_MSG_VAL("momentary: no pulse timer for pin ", pin_);
+    }
+    return hardware_;
+}
+
+void MomentaryOutput::update() {
+    if (!triggered_ || !timer_.expired()) {
+        return;
     }
+    if (cooldown_) {
+        triggered_ = false;
+        cooldown_ = false;
+        return;
+    }
+    gpio_->digitalWrite(pin_, high_ ? LOW : HIGH);
+    cooldown_ = true;
+    timers_->start(&timer_, cooldown_ms_);
 }
 
 // Trigger the pin. Return true on success or false if the pin is
@@ -31,8 +51,19 @@ bool MomentaryOutput::trigger() {
         return false;
     }
 
+    if (hardware_) {
+        if (!pulse_->trigger(pin_, (uint32_t)trigger_ms_ * 1000)) {
+            return false;
+        }
+        // The pulse ends in hardware so only the cooldown is timed here.
+        triggered_ = true;
+        cooldown_ = true;
+        timers_->start(&timer_, (uint32_t)trigger_ms_ + cooldown_ms_);
+        return true;
+    }
+
     gpio_->digitalWrite(pin_, high_ ? HIGH : LOW);
     triggered_ = true;
-    trigger_time_ = clock_->millis();
+    timers_->start(&timer_, trigger_ms_);
     return true;
 }
@@ -3,12 +3,17 @@
 
 #include <Arduino.h>
 
-#include "clock.h"
 #include "gpio.h"
+#include "pulse.h"
+#include "timer.h"
 
 
 // Momentarily enable a digital output pin for a set amount of time. Most
 // useful for driving external systems which use momentary push button inputs.
+//
+// The pin is driven by software until begin() attaches it to a hardware pulse
+// timer. The hardware pulse ends at exactly trigger_ms regardless of loop
+// latency and update() only tracks the cooldown.
 class MomentaryOutput {
     public:
         // Create a new momentary trigger which controls the given pin. The pin
@@ -19,11 +24,19 @@ class MomentaryOutput {
         // when triggered .The high param can be set to false to drive the pin
         // low instead.
         MomentaryOutput(int pin, uint16_t trigger_ms, 
-                Clock* clock = Clock::real(), GPIO* gpio = GPIO::real());
+                TimerWheel* timers = TimerWheel::real(), GPIO* gpio = GPIO::real(),
+                Pulse* pulse = Pulse::real());
         MomentaryOutput(int pin, uint16_t trigger_ms, int32_t cooldown_ms = -1, bool high = true,
-                Clock* clock = Clock::real(), GPIO* gpio = GPIO::real());
+                TimerWheel* timers = TimerWheel::real(), GPIO* gpio = GPIO::real(),
+                Pulse* pulse = Pulse::real());
 
-        // Update the state of the pin. Must be called in the main loop.
+        // Attach the pin to a hardware pulse timer. Falls back to driving the
+        // pin in software if the pin is not supported. Return true if the
+        // hardware timer is used.
+        bool begin();
+
+        // Update the state of the pin. Must be called in the main loop. Does
+        // nothing until the pulse or cooldown timer expires.
         void update();
 
         // Trigger the pin. Return true on success or false if the pin is
@@ -31,14 +44,17 @@ class MomentaryOutput {
         bool trigger();
 
     private:
-        Clock* clock_;
+        TimerWheel* timers_;
         GPIO* gpio_;
+        Pulse* pulse_;
         int pin_;
         bool high_;
+        bool hardware_;
         bool triggered_;
+        bool cooldown_;
         uint16_t trigger_ms_;
-        uint32_t trigger_time_;
         uint16_t cooldown_ms_;
+        Timer timer_;
 };
 
 #endif  // __R51_MOMENTARY_OUTPUT__
@@ -0,0 +1,225 @@
+#include "profiler.h"
+
+#include "config.h"
+
+
+static_assert((PROFILE_ID_SLOTS & (PROFILE_ID_SLOTS - 1)) == 0,
+        "PROFILE_ID_SLOTS must be a power of 2");
+
+// Number of counter reads used to calibrate overhead.
+static const uint8_t kCalibrationReads = 32;
+
+void ProfileStats::reset() {
+    count = 0;
+    min = 0xFFFFFFFF;
+    max = 0;
+    total = 0;
+    memset(histogram, 0, sizeof(histogram));
+}
+
+void ProfileStats::add(uint32_t cycles) {
+    ++count;
+    total += cycles;
+    if (cycles < min) {
+        min = cycles;
+    }
+    if (cycles > max) {
+        max = cycles;
+    }
+    uint16_t* bin = &histogram[bucket(cycles)];
+    if (*bin < 0xFFFF) {
+        ++*bin;
+    }
+}
+
+uint32_t ProfileStats::avg() const {
+    return count == 0 ? 0 : total / count;
+}
+
+uint8_t ProfileStats::bucket(uint32_t cycles) {
+    if (cycles < 64) {
+        return 0;
+    }
+    // bit length of the sample less 6
+    uint8_t bucket = 32 - __builtin_clz(cycles) - 6;
+    return bucket < kBuckets ? bucket : kBuckets - 1;
+}
+
+Profiler::Profiler(CycleCounter* counter) :
+        counter_(counter), out_(nullptr), overhead_(0), dump_(false), reset_(false),
+        count_(0), loop_start_(0), receive_start_(0), send_start_(0), send_id_(0),
+        nested_(0) {
+    reset();
+}
+
+void Profiler::begin(Print* out) {
+    out_ = out;
+    uint32_t overhead = 0xFFFFFFFF;
+    for (uint8_t i = 0; i < kCalibrationReads; i++) {
+        uint32_t start = counter_->read();
+        uint32_t end = counter_->read();
+        if (end - start < overhead) {
+            overhead = end - start;
+        }
+    }
+    overhead_ = overhead;
+}
+
+void Profiler::reset() {
+    loop_.reset();
+    for (uint8_t i = 0; i < PROFILE_MAX_NODES; i++) {
+        receive_[i].reset();
+        send_[i].reset();
+    }
+    ids_.clear();
+    self_ = 0;
+}
+
+void Profiler::receive(const Broadcast&) {
+    if (dump_ && out_ != nullptr) {
+        dump(out_);
+    }
+    if (reset_) {
+        reset();
+    }
+    dump_ = false;
+    reset_ = false;
+}
+
+void Profiler::send(const Frame& frame) {
+    if (frame.id != PROFILE_CONTROL_FRAME_ID || frame.len < 1) {
+        return;
+    }
+    dump_ |= (frame.data[0] & 0x01) != 0;
+    reset_ |= (frame.data[0] & 0x02) != 0;
+}
+
+bool Profiler::filter(uint32_t id) const {
+    return id == PROFILE_CONTROL_FRAME_ID;
+}
+
+void Profiler::attach(Node**, uint8_t count) {
+    count_ = count > PROFILE_MAX_NODES ? PROFILE_MAX_NODES : count;
+}
+
+uint32_t Profiler::sample(uint32_t start, uint32_t end) const {
+    uint32_t cycles = end - start;
+    return cycles > overhead_ ? cycles - overhead_ : 0;
+}
+
+// Start events take their timestamp last and end events take their timestamp
+// first so profiler bookkeeping is excluded from samples. End events read the
+// counter again to account for their own cost.
+
+void Profiler::loopStart() {
+    loop_start_ = counter_->read();
+}
+
+void Profiler::loopEnd() {
+    uint32_t now = counter_->read();
+    loop_.add(sample(loop_start_, now));
+    self_ += counter_->read() - now;
+}
+
+void Profiler::receiveStart(uint8_t) {
+    nested_ = 0;
+    receive_start_ = counter_->read();
+}
+
+void Profiler::receiveEnd(uint8_t node) {
+    uint32_t now = counter_->read();
+    if (node < count_) {
+        uint32_t cycles = sample(receive_start_, now);
+        receive_[node].add(cycles > nested_ ? cycles - nested_ : 0);
+    }
+    self_ += counter_->read() - now;
+}
+
+void Profiler::sendStart(uint8_t, const Frame& frame) {
+    send_id_ = frame.id;
+    send_start_ = counter_->read();
+}
+
+void Profiler::sendEnd(uint8_t node) {
+    uint32_t now = counter_->read();
+    uint32_t cycles = sample(send_start_, now);
+    if (node < count_) {
+        send_[node].add(cycles);
+    }
+    bool added;
+    IdStats* id = ids_.insert(send_id_, &added);
+    if (added) {
+        id->stats.reset();
+    }
+    if (id != nullptr) {
+        id->stats.add(cycles);
+    }
+    uint32_t end = counter_->read();
+    // remove the send and its bookkeeping from the enclosing receive
+    nested_ += end - send_start_;
+    self_ += end - now;
+}
+
+const ProfileStats* Profiler::receiveStats(uint8_t node) const {
+    return node < count_ ? &receive_[node] : nullptr;
+}
+
+const ProfileStats* Profiler::sendStats(uint8_t node) const {
+    return node < count_ ? &send_[node] : nullptr;
+}
+
+const ProfileStats* Profiler::idStats(uint32_t id) const {
+    IdStats* stats = const_cast<Profiler*>(this)->ids_.find(id);
+    return stats == nullptr ? nullptr : &stats->stats;
+}
+
+void Profiler::printStats(Print* out, const ProfileStats& stats) const {
+    out->print(" count ");
+    out->print(stats.count);
+    out->print(" min ");
+    out->print(stats.count == 0 ? 0 : stats.min);
+    out->print(" avg ");
+    out->print(stats.avg());
+    out->print(" max ");
+    out->print(stats.max);
+    out->print(" hist");
+    for (uint8_t i = 0; i < ProfileStats::kBuckets; i++) {
+        out->print(" ");
+        out->print(stats.histogram[i]);
+    }
+    out->println();
+}
+
+void Profiler::dump(Print* out) const {
+    out->print("profile: freq ");
+    out->print(counter_->frequency());
+    out->print(" overhead ");
+    out->print(overhead_);
+    out->print(" self per loop ");
+    out->println(loop_.count == 0 ? 0 : (uint32_t)(self_ / loop_.count));
+
+    out->print("profile: loop");
+    printStats(out, loop_);
+    for (uint8_t i = 0; i < count_; i++) {
+        if (receive_[i].count > 0) {
+            out->print("profile: node ");
+            out->print(i);
+            out->print(" receive");
+            printStats(out, receive_[i]);
+        }
+        if (send_[i].count > 0) {
+            out->print("profile: node ");
+            out->print(i);
+            out->print(" send");
+            printStats(out, send_[i]);
+        }
+    }
+    for (uint8_t i = 0; i < PROFILE_ID_SLOTS; i++) {
+        if (ids_[i].used) {
+            out->print("profile: id ");
+            out->print(ids_[i].id, HEX);
+            out->print(" send");
+            printStats(out, ids_[i].stats);
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef __R51_PROFILER__
+#define __R51_PROFILER__
+
+#include <Arduino.h>
+
+#include "bus.h"
+#include "config.h"
+#include "cycles.h"
+#include "id_table.h"
+
+
+#ifdef PROFILE_ENABLE
+
+#ifndef DEBUG_ENABLE
+#error DEBUG_ENABLE must be set with PROFILE_ENABLE
+#endif
+
+#define P(x) x
+
+#else
+
+#define P(x)
+
+#endif  // PROFILE_ENABLE
+
+// Cycle statistics of a profiled operation.
+struct ProfileStats {
+    // Number of histogram buckets. Bucket 0 holds samples under 64 cycles.
+    // Each following bucket covers twice the range of the one before. The
+    // last bucket holds all longer samples.
+    static const uint8_t kBuckets = 16;
+
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint16_t histogram[kBuckets];
+
+    ProfileStats() { reset(); }
+
+    // Clear all samples.
+    void reset();
+
+    // Add a sample.
+    void add(uint32_t cycles);
+
+    // Return the mean sample or 0 if there are no samples.
+    uint32_t avg() const;
+
+    // Return the histogram bucket of a sample.
+    static uint8_t bucket(uint32_t cycles);
+};
+
+// Profiles the bus with a cycle counter. Attach to the bus as both a node and
+// a monitor. When other monitors are attached with a MultiMonitor the profiler
+// should be last so it measures only the nodes. Collects stats for each loop,
+// each node's receive() and send(), and the send() of each frame ID. Node
+// receive times exclude the sends of the frames it broadcasts.
+//
+// Each sample has the calibrated cost of reading the counter removed. The
+// cycles spent in the profiler itself are counted and reported with the
+// stats so the overhead of profiling is visible.
+//
+// Profile Control Frame: 0x5F03
+//   Byte 0:
+//     Bit 0: Write the stats to the output
+//     Bit 1: Reset the stats
+//   Bytes 1-7: unused
+class Profiler : public Node, public BusMonitor {
+    public:
+        Profiler(CycleCounter* counter = CycleCounter::real());
+
+        // Set the output for stats and calibrate the counter overhead.
+        void begin(Print* out);
+
+        // Write or reset stats as requested by the control frame.
+        void receive(const Broadcast& broadcast) override;
+
+        // Handle control frames.
+        void send(const Frame& frame) override;
+
+        // Matches the profile control frame.
+        bool filter(uint32_t id) const override;
+
+        void attach(Node** nodes, uint8_t count) override;
+        void loopStart() override;
+        void loopEnd() override;
+        void receiveStart(uint8_t node) override;
+        void receiveEnd(uint8_t node) override;
+        void broadcast(uint8_t, const Frame&) override {}
+        void sendStart(uint8_t node, const Frame& frame) override;
+        void sendEnd(uint8_t node) override;
+
+        // Write the stats in text form.
+        void dump(Print* out) const;
+
+        // Clear all stats.
+        void reset();
+
+        // The cost of reading the counter in cycles.
+        uint32_t overhead() const { return overhead_; }
+
+        // The number of cycles spent in the profiler since the last reset.
+        uint64_t selfCycles() const { return self_; }
+
+        // Return stats. Return nullptr if the node or ID is not tracked.
+        const ProfileStats& loopStats() const { return loop_; }
+        const ProfileStats* receiveStats(uint8_t node) const;
+        const ProfileStats* sendStats(uint8_t node) const;
+        const ProfileStats* idStats(uint32_t id) const;
+
+    private:
+        struct IdStats {
+            uint32_t id;
+            bool used;
+            ProfileStats stats;
+        };
+
+        CycleCounter* counter_;
+        Print* out_;
+        uint32_t overhead_;
+        bool dump_;
+        bool reset_;
+
+        uint8_t count_;
+        ProfileStats loop_;
+        ProfileStats receive_[PROFILE_MAX_NODES];
+        ProfileStats send_[PROFILE_MAX_NODES];
+        IdTable<IdStats, PROFILE_ID_SLOTS> ids_;
+        uint64_t self_;
+
+        uint32_t loop_start_;
+        uint32_t receive_start_;
+        uint32_t send_start_;
+        uint32_t send_id_;
+        uint32_t nested_;
+
+        uint32_t sample(uint32_t start, uint32_t end) const;
+        void printStats(Print* out, const ProfileStats& stats) const;
+};
+
+#endif  // __R51_PROFILER__
@@ -0,0 +1,160 @@
+#include "pulse.h"
+
+#include "debug.h"
+
+#define LOG_MODULE LOG_CLIMATE
+
+
+#if defined(__SAMD51__)
+
+#include <wiring_private.h>
+
+// TCC instances with 24-bit counters which may generate pulses. Each instance
+// drives a single pin.
+static Tcc* const kPulseTcc[] = {TCC0, TCC1};
+static const uint8_t kPulseTccGclkId[] = {TCC0_GCLK_ID, TCC1_GCLK_ID};
+static const uint8_t kPulseTccCcNum[] = {TCC0_CC_NUM, TCC1_CC_NUM};
+static const uint8_t kPulseTccCount = sizeof(kPulseTcc) / sizeof(kPulseTcc[0]);
+
+// The TCC counts at 48MHz / 16 = 3MHz so a 24-bit counter allows pulses up to
+// 5.5 seconds with sub-microsecond resolution.
+static const uint32_t kPulseTicksPerMicro = 3;
+static const uint32_t kPulseMaxTicks = 0xFFFFFE;
+
+// Generates pulses with a TCC in one-shot normal PWM mode. The output is set
+// when the counter starts and cleared on compare match. The counter then
+// stops at TOP and the output stays cleared until the next retrigger.
+class Same51Pulse : public Pulse {
+    public:
+        Same51Pulse() : count_(0) {}
+
+        bool begin(uint32_t pin, bool high) override {
+            if (find(pin) != nullptr) {
+                return true;
+            }
+            if (count_ >= kPulseTccCount) {
+                return false;
+            }
+            const PinDescription& desc = g_APinDescription[pin];
+            if ((desc.ulPinAttribute & (PIN_ATTR_PWM_F | PIN_ATTR_PWM_G)) == 0) {
+                return false;
+            }
+            uint8_t tcc = GetTCNumber(desc.ulPWMChannel);
+            if (tcc >= kPulseTccCount) {
+                return false;
+            }
+            for (uint8_t i = 0; i < count_; i++) {
+                if (channels_[i].tcc == tcc) {
+                    ERROR_MSG_VAL("pulse: timer already in use for pin ", pin);
+                    return false;
+                }
+            }
+
+            Channel* channel = &channels_[count_++];
+            channel->pin = pin;
+            channel->tcc = tcc;
+            channel->output = GetTCChannelNumber(desc.ulPWMChannel);
+            channel->cc = channel->output % kPulseTccCcNum[tcc];
+            configure(channel, high);
+            pinPeripheral(pin, (desc.ulPinAttribute & PIN_ATTR_PWM_F) ? PIO_TIMER_ALT : PIO_TCC_PDEC);
+            return true;
+        }
+
+        bool trigger(uint32_t pin, uint32_t us) override {
+            Channel* channel = find(pin);
+            if (channel == nullptr) {
+                return false;
+            }
+            Tcc* tcc = kPulseTcc[channel->tcc];
+            if (!tcc->STATUS.bit.STOP) {
+                return false;
+            }
+            uint32_t ticks = us * kPulseTicksPerMicro;
+            if (ticks == 0 || ticks > kPulseMaxTicks) {
+                ERROR_MSG_VAL("pulse: invalid width ", us);
+                return false;
+            }
+            tcc->CC[channel->cc].reg = ticks;
+            tcc->PER.reg = ticks + 1;
+            while (tcc->SYNCBUSY.reg & (TCC_SYNCBUSY_PER | TCC_SYNCBUSY_CC(1 << channel->cc)));
+            tcc->CTRLBSET.reg = TCC_CTRLBSET_CMD_RETRIGGER;
+            while (tcc->SYNCBUSY.bit.CTRLB);
+            return true;
+        }
+
+        bool active(uint32_t pin) override {
+            Channel* channel = find(pin);
+            return channel != nullptr && !kPulseTcc[channel->tcc]->STATUS.bit.STOP;
+        }
+
+    private:
+        struct Channel {
+            uint32_t pin;
+            uint8_t tcc;
+            uint8_t output;
+            uint8_t cc;
+        };
+
+        Channel channels_[kPulseTccCount];
+        uint8_t count_;
+
+        Channel* find(uint32_t pin) {
+            for (uint8_t i = 0; i < count_; i++) {
+                if (channels_[i].pin == pin) {
+                    return &channels_[i];
+                }
+            }
+            return nullptr;
+        }
+
+        void configure(const Channel* channel, bool high) {
+            Tcc* tcc = kPulseTcc[channel->tcc];
+            MCLK->APBBMASK.reg |= MCLK_APBBMASK_TCC0 | MCLK_APBBMASK_TCC1;
+            GCLK->PCHCTRL[kPulseTccGclkId[channel->tcc]].reg =
+                GCLK_PCHCTRL_GEN_GCLK1 | GCLK_PCHCTRL_CHEN;
+            while (!(GCLK->PCHCTRL[kPulseTccGclkId[channel->tcc]].reg & GCLK_PCHCTRL_CHEN));
+
+            tcc->CTRLA.bit.ENABLE = 0;
+            while (tcc->SYNCBUSY.bit.ENABLE);
+            tcc->CTRLA.reg = TCC_CTRLA_SWRST;
+            while (tcc->SYNCBUSY.bit.SWRST);
+
+            tcc->CTRLA.reg = TCC_CTRLA_PRESCALER_DIV16;
+            tcc->WAVE.reg = TCC_WAVE_WAVEGEN_NPWM;
+            while (tcc->SYNCBUSY.bit.WAVE);
+            if (!high) {
+                // drive low during the pulse and high when idle
+                tcc->DRVCTRL.reg |= TCC_DRVCTRL_INVEN0 << channel->output;
+            }
+
+            // A compare value of 0 keeps the output inactive until triggered.
+            tcc->CC[channel->cc].reg = 0;
+            tcc->PER.reg = 1;
+            while (tcc->SYNCBUSY.reg);
+            tcc->CTRLBSET.reg = TCC_CTRLBSET_ONESHOT;
+            while (tcc->SYNCBUSY.bit.CTRLB);
+
+            tcc->CTRLA.bit.ENABLE = 1;
+            while (tcc->SYNCBUSY.bit.ENABLE);
+        }
+};
+
+Same51Pulse real_pulse;
+
+#else
+
+// Fallback for other boards. Pulses are not supported.
+class UnsupportedPulse : public Pulse {
+    public:
+        bool begin(uint32_t, bool) override { return false; }
+        bool trigger(uint32_t, uint32_t) override { return false; }
+        bool active(uint32_t) override { return false; }
+};
+
+UnsupportedPulse real_pulse;
+
+#endif  // __SAMD51__
+
+Pulse* Pulse::real() {
+    return &real_pulse;
+}
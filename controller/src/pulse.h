@@ -0,0 +1,33 @@
+#ifndef __R51_PULSE__
+#define __R51_PULSE__
+
+#include <Arduino.h>
+
+
+// Base hardware one-shot pulse interface. Allows hardware pulses to be mocked.
+// The real implementation on the SAME51 drives the pin from a TCC peripheral
+// in one-shot mode so the pulse ends in hardware at the exact width without
+// any work in the main loop. Other boards and pins without a TCC output do not
+// support pulses and callers should fall back to driving the pin directly.
+class Pulse {
+    public:
+        // Return the real pulse interface.
+        static Pulse* real();
+
+        Pulse() = default;
+        virtual ~Pulse() = default;
+
+        // Attach a pin to the pulse timer. The pin idles at the inactive
+        // level. High sets the active level of the pulse. Return false if the
+        // pin cannot be driven by a pulse timer.
+        virtual bool begin(uint32_t pin, bool high) = 0;
+
+        // Start a pulse of the given width in microseconds. Return false if
+        // the pin is not attached or a pulse is already running.
+        virtual bool trigger(uint32_t pin, uint32_t us) = 0;
+
+        // Return true if a pulse is running on the pin.
+        virtual bool active(uint32_t pin) = 0;
+};
+
+#endif  // __R51_PULSE__
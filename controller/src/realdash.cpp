@@ -5,11 +5,14 @@
 #include "config.h"
 #include "debug.h"
 
+#define LOG_MODULE LOG_REALDASH
+
 
 static const uint32_t kReceiveTimeout = 5000;
 
 RealDash::RealDash() {
     stream_ = nullptr;
+    dropped_ = 0;
     reset();
 }
 
@@ -137,6 +140,7 @@ bool RealDash::validateChecksum() {
             return false;
         }
         if (frame66_checksum_.finalize() != *((uint32_t*)checksum_buffer_)) {
+            ++dropped_;
             ERROR_MSG_VAL_FMT("realdash: frame 0x66 checksum error, wanted ", frame66_checksum_.finalize(), HEX);
             reset();
             return false;
@@ -150,6 +154,7 @@ bool RealDash::validateChecksum() {
             read_size_++;
         }
         if (frame44_checksum_ != checksum_buffer_[0]) {
+            ++dropped_;
             ERROR_MSG_VAL_FMT("realdash: frame 0x44 checksum error, wanted ", frame44_checksum_, HEX);
             reset();
             return false;
@@ -175,10 +180,12 @@ void RealDash::send(const Frame& frame) {
         return;
     }
     if (!stream_) {
+        ++dropped_;
         ERROR_MSG("realdash: not connected");
         return;
     }
     if (frame.len > 64 || frame.len % 4 != 0) {
+        ++dropped_;
         ERROR_MSG_VAL("realdash: frame write error, invalid length ", frame.len);
         return;
     }
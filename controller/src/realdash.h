@@ -29,9 +29,14 @@ class RealDash : public Node {
         // failure.
         void send(const Frame& frame) override;
 
+        // The number of frames dropped due to checksum errors or failed
+        // writes.
+        uint32_t dropped() const override { return dropped_; }
+
     private:
         Stream* stream_;
         Frame frame_;
+        uint32_t dropped_;
 
         // Read attributes.
         bool frame_type_66_;        // Type of frame. False if 0x44, true if 0x66.
@@ -0,0 +1,99 @@
+#include "recorder.h"
+
+#include "candump.h"
+#include "debug.h"
+#include "memory.h"
+
+#define LOG_MODULE LOG_SYSTEM
+
+
+static_assert((RECORDER_SIZE & (RECORDER_SIZE - 1)) == 0,
+        "RECORDER_SIZE must be a power of 2");
+
+// Marks a valid log. RAM holds random data after power on.
+static const uint32_t kRecorderMagic = 0x52353152;
+
+#if defined(__SAMD51__)
+// The log must sit in RAM which the startup code neither copies nor zeroes and
+// below the heap which MemoryMonitor paints. This depends on the board's
+// linker script placing .noinit. Placement is checked at boot and a misplaced
+// log is never recovered.
+__attribute__((section(".noinit"))) static RecorderLog real_log;
+#else
+static RecorderLog real_log;
+#endif
+
+RecorderLog* RecorderLog::real() {
+    return &real_log;
+}
+
+Recorder::Recorder(RecorderLog* log, TimerWheel* timers) :
+        log_(log), timers_(timers), out_(nullptr), recovered_(0),
+        dump_(false), clear_(false) {}
+
+void Recorder::begin(Print* out) {
+    out_ = out;
+    if (!retainedOnReset(log_, sizeof(*log_))) {
+        ERROR_MSG("recorder: log is not retained on reset");
+        clear();
+    } else if (log_->magic == kRecorderMagic) {
+        recovered_ = count();
+        INFO_MSG_VAL("recorder: recovered frames ", recovered_);
+    } else {
+        clear();
+    }
+}
+
+void Recorder::receive(const Broadcast&) {
+    if (dump_ && out_ != nullptr) {
+        dump(out_);
+    }
+    if (clear_) {
+        clear();
+    }
+    dump_ = false;
+    clear_ = false;
+}
+
+void Recorder::send(const Frame& frame) {
+    if (frame.id != RECORDER_CONTROL_FRAME_ID || frame.len < 1) {
+        return;
+    }
+    dump_ |= (frame.data[0] & 0x01) != 0;
+    clear_ |= (frame.data[0] & 0x02) != 0;
+}
+
+bool Recorder::filter(uint32_t id) const {
+    return id == RECORDER_CONTROL_FRAME_ID;
+}
+
+void Recorder::broadcast(uint8_t source, const Frame& frame) {
+    RecorderEntry* entry = &log_->entries[log_->head++ & (RECORDER_SIZE - 1)];
+    entry->id = frame.id;
+    entry->micros = timers_->micros();
+    entry->len = frame.len;
+    entry->source = source;
+    memcpy(entry->data, frame.data, sizeof(entry->data));
+}
+
+void Recorder::clear() {
+    log_->magic = kRecorderMagic;
+    log_->head = 0;
+    recovered_ = 0;
+}
+
+uint32_t Recorder::count() const {
+    return log_->head < RECORDER_SIZE ? log_->head : RECORDER_SIZE;
+}
+
+void Recorder::dump(Print* out) const {
+    char iface[8];
+    char line[kCandumpLineSize];
+    for (uint32_t i = log_->head - count(); i != log_->head; i++) {
+        const RecorderEntry& entry = log_->entries[i & (RECORDER_SIZE - 1)];
+        snprintf(iface, sizeof(iface), "node%u", entry.source);
+        uint8_t len = entry.len < sizeof(entry.data) ? entry.len : sizeof(entry.data);
+        formatCandump(line, entry.micros, iface, entry.id, entry.data, len);
+        out->println(line);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef __R51_RECORDER__
+#define __R51_RECORDER__
+
+#include <Arduino.h>
+
+#include "bus.h"
+#include "config.h"
+#include "timer.h"
+
+
+// A recorded frame. Only the first 8 data bytes are kept.
+struct RecorderEntry {
+    uint32_t id;
+    uint32_t micros;
+    byte data[8];
+    uint8_t len;
+    uint8_t source;
+};
+
+// Storage for the flight recorder. The real log is placed in RAM which is not
+// cleared by the startup code so the recording survives a watchdog or software
+// reset. The magic value marks the log as valid after a reset.
+struct RecorderLog {
+    // Return the log which survives a reset.
+    static RecorderLog* real();
+
+    uint32_t magic;
+    uint32_t head;
+    RecorderEntry entries[RECORDER_SIZE];
+};
+
+// Records the last RECORDER_SIZE broadcast frames. Attach to the bus as both a
+// node and a monitor. Recording copies the frame into a fixed ring and takes
+// its timestamp from the loop's clock sample so it costs a few dozen cycles
+// per frame. A recording which survived a reset is kept and recording resumes
+// after its last frame.
+//
+// The recording is written oldest first in candump log format with an
+// interface name of nodeN where N is the index of the node which broadcast the
+// frame. The timestamp is the loop time since boot and wraps every 71 minutes.
+//
+// Recorder Control Frame: 0x5F04
+//   Byte 0:
+//     Bit 0: Write the recording to the output
+//     Bit 1: Clear the recording
+//   Bytes 1-7: unused
+class Recorder : public Node, public BusMonitor {
+    public:
+        Recorder(RecorderLog* log = RecorderLog::real(),
+                TimerWheel* timers = TimerWheel::real());
+
+        // Set the output for the recording. Recover the recording from before
+        // a reset or clear the log if it is not valid.
+        void begin(Print* out = nullptr);
+
+        // Write or clear the recording as requested by the control frame.
+        void receive(const Broadcast& broadcast) override;
+
+        // Handle control frames.
+        void send(const Frame& frame) override;
+
+        // Matches the recorder control frame.
+        bool filter(uint32_t id) const override;
+
+        void attach(Node**, uint8_t) override {}
+        void loopStart() override {}
+        void loopEnd() override {}
+        void receiveStart(uint8_t) override {}
+        void receiveEnd(uint8_t) override {}
+        void broadcast(uint8_t source, const Frame& frame) override;
+        void sendStart(uint8_t, const Frame&) override {}
+        void sendEnd(uint8_t) override {}
+
+        // Write the recording in candump format.
+        void dump(Print* out) const;
+
+        // Clear the recording.
+        void clear();
+
+        // The number of recorded frames.
+        uint32_t count() const;
+
+        // The number of frames recovered by begin().
+        uint32_t recovered() const { return recovered_; }
+
+    private:
+        RecorderLog* log_;
+        TimerWheel* timers_;
+        Print* out_;
+        uint32_t recovered_;
+        bool dump_;
+        bool clear_;
+};
+
+#endif  // __R51_RECORDER__
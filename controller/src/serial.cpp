@@ -2,10 +2,26 @@
 
 #include "config.h"
 #include "debug.h"
+#include "hex.h"
 
+#define LOG_MODULE LOG_SERIAL
+
+
+size_t LinePrint::write(uint8_t b) {
+    if (stream_ == nullptr) {
+        return 0;
+    }
+    buffer_[len_++] = b;
+    if (b == '\n' || len_ == sizeof(buffer_)) {
+        stream_->write(buffer_, len_);
+        len_ = 0;
+    }
+    return 1;
+}
 
 void SerialText::begin(Stream* stream) {
     stream_ = stream;
+    text_.begin(stream);
     reset();
 }
 
@@ -38,6 +54,12 @@ void SerialText::receive(const Broadcast& broadcast) {
     if (!complete) {
         return;
     }
+    if (buffer_len_ > 0 && (buffer_[0] == '+' || buffer_[0] == '-' ||
+            buffer_[0] == '!' || buffer_[0] == '?')) {
+        command();
+        reset();
+        return;
+    }
 
     for (int i = 0; i < buffer_len_; i++) {
         if (buffer_[i] == '#') {
@@ -58,9 +80,15 @@ void SerialText::receive(const Broadcast& broadcast) {
         return;
     }
 
-    memcpy(conv_, buffer_, id_len_);
-    conv_[id_len_] = 0;
-    frame_.id = strtoul((char*)conv_, nullptr, 16);
+    frame_.id = 0;
+    for (int i = 0; i < id_len_; i++) {
+        int8_t v = hexValue(buffer_[i]);
+        if (v < 0) {
+            frame_.id = 0;
+            break;
+        }
+        frame_.id = (frame_.id << 4) | v;
+    }
     if (frame_.id == 0) {
         ERROR_MSG("serial: invalid frame format: bad id");
         reset();
@@ -68,37 +96,95 @@ void SerialText::receive(const Broadcast& broadcast) {
     }
 
     frame_.len = data_len_ / 2;
-    conv_[2] = 0;
+    const char* data = (const char*)buffer_ + id_len_ + 1;
     for (int i = 0; i < frame_.len; i++) {
-        memcpy(conv_, buffer_ + (i * 2 + id_len_ + 1), 2);
-        frame_.data[i] = (byte)strtoul((char*)conv_, nullptr, 16);
+        int16_t b = hexByte(data + i * 2);
+        if (b < 0) {
+            ERROR_MSG("serial: invalid frame format: bad data");
+            reset();
+            return;
+        }
+        frame_.data[i] = b;
     }
 
     reset();
     broadcast(frame_);
 }
 
-void SerialText::send(const Frame& frame) {
-    stream_->print(frame.id, HEX);
-    stream_->print("#");
+size_t formatSerialText(char* buffer, const Frame& frame) {
+    char* p = writeHexTrimmed(buffer, frame.id);
+    *p++ = '#';
     for (int i = 0; i < frame.len; i++) {
-        if (frame.data[i] <= 0x0F) {
-            stream_->print("0");
-        }
-        stream_->print(frame.data[i], HEX);
-        if (i < frame.len-1) {
-            stream_->print(":");
+        if (i > 0) {
+            *p++ = ':';
         }
+        p = writeHexBytes(p, frame.data + i, 1);
+    }
+    *p++ = '\r';
+    *p++ = '\n';
+    return p - buffer;
+}
+
+void SerialText::send(const Frame& frame) {
+    if (!filter_.pass(frame.id, timers_->now())) {
+        return;
     }
-    stream_->println("");
+    char buffer[kSerialTextLineSize];
+    stream_->write((const uint8_t*)buffer, formatSerialText(buffer, frame));
 }
 
 bool SerialText::filter(uint32_t id) const {
-    return true;
+    return filter_.match(id);
+}
+
+void SerialText::command() {
+    if (buffer_[0] == '!') {
+        filter_.clear();
+        return;
+    }
+    if (buffer_[0] == '?') {
+        filter_.print(stream_);
+        return;
+    }
+
+    uint32_t values[2] = {0, 0xFFFFFFFF};
+    uint16_t rate = 0;
+    uint8_t field = 0;
+    uint8_t digits = 0;
+    for (uint8_t i = 1; i < buffer_len_; i++) {
+        char c = buffer_[i];
+        if (c == '/' && field == 0 && digits > 0) {
+            field = 1;
+            values[1] = 0;
+            digits = 0;
+        } else if (c == '@' && field < 2 && digits > 0) {
+            field = 2;
+            digits = 0;
+        } else if (field == 2 && c >= '0' && c <= '9' && digits < 5) {
+            rate = rate * 10 + (c - '0');
+            ++digits;
+        } else if (field < 2 && hexValue(c) >= 0 && digits < 8) {
+            values[field] = (values[field] << 4) | hexValue(c);
+            ++digits;
+        } else {
+            digits = 0;
+            break;
+        }
+    }
+    if (digits == 0) {
+        ERROR_MSG("serial: invalid filter");
+        return;
+    }
+
+    bool added = buffer_[0] == '+' ?
+        filter_.allow(values[0], values[1], rate) :
+        rate == 0 && filter_.deny(values[0], values[1]);
+    if (!added) {
+        ERROR_MSG("serial: filter not added");
+    }
 }
 
 void SerialText::reset() {
-    memset(buffer_, 0, 28);
     buffer_len_ = 0;
     id_len_ = 0;
     data_len_ = 0;
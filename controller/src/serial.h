@@ -4,6 +4,8 @@
 #include <Arduino.h>
 
 #include "bus.h"
+#include "filter.h"
+#include "timer.h"
 
 
 #define WAIT_FOR_SERIAL(SERIAL, DELAY, LOG_MSG) ({\
@@ -16,6 +18,40 @@
 })
 
 
+// The longest line written by SerialText. Fits a 64 byte frame.
+static const size_t kSerialTextLineSize = 8 + 1 + 64 * 3 - 1 + 2;
+
+// Format a frame in the SerialText form terminated by a CR+LF. The buffer must
+// hold kSerialTextLineSize bytes. The line is not null terminated. Return the
+// length of the line.
+size_t formatSerialText(char* buffer, const Frame& frame);
+
+// The longest line of other text written through SerialText without being
+// split.
+static const size_t kSerialTextPrintSize = 64;
+
+// Buffers text and writes it to a stream a whole line at a time so the line is
+// not split by other output on the same port. Longer lines are written in
+// pieces. Text written before the stream is set is discarded.
+class LinePrint : public Print {
+    public:
+        LinePrint() : stream_(nullptr), len_(0) {}
+
+        // Write lines to the given stream.
+        void begin(Print* stream) {
+            stream_ = stream;
+            len_ = 0;
+        }
+
+        size_t write(uint8_t b) override;
+        using Print::write;
+
+    private:
+        Print* stream_;
+        uint8_t buffer_[kSerialTextPrintSize];
+        size_t len_;
+};
+
 // A text based connection which reads frames from a serial stream. Useful for
 // sending hand-built frames for debugging via TTL.
 //
@@ -30,10 +66,26 @@
 // provided for shorter payloads. Each frame is terminated in a newline.
 //
 // Frames written to the stream will be printed in the above form and end in a
-// CR+LF.
+// CR+LF. Each frame is formatted into a buffer and written with a single
+// write.
+//
+// Frames written to the stream are filtered with allow and deny lists set by
+// commands on the same stream:
+//   +HHHHHHHH[/MMMMMMMM][@R]: Allow IDs matching the ID and mask. R limits
+//       each matching ID to one frame every R ms.
+//   -HHHHHHHH[/MMMMMMMM]: Deny IDs matching the ID and mask.
+//   !: Remove all filters.
+//   ?: List the filters.
+//
+// The mask defaults to an exact match. All frames are written when there are
+// no filters. For example "+54B" then "+5400" writes only those two IDs.
+//
+// Reports from other nodes are written through text() so all text on the
+// port is written in whole lines by this node.
 class SerialText : public Node {
     public:
-        SerialText() : stream_(nullptr) {}
+        SerialText(TimerWheel* timers = TimerWheel::real()) :
+            stream_(nullptr), timers_(timers) {}
 
         // Start receiving frames from the given stream. Typically Serial,
         // SerialUSB, or Serial1.
@@ -45,13 +97,24 @@ class SerialText : public Node {
         // Send a text frame over serial.
         void send(const Frame& frame) override;
 
-        // Filter frames to receive from the serial connection. Defaults to
+        // Filter frames to write to the serial connection. Defaults to
         // allowing all frames.
         virtual bool filter(uint32_t id) const override;
 
-    private:
+        // The filters applied to written frames.
+        IdFilter* idFilter() { return &filter_; }
+
+        // Text written here is written to the stream in whole lines. Valid
+        // before begin is called.
+        Print* text() { return &text_; }
+
+    protected:
         Stream* stream_;
-        byte conv_[5];
+        TimerWheel* timers_;
+        IdFilter filter_;
+
+    private:
+        LinePrint text_;
         byte buffer_[32];
         uint8_t buffer_len_;
         uint8_t id_len_;
@@ -59,6 +122,7 @@ class SerialText : public Node {
         Frame frame_;
 
         void reset();
+        void command();
 };
 
 #endif  // __R51_SERIAL_H__
@@ -4,433 +4,347 @@
 #include "config.h"
 #include "debug.h"
 
+#define LOG_MODULE LOG_SETTINGS
+
+
+// BCM setting identifiers. Sent with update requests and echoed in the
+// response.
+enum SettingsCommand : uint8_t {
+    COMMAND_SLIDE_DRIVER_SEAT = 0x01,
+    COMMAND_SELECT_DOOR_UNLOCK = 0x02,
+    COMMAND_AUTO_INTERIOR_ILLUM = 0x10,
+    COMMAND_REMOTE_KEY_HORN = 0x2A,
+    COMMAND_REMOTE_KEY_LIGHT = 0x2E,
+    COMMAND_AUTO_RELOCK_TIME = 0x2F,
+    COMMAND_AUTO_HL_SENS = 0x37,
+    COMMAND_AUTO_HL_DELAY = 0x39,
+    COMMAND_SPEED_SENS_WIPER = 0x47,
+};
 
-// Available sequence states. States other than "ready" represent a frame which
-// is sent on the bus which requires a specific response.
-enum State : uint8_t {
-    // Indicates the command is ready to send.
-    STATE_READY = 0,
-
-    // Enter and exit settings requests.
-    STATE_ENTER,
-    STATE_EXIT,
-
-    // Init requests.
-    STATE_INIT_00,
-    STATE_INIT_20,
-    STATE_INIT_40,
-    STATE_INIT_60,
-
-    // Settings requests.
-    STATE_AUTO_INTERIOR_ILLUM,
-    STATE_AUTO_HL_SENS,
-    STATE_AUTO_HL_DELAY,
-    STATE_SPEED_SENS_WIPER,
-    STATE_REMOTE_KEY_HORN,
-    STATE_REMOTE_KEY_LIGHT,
-    STATE_AUTO_RELOCK_TIME,
-    STATE_SELECT_DOOR_UNLOCK,
-    STATE_SLIDE_DRIVER_SEAT,
-    STATE_RETRIEVE_71E_10,
-    STATE_RETRIEVE_71E_2X,
-    STATE_RETRIEVE_71F_05,
-    STATE_RESET,
+// Common steps.
+#define STEP_ENTER(NEXT) {STEP_REQUEST, {0x10, 0xC0, 0xFF}, 2, {0x50, 0xC0}, 2, NEXT}
+#define STEP_EXIT {STEP_REQUEST, {0x10, 0x81, 0xFF}, 2, {0x50, 0x81}, 2, kSettingsStepDone}
+#define STEP_INIT(ID, NEXT) {STEP_REQUEST, {0x3B, ID, 0xFF}, 2, {0x7B, ID}, 2, NEXT}
+#define STEP_UPDATE(NEXT) {STEP_BATCH, {0x3B, 0x00, 0x00}, 3, {0x7B, 0x00}, 1, NEXT}
+#define STEP_RESET(NEXT) {STEP_REQUEST, {0x3B, 0x1F, 0x00}, 3, {0x7B, 0x1F}, 2, NEXT}
+#define STEP_STATE(NEXT) {STEP_REQUEST, {0x21, 0x01, 0xFF}, 2, {0x61, 0x01}, 2, NEXT}
+
+constexpr SettingsStep kSettingsInitE[] = {
+    STEP_ENTER(1),
+    STEP_INIT(0x00, 2),
+    STEP_INIT(0x20, 3),
+    STEP_INIT(0x40, 4),
+    STEP_INIT(0x60, 5),
+    STEP_EXIT,
 };
 
-inline uint32_t responseId(uint32_t request_id) {
-    return (request_id & ~0x010) | 0x020;
-}
+constexpr SettingsStep kSettingsInitF[] = {
+    STEP_ENTER(1),
+    STEP_INIT(0x00, 2),
+    STEP_EXIT,
+};
 
+constexpr SettingsStep kSettingsRetrieve[] = {
+    STEP_ENTER(1),
+    STEP_STATE(2),
+    STEP_EXIT,
+};
 
-// Fill a settings frame with a payload.
-bool fillRequest(Frame* frame, uint32_t id, byte prefix0, byte prefix1, byte prefix2, uint8_t value = 0xFF) {
-    frame->id = id;
-    frame->len = 8;
-    frame->data[0] = prefix0;
-    frame->data[1] = prefix1;
-    frame->data[2] = prefix2;
-    frame->data[3] = value;
-    memset(frame->data+4, 0xFF, 4);
-    return true;
-}
+constexpr SettingsStep kSettingsUpdate[] = {
+    STEP_ENTER(1),
+    STEP_UPDATE(2),
+    STEP_STATE(3),
+    STEP_EXIT,
+};
 
-// Fill a settings frame with data to be sent when the sequence transitions to
-// the given state. Some state transitions require value be attached.
-bool fillRequest(Frame* frame, uint32_t id, uint8_t state, uint8_t value = 0xFF) {
-    switch (state) {
-        case STATE_READY:
-            return false;
-        case STATE_ENTER:
-            return fillRequest(frame, id, 0x02, 0x10, 0xC0);
-        case STATE_EXIT:
-            return fillRequest(frame, id, 0x02, 0x10, 0x81);
-        case STATE_INIT_00:
-            return fillRequest(frame, id, 0x02, 0x3B, 0x00);
-        case STATE_INIT_20:
-            return fillRequest(frame, id, 0x02, 0x3B, 0x20);
-        case STATE_INIT_40:
-            return fillRequest(frame, id, 0x02, 0x3B, 0x40);
-        case STATE_INIT_60:
-            return fillRequest(frame, id, 0x02, 0x3B, 0x60);
-        case STATE_AUTO_INTERIOR_ILLUM:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x10, value);
-        case STATE_AUTO_HL_SENS:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x37, value);
-        case STATE_AUTO_HL_DELAY:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x39, value);
-        case STATE_SPEED_SENS_WIPER:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x47, value);
-        case STATE_REMOTE_KEY_HORN:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x2A, value);
-        case STATE_REMOTE_KEY_LIGHT:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x2E, value);
-        case STATE_AUTO_RELOCK_TIME:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x2F, value);
-        case STATE_SELECT_DOOR_UNLOCK:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x02, value);
-        case STATE_SLIDE_DRIVER_SEAT:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x01, value);
-        case STATE_RETRIEVE_71E_10:
-            return fillRequest(frame, id, 0x02, 0x21, 0x01);
-        case STATE_RETRIEVE_71E_2X:
-            return fillRequest(frame, id, 0x30, 0x00, 0x0A);
-        case STATE_RETRIEVE_71F_05:
-            return fillRequest(frame, id, 0x02, 0x21, 0x01);
-        case STATE_RESET:
-            return fillRequest(frame, id, 0x03, 0x3B, 0x1F, 0x00);
-        default:
-            ERROR_MSG_VAL("settings: fill unsupported state ", state);
-            return false;
-    }
-}
+// Sent when a step fails so the BCM leaves settings mode.
+constexpr SettingsStep kSettingsExit[] = {
+    STEP_EXIT,
+};
 
-// Match the frame against the given byte prefix.
-inline bool matchPrefix(const byte* data, byte prefix0) {
-    return data[0] == prefix0;
-}
+constexpr SettingsStep kSettingsReset[] = {
+    STEP_ENTER(1),
+    STEP_RESET(2),
+    STEP_STATE(3),
+    STEP_EXIT,
+};
 
-// Match the frame against the given byte prefix.
-inline bool matchPrefix(const byte* data, byte prefix0, byte prefix1, byte prefix2) {
-    return data[0] == prefix0 && data[1] == prefix1 && data[2] == prefix2;
+inline uint32_t responseId(uint32_t request_id) {
+    return (request_id & ~0x010) | 0x020;
 }
 
-// Return true if the frame matches the given state.
-bool matchState(const byte* data, uint8_t state) {
-    switch (state) {
-        case STATE_READY:
-            return false;
-        case STATE_ENTER:
-            return matchPrefix(data, 0x02, 0x50, 0xC0);
-        case STATE_EXIT:
-            return matchPrefix(data, 0x02, 0x50, 0x81);
-        case STATE_INIT_00:
-            return matchPrefix(data, 0x06, 0x7B, 0x00);
-        case STATE_INIT_20:
-            return matchPrefix(data, 0x06, 0x7B, 0x20);
-        case STATE_INIT_40:
-            return matchPrefix(data, 0x06, 0x7B, 0x40);
-        case STATE_INIT_60:
-            return matchPrefix(data, 0x06, 0x7B, 0x60);
-        case STATE_AUTO_INTERIOR_ILLUM:
-            return matchPrefix(data, 0x02, 0x7B, 0x10);
-        case STATE_AUTO_HL_SENS:
-            return matchPrefix(data, 0x02, 0x7B, 0x37);
-        case STATE_AUTO_HL_DELAY:
-            return matchPrefix(data, 0x02, 0x7B, 0x39);
-        case STATE_SPEED_SENS_WIPER:
-            return matchPrefix(data, 0x02, 0x7B, 0x47);
-        case STATE_REMOTE_KEY_HORN:
-            return matchPrefix(data, 0x02, 0x7B, 0x2A);
-        case STATE_REMOTE_KEY_LIGHT:
-            return matchPrefix(data, 0x02, 0x7B, 0x2E);
-        case STATE_AUTO_RELOCK_TIME:
-            return matchPrefix(data, 0x02, 0x7B, 0x2F);
-        case STATE_SELECT_DOOR_UNLOCK:
-            return matchPrefix(data, 0x02, 0x7B, 0x02);
-        case STATE_SLIDE_DRIVER_SEAT:
-            return matchPrefix(data, 0x02, 0x7B, 0x01);
-        case STATE_RETRIEVE_71E_10:
-            return matchPrefix(data, 0x10);
-        case STATE_RETRIEVE_71E_2X:
-            return matchPrefix(data, 0x21) || matchPrefix(data, 0x22);
-        case STATE_RETRIEVE_71F_05:
-            return matchPrefix(data, 0x05);
-        case STATE_RESET:
-            return matchPrefix(data, 0x02, 0x7B, 0x1F);
+// Return the latency statistics bucket for a step.
+inline SettingsRequestType requestType(const SettingsStep& step) {
+    switch (step.request[0]) {
+        case 0x10:
+            return REQUEST_SESSION;
+        case 0x21:
+            return REQUEST_READ;
         default:
-            ERROR_MSG_VAL("settings: match unsupported state ", state);
-            return false;
+            return REQUEST_WRITE;
     }
 }
 
-bool SettingsSequence::trigger() {
-    if (state_ != STATE_READY) {
+SettingsSequence::SettingsSequence(SettingsFrameId id, TimerWheel* timers) :
+        request_id_((uint32_t)id), timers_(timers),
+        transport_((uint32_t)id, responseId((uint32_t)id),
+            SETTINGS_ISOTP_BLOCK_SIZE, SETTINGS_ISOTP_ST_MIN, SETTINGS_ISOTP_TIMEOUT, timers),
+        steps_(nullptr), started_(0), duration_(0), step_started_(0),
+        step_(kSettingsStepDone), round_trips_(0), attempts_(0), sent_(false),
+        aborting_(false), failed_(false), pending_count_(0), batch_count_(0),
+        batch_index_(0) {
+    memset(latency_, 0, sizeof(latency_));
+}
+
+bool SettingsSequence::trigger(const SettingsStep* steps) {
+    if (!ready()) {
         return false;
     }
-    started_ = clock_->millis();
-    state_ = STATE_ENTER;
+    steps_ = steps;
+    step_ = 0;
+    started_ = timers_->now();
+    round_trips_ = 0;
+    attempts_ = 0;
     sent_ = false;
+    aborting_ = false;
+    failed_ = false;
     return true;
 }
 
 bool SettingsSequence::ready() const {
-    return state_ == STATE_READY;
+    return step_ == kSettingsStepDone;
 }
 
 bool SettingsSequence::receive(Frame* frame) {
-    if (clock_->millis() - started_ >= SETTINGS_RESPONSE_TIMEOUT) {
-        state_ = STATE_READY;
-        return false;
+    if (!ready() && sent_ && timeout_.expired()) {
+        transport_.reset();
+        SettingsLatency* latency = &latency_[requestType(steps_[step_])];
+        if (attempts_ <= SETTINGS_RESPONSE_RETRIES) {
+            ERROR_MSG_VAL_FMT("settings: resending request: ", request_id_, HEX);
+            ++latency->retries;
+            sent_ = false;
+        } else {
+            ++latency->failures;
+            abort();
+        }
+    }
+    if (!ready() && !sent_) {
+        const SettingsStep& step = steps_[step_];
+        byte request[3];
+        memcpy(request, step.request, 3);
+        if (step.flags & STEP_BATCH) {
+            request[1] = batch_[batch_index_].update;
+            request[2] = batch_[batch_index_].value;
+        }
+        sent_ = transport_.write(request, step.request_len);
+        if (sent_) {
+            step_started_ = timers_->now();
+            timers_->start(&timeout_, SETTINGS_RESPONSE_TIMEOUT);
+            ++attempts_;
+        }
     }
-    if (state_ == STATE_READY || sent_) {
+
+    if (!transport_.receive(frame)) {
         return false;
     }
-    sent_ = true;
-    bool result = fillRequest(frame, request_id_, state_, value_);
-    return result;
+    // consecutive frames continue a request that has already been counted
+    if (!ready() && (frame->data[0] & 0xF0) != 0x20) {
+        ++round_trips_;
+    }
+    return true;
 }
 
-void SettingsSequence::send(const Frame& frame) {
+bool SettingsSequence::send(const Frame& frame) {
     if (frame.id != responseId(request_id_)) {
         // not destined for this sequence
         ERROR_MSG_FRAME("settings: unrecognized frame: ", frame);
-        return;
+        return false;
     }
-    if (!matchState(frame.data, state_)) {
-        // frame does not match the current state
-        return;
+    if (!ready() && sent_ && (frame.data[0] & 0xF0) != 0x00) {
+        // A segmented transfer is in progress. The deadline covers the wait
+        // for the next frame rather than the whole response.
+        timers_->start(&timeout_, SETTINGS_RESPONSE_TIMEOUT);
     }
-    uint8_t nextState = next();
-    if (state_ != nextState) {
-        state_ = nextState;
-        sent_ = false;
+    if (!transport_.send(frame)) {
+        return false;
     }
+    if (ready()) {
+        return true;
+    }
+
+    const byte* message = transport_.message();
+    uint16_t len = transport_.length();
+    const SettingsStep& step = steps_[step_];
+    if (len < step.match || memcmp(message, step.response, step.match) != 0) {
+        // message does not match the current step
+        return true;
+    }
+    if (step.flags & STEP_BATCH) {
+        if (len < 2 || message[1] != batch_[batch_index_].update) {
+            return true;
+        }
+        record(timers_->now() - step_started_);
+        if (++batch_index_ < batch_count_) {
+            // send the next update in the batch
+            sent_ = false;
+            attempts_ = 0;
+            return true;
+        }
+    } else {
+        record(timers_->now() - step_started_);
+    }
+    advance();
+    return true;
 }
 
-uint8_t SettingsSequence::next() {
-    switch (request_id_) {
-        case SETTINGS_FRAME_E:
-            return nextE();
-        case SETTINGS_FRAME_F:
-            return nextF();
-        default:
-            return STATE_READY;
-    }
-}
-
-uint8_t SettingsInit::nextE() {
-    switch (state()) {
-        case STATE_ENTER:
-            return STATE_INIT_00;
-        case STATE_INIT_00:
-            return STATE_INIT_20;
-        case STATE_INIT_20:
-            return STATE_INIT_40;
-        case STATE_INIT_40:
-            return STATE_INIT_60;
-        case STATE_INIT_60:
-            return STATE_EXIT;
-        default:
-            return STATE_READY;
+bool SettingsSequence::queue(uint8_t update, uint8_t value) {
+    for (uint8_t i = 0; i < pending_count_; i++) {
+        if (pending_[i].update == update) {
+            pending_[i].value = value;
+            return true;
+        }
+    }
+    if (pending_count_ >= kMaxUpdates) {
+        ERROR_MSG_VAL("settings: update queue full, dropped ", update);
+        return false;
     }
+    pending_[pending_count_].update = update;
+    pending_[pending_count_].value = value;
+    ++pending_count_;
+    return true;
 }
 
-uint8_t SettingsInit::nextF() {
-    switch (state()) {
-        case STATE_ENTER:
-            return STATE_INIT_00;
-        case STATE_INIT_00:
-            return STATE_EXIT;
-        default:
-            return STATE_READY;
-    }
-}
-
-uint8_t SettingsRetrieve::nextE() {
-    switch (state()) {
-        case STATE_ENTER:
-            return STATE_RETRIEVE_71E_10;
-        case STATE_RETRIEVE_71E_10:
-            state2x_ = false;
-            return STATE_RETRIEVE_71E_2X;
-        case STATE_RETRIEVE_71E_2X:
-            if (state2x_) {
-                return STATE_EXIT;
-            } else {
-                state2x_ = true;
-                return STATE_RETRIEVE_71E_2X;
-            }
-        default:
-            return STATE_READY;
+void SettingsSequence::advance() {
+    timers_->stop(&timeout_);
+    step_ = steps_[step_].next;
+    sent_ = false;
+    attempts_ = 0;
+    if (step_ == kSettingsStepDone) {
+        finish();
+        return;
+    }
+    if (steps_[step_].flags & STEP_BATCH) {
+        // run all updates pending at the start of the batch
+        memcpy(batch_, pending_, sizeof(Update) * pending_count_);
+        batch_count_ = pending_count_;
+        batch_index_ = 0;
+        pending_count_ = 0;
+        if (batch_count_ == 0) {
+            advance();
+        }
     }
 }
 
-uint8_t SettingsRetrieve::nextF() {
-    switch (state()) {
-        case STATE_ENTER:
-            return STATE_RETRIEVE_71F_05;
-        case STATE_RETRIEVE_71F_05:
-            return STATE_EXIT;
-        default:
-            return STATE_READY;
+void SettingsSequence::abort() {
+    failed_ = true;
+    if (aborting_ || steps_[step_].next == kSettingsStepDone) {
+        // the exit request failed; give up on the session
+        ERROR_MSG_VAL_FMT("settings: exit failed: ", request_id_, HEX);
+        step_ = kSettingsStepDone;
+        finish();
+        return;
     }
+    ERROR_MSG_VAL_FMT("settings: session failed: ", request_id_, HEX);
+    aborting_ = true;
+    steps_ = kSettingsExit;
+    step_ = 0;
+    sent_ = false;
+    attempts_ = 0;
 }
 
-void SettingsUpdate::setPayload(uint8_t update, uint8_t value) {
-    update_ = update;
-    setValue(value);
+void SettingsSequence::finish() {
+    duration_ = timers_->now() - started_;
+    INFO_MSG_VAL("settings: session round trips: ", round_trips_);
+    INFO_MSG_VAL("settings: session duration ms: ", duration_);
+    INFO_MSG_VAL("settings: session max latency ms: ", latency_[REQUEST_SESSION].max);
+    INFO_MSG_VAL("settings: write max latency ms: ", latency_[REQUEST_WRITE].max);
+    INFO_MSG_VAL("settings: read max latency ms: ", latency_[REQUEST_READ].max);
 }
 
-uint8_t SettingsUpdate::nextE() {
-    const uint8_t state = this->state();
-    if (state == STATE_ENTER) {
-        return update_;
-    } else if (state == update_) {
-        return STATE_RETRIEVE_71E_10;
-    } else if (state == STATE_RETRIEVE_71E_10) {
-        state2x_ = false;
-        return STATE_RETRIEVE_71E_2X;
-    } else if (state == STATE_RETRIEVE_71E_2X) {
-        if (state2x_) {
-            return STATE_EXIT;
-        } else {
-            state2x_ = true;
-            return STATE_RETRIEVE_71E_2X;
-        }
+void SettingsSequence::record(uint32_t latency) {
+    SettingsLatency* stats = &latency_[requestType(steps_[step_])];
+    if (latency > 0xFFFF) {
+        latency = 0xFFFF;
     }
-    return STATE_READY;
-}
-
-uint8_t SettingsUpdate::nextF() {
-    const uint8_t state = this->state();
-    if (state == STATE_ENTER) {
-        return update_;
-    } else if (state == update_) {
-        return STATE_RETRIEVE_71F_05;
-    } else if (state == STATE_RETRIEVE_71F_05) {
-        return STATE_EXIT;
-    }
-    return STATE_READY;
-}
-
-uint8_t SettingsReset::nextE() {
-    switch (state()) {
-        case STATE_ENTER:
-            return STATE_RESET;
-        case STATE_RESET:
-            return STATE_RETRIEVE_71E_10;
-        case STATE_RETRIEVE_71E_10:
-            state2x_ = false;
-            return STATE_RETRIEVE_71E_2X;
-        case STATE_RETRIEVE_71E_2X:
-            if (state2x_) {
-                return STATE_EXIT;
-            } else {
-                state2x_ = true;
-                return STATE_RETRIEVE_71E_2X;
-            }
-        default:
-            return STATE_READY;
+    if (stats->count == 0 || latency < stats->min) {
+        stats->min = latency;
     }
-}
-
-uint8_t SettingsReset::nextF() {
-    switch (state()) {
-        case STATE_ENTER:
-            return STATE_RESET;
-        case STATE_RESET:
-            return STATE_RETRIEVE_71F_05;
-        case STATE_RETRIEVE_71F_05:
-            return STATE_EXIT;
-        default:
-            return STATE_READY;
+    if (latency > stats->max) {
+        stats->max = latency;
     }
+    stats->total += latency;
+    ++stats->count;
 }
 
-Settings::Settings(Clock* clock) :
-        initE_(SETTINGS_FRAME_E, clock), retrieveE_(SETTINGS_FRAME_E, clock),
-        updateE_(SETTINGS_FRAME_E, clock), resetE_(SETTINGS_FRAME_E, clock),
-        initF_(SETTINGS_FRAME_F, clock), retrieveF_(SETTINGS_FRAME_F, clock),
-        updateF_(SETTINGS_FRAME_F, clock), resetF_(SETTINGS_FRAME_F, clock),
-        clock_(clock), state_changed_(false), state_last_broadcast_(0) {
+Settings::Settings(TimerWheel* timers) :
+        sequenceE_(SETTINGS_FRAME_E, timers), sequenceF_(SETTINGS_FRAME_F, timers),
+        timers_(timers), state_init_(0), state_changed_(false) {
     initFrame(&state_, SETTINGS_STATE_FRAME_ID, 8);
     memset(control_state_, 0, 8);
+    timers_->start(&state_timer_, SETTINGS_STATE_FRAME_HB);
 }
 
 void Settings::receive(const Broadcast& broadcast) {
-    if (initE_.receive(&buffer_)) {
-        broadcast(buffer_);
-    } else if (retrieveE_.receive(&buffer_)) {
-        broadcast(buffer_);
-    } else if (updateE_.receive(&buffer_)) {
-        broadcast(buffer_);
-    } else if (resetE_.receive(&buffer_)) {
-        broadcast(buffer_);
+    if (sequenceE_.pending() && sequenceE_.ready()) {
+        sequenceE_.trigger(kSettingsUpdate);
+    }
+    if (sequenceF_.pending() && sequenceF_.ready()) {
+        sequenceF_.trigger(kSettingsUpdate);
     }
 
-    if (initF_.receive(&buffer_)) {
-        broadcast(buffer_);
-    } else if (retrieveF_.receive(&buffer_)) {
-        broadcast(buffer_);
-    } else if (updateF_.receive(&buffer_)) {
+    if (sequenceE_.receive(&buffer_)) {
         broadcast(buffer_);
-    } else if (resetF_.receive(&buffer_)) {
+    }
+    if (sequenceF_.receive(&buffer_)) {
         broadcast(buffer_);
     }
 
-    if (state_changed_ || clock_->millis() - state_last_broadcast_ >= SETTINGS_STATE_FRAME_HB) {
+    if (state_init_ != 0 && (state_changed_ || !state_timer_.active())) {
+        state_changed_ = false;
+        timers_->start(&state_timer_, SETTINGS_STATE_FRAME_HB);
         broadcast(state_);
     }
 }
 
 void Settings::send(const Frame& frame) {
+    TRACE_FRAME("settings: received ", frame);
     if (frame.len < 8) {
         return;
     }
     if (frame.id == responseId(SETTINGS_FRAME_E)) {
-        initE_.send(frame);
-        retrieveE_.send(frame);
-        updateE_.send(frame);
-        resetE_.send(frame);
-        handleState(frame);
+        if (sequenceE_.send(frame)) {
+            handleStateE(sequenceE_.message(), sequenceE_.length());
+        }
     } else if (frame.id == responseId(SETTINGS_FRAME_F)) {
-        initF_.send(frame);
-        retrieveF_.send(frame);
-        updateF_.send(frame);
-        resetF_.send(frame);
-        handleState(frame);
+        if (sequenceF_.send(frame)) {
+            handleStateF(sequenceF_.message(), sequenceF_.length());
+        }
     } else if (frame.id == SETTINGS_CONTROL_FRAME_ID) {
         handleControl(frame);
     }
 }
 
-void Settings::handleState(const Frame& frame) {
-    if (matchPrefix(frame.data, 0x05)) {
-        handleState05(frame.data);
-    } else if (matchPrefix(frame.data, 0x10)) {
-        handleState10(frame.data);
-    } else if (matchPrefix(frame.data, 0x21)) {
-        handleState21(frame.data);
-    } else if (matchPrefix(frame.data, 0x22)) {
-        handleState22(frame.data);
+void Settings::handleStateF(const byte* data, uint16_t len) {
+    if (len < 3 || data[0] != 0x61 || data[1] != 0x01) {
+        return;
     }
+    state_init_ |= 0x02;
+    setSlideDriverSeatBackOnExit(getBit(data, 2, 0));
 }
 
-void Settings::handleState05(const byte* data) {
-    setSlideDriverSeatBackOnExit(getBit(data, 3, 0));
-}
-
-void Settings::handleState10(const byte* data) {
-    setAutoInteriorIllumination(getBit(data, 4, 5));
-    setSelectiveDoorUnlock(getBit(data, 4, 7));
-    setRemoteKeyResponseHorn(getBit(data, 7, 3));
-}
+void Settings::handleStateE(const byte* data, uint16_t len) {
+    if (len < 14 || data[0] != 0x61 || data[1] != 0x01) {
+        return;
+    }
+    state_init_ |= 0x01;
+    setAutoInteriorIllumination(getBit(data, 2, 5));
+    setSelectiveDoorUnlock(getBit(data, 2, 7));
+    setRemoteKeyResponseHorn(getBit(data, 5, 3));
 
-void Settings::handleState21(const byte* data) {
     // Translates incoming state to our owns tate representation. A 0 value
     // typically represents the default on the BCM side.
 
-    switch ((data[1] >> 6) & 0x03) {
+    switch ((data[6] >> 6) & 0x03) {
         case 0x00:
             setRemoteKeyResponseLights(Settings::LIGHTS_OFF);
             break;
@@ -445,7 +359,7 @@ void Settings::handleState21(const byte* data) {
             break;
     }
 
-    switch ((data[1] >> 4) & 0x03) {
+    switch ((data[6] >> 4) & 0x03) {
         case 0x00:
             setAutoReLockTime(Settings::RELOCK_1M);
             break;
@@ -457,7 +371,7 @@ void Settings::handleState21(const byte* data) {
             break;
     }
 
-    switch ((data[2] >> 2) & 0x03) {
+    switch ((data[7] >> 2) & 0x03) {
         case 0x03:
             setAutoHeadlightSensitivity(0);
             break;
@@ -472,7 +386,7 @@ void Settings::handleState21(const byte* data) {
             break;
     }
 
-    switch (((data[2] & 0x01) << 2) | ((data[3] >> 6) & 0x03)) {
+    switch (((data[7] & 0x01) << 2) | ((data[8] >> 6) & 0x03)) {
         case 0x01:
             setAutoHeadlightOffDelay(Settings::DELAY_0S);
             break;
@@ -498,43 +412,55 @@ void Settings::handleState21(const byte* data) {
             setAutoHeadlightOffDelay(Settings::DELAY_180S);
             break;
     }
-}
 
-void Settings::handleState22(const byte* data) {
-    setSpeedSensingWiperInterval(!getBit(data, 1, 7));
+    setSpeedSensingWiperInterval(!getBit(data, 13, 7));
 }
 
 void Settings::handleControl(const Frame& frame) {
-    // check if any bits have flipped
+    // check if any bits have flipped; changes are batched into one session
     if (xorBits(control_state_, frame.data, 0, 0)) {
         toggleAutoInteriorIllumination();
-    } else if (xorBits(control_state_, frame.data, 0, 1)) {
+    }
+    if (xorBits(control_state_, frame.data, 0, 1)) {
         toggleSlideDriverSeatBackOnExit();
-    } else if (xorBits(control_state_, frame.data, 0, 2)) {
+    }
+    if (xorBits(control_state_, frame.data, 0, 2)) {
         toggleSpeedSensingWiperInterval();
-    } else if (xorBits(control_state_, frame.data, 1, 0)) {
+    }
+    if (xorBits(control_state_, frame.data, 1, 0)) {
         nextAutoHeadlightSensitivity();
-    } else if (xorBits(control_state_, frame.data, 1, 1)) {
+    }
+    if (xorBits(control_state_, frame.data, 1, 1)) {
         prevAutoHeadlightSensitivity();
-    } else if (xorBits(control_state_, frame.data, 1, 4)) {
+    }
+    if (xorBits(control_state_, frame.data, 1, 4)) {
         nextAutoHeadlightOffDelay();
-    } else if (xorBits(control_state_, frame.data, 1, 5)) {
+    }
+    if (xorBits(control_state_, frame.data, 1, 5)) {
         prevAutoHeadlightOffDelay();
-    } else if (xorBits(control_state_, frame.data, 2, 0)) {
+    }
+    if (xorBits(control_state_, frame.data, 2, 0)) {
         toggleSelectiveDoorUnlock();
-    } else if (xorBits(control_state_, frame.data, 2, 4)) {
+    }
+    if (xorBits(control_state_, frame.data, 2, 4)) {
         nextAutoReLockTime();
-    } else if (xorBits(control_state_, frame.data, 2, 5)) {
+    }
+    if (xorBits(control_state_, frame.data, 2, 5)) {
         prevAutoReLockTime();
-    } else if (xorBits(control_state_, frame.data, 3, 0)) {
+    }
+    if (xorBits(control_state_, frame.data, 3, 0)) {
         toggleRemoteKeyResponseHorn();
-    } else if (xorBits(control_state_, frame.data, 3, 2)) {
+    }
+    if (xorBits(control_state_, frame.data, 3, 2)) {
         nextRemoteKeyResponseLights();
-    } else if (xorBits(control_state_, frame.data, 3, 3)) {
+    }
+    if (xorBits(control_state_, frame.data, 3, 3)) {
         prevRemoteKeyResponseLights();
-    } else if (xorBits(control_state_, frame.data, 7, 0)) {
+    }
+    if (xorBits(control_state_, frame.data, 7, 0)) {
         retrieveSettings();
-    } else if (xorBits(control_state_, frame.data, 7, 7)) {
+    }
+    if (xorBits(control_state_, frame.data, 7, 7)) {
         resetSettingsToDefault();
     }
 
@@ -549,20 +475,10 @@ bool Settings::filter(uint32_t id) const {
 }
 
 bool Settings::init() {
-    if (!readyE() || !readyF()) {
+    if (!sequenceE_.ready() || !sequenceF_.ready()) {
         return false;
     }
-    return initE_.trigger() && initF_.trigger();
-}
-
-bool Settings::readyE() const {
-    return initE_.ready() && retrieveE_.ready() &&
-        updateE_.ready() && resetE_.ready();
-}
-
-bool Settings::readyF() const {
-    return initF_.ready() && retrieveF_.ready() &&
-        updateF_.ready() && resetF_.ready();
+    return sequenceE_.trigger(kSettingsInitE) && sequenceF_.trigger(kSettingsInitF);
 }
 
 bool Settings::getAutoInteriorIllumination() const {
@@ -654,11 +570,7 @@ void Settings::setSlideDriverSeatBackOnExit(bool value) {
 }
 
 bool Settings::toggleAutoInteriorIllumination() {
-    if (!readyE()) {
-        return false;
-    }
-    updateE_.setPayload(STATE_AUTO_INTERIOR_ILLUM, !getAutoInteriorIllumination());
-    return updateE_.trigger();
+    return sequenceE_.queue(COMMAND_AUTO_INTERIOR_ILLUM, !getAutoInteriorIllumination());
 }
 
 bool Settings::nextAutoHeadlightSensitivity() {
@@ -670,108 +582,70 @@ bool Settings::prevAutoHeadlightSensitivity() {
 }
 
 bool Settings::triggerAutoHeadlightSensitivity(uint8_t value) {
-    if (!readyE() || value > 3) {
-        return false;
-    }
     switch (value) {
         case 0:
-            updateE_.setPayload(STATE_AUTO_HL_SENS, 0x03);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_SENS, 0x03);
         case 1:
-            updateE_.setPayload(STATE_AUTO_HL_SENS, 0x00);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_SENS, 0x00);
         case 2:
-            updateE_.setPayload(STATE_AUTO_HL_SENS, 0x01);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_SENS, 0x01);
         case 3:
-            updateE_.setPayload(STATE_AUTO_HL_SENS, 0x02);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_SENS, 0x02);
         default:
             return false;
     }
-    return updateE_.trigger();
 }
 
 bool Settings::nextAutoHeadlightOffDelay() {
-    if (!readyE()) {
-        return false;
-    }
     switch (getAutoHeadlightOffDelay()) {
         case DELAY_0S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x02);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x02);
         case DELAY_30S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x00);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x00);
         case DELAY_45S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x03);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x03);
         case DELAY_60S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x04);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x04);
         case DELAY_90S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x05);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x05);
         case DELAY_120S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x06);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x06);
         case DELAY_150S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x07);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x07);
         case DELAY_180S:
         default:
             return false;
     }
-    return updateE_.trigger();
 }
 
 bool Settings::prevAutoHeadlightOffDelay() {
-    if (!readyE()) {
-        return false;
-    }
     switch (getAutoHeadlightOffDelay()) {
         default:
         case DELAY_0S:
             return false;
         case DELAY_30S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x01);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x01);
         case DELAY_45S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x02);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x02);
         case DELAY_60S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x00);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x00);
         case DELAY_90S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x03);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x03);
         case DELAY_120S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x04);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x04);
         case DELAY_150S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x05);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x05);
         case DELAY_180S:
-            updateE_.setPayload(STATE_AUTO_HL_DELAY, 0x06);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_HL_DELAY, 0x06);
     }
-    return updateE_.trigger();
 }
 
 bool Settings::toggleSpeedSensingWiperInterval() {
-    if (!readyE()) {
-        return false;
-    }
-    updateE_.setPayload(STATE_SPEED_SENS_WIPER, getSpeedSensingWiperInterval());
-    return updateE_.trigger();
+    return sequenceE_.queue(COMMAND_SPEED_SENS_WIPER, getSpeedSensingWiperInterval());
 }
 
 bool Settings::toggleRemoteKeyResponseHorn() {
-    if (!readyE()) {
-        return false;
-    }
-    updateE_.setPayload(STATE_REMOTE_KEY_HORN, !getRemoteKeyResponseHorn());
-    return updateE_.trigger();
+    return sequenceE_.queue(COMMAND_REMOTE_KEY_HORN, !getRemoteKeyResponseHorn());
 }
 
 bool Settings::nextRemoteKeyResponseLights() {
@@ -783,75 +657,54 @@ bool Settings::prevRemoteKeyResponseLights() {
 }
 
 bool Settings::triggerRemoteKeyResponseLights(uint8_t value) {
-    if (!readyE() || value > 3) {
+    if (value > 3) {
         return false;
     }
-    updateE_.setPayload(STATE_REMOTE_KEY_LIGHT, value);
-    return updateE_.trigger();
+    return sequenceE_.queue(COMMAND_REMOTE_KEY_LIGHT, value);
 }
 
 bool Settings::nextAutoReLockTime() {
-    if (!readyE()) {
-        return false;
-    }
     switch (getAutoReLockTime()) {
         case RELOCK_OFF:
-            updateE_.setPayload(STATE_AUTO_RELOCK_TIME, 0x00);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_RELOCK_TIME, 0x00);
         case RELOCK_1M:
-            updateE_.setPayload(STATE_AUTO_RELOCK_TIME, 0x02);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_RELOCK_TIME, 0x02);
         case RELOCK_5M:
         default:
             return false;
     }
-    return updateE_.trigger();
 }
 
 bool Settings::prevAutoReLockTime() {
-    if (!readyE()) {
-        return false;
-    }
     switch (getAutoReLockTime()) {
         default:
         case RELOCK_OFF:
             return false;
         case RELOCK_1M:
-            updateE_.setPayload(STATE_AUTO_RELOCK_TIME, 0x01);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_RELOCK_TIME, 0x01);
         case RELOCK_5M:
-            updateE_.setPayload(STATE_AUTO_RELOCK_TIME, 0x00);
-            break;
+            return sequenceE_.queue(COMMAND_AUTO_RELOCK_TIME, 0x00);
     }
-    return updateE_.trigger();
 }
 
 bool Settings::toggleSelectiveDoorUnlock() {
-    if (!readyE()) {
-        return false;
-    }
-    updateE_.setPayload(STATE_SELECT_DOOR_UNLOCK, !getSelectiveDoorUnlock());
-    return updateE_.trigger();
+    return sequenceE_.queue(COMMAND_SELECT_DOOR_UNLOCK, !getSelectiveDoorUnlock());
 }
 
 bool Settings::toggleSlideDriverSeatBackOnExit() {
-    if (!readyF()) {
-        return false;
-    }
-    updateF_.setPayload(STATE_SLIDE_DRIVER_SEAT, !getSlideDriverSeatBackOnExit());
-    return updateF_.trigger();
+    return sequenceF_.queue(COMMAND_SLIDE_DRIVER_SEAT, !getSlideDriverSeatBackOnExit());
 }
 
 bool Settings::retrieveSettings() {
-    if (!readyE() || !readyF()) {
+    if (!sequenceE_.ready() || !sequenceF_.ready()) {
         return false;
     }
-    return retrieveE_.trigger() && retrieveF_.trigger();
+    return sequenceE_.trigger(kSettingsRetrieve) && sequenceF_.trigger(kSettingsRetrieve);
 }
 
 bool Settings::resetSettingsToDefault() {
-    if (!readyE() || !readyF()) {
+    if (!sequenceE_.ready() || !sequenceF_.ready()) {
         return false;
     }
-    return resetE_.trigger() && resetF_.trigger();
+    return sequenceE_.trigger(kSettingsReset) && sequenceF_.trigger(kSettingsReset);
 }
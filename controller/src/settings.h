@@ -4,7 +4,8 @@
 #include <Arduino.h>
 
 #include "bus.h"
-#include "clock.h"
+#include "isotp.h"
+#include "timer.h"
 
 
 // Valid frame IDs for settings.
@@ -13,18 +14,94 @@ enum SettingsFrameId : uint32_t {
     SETTINGS_FRAME_F = 0x71F,
 };
 
-// Send a sequence of frames for managing settings.
+// Step flags.
+enum SettingsStepFlags : uint8_t {
+    // Send the request and wait for a matching response.
+    STEP_REQUEST = 0x00,
+    // Send one update request for each queued update in the batch.
+    STEP_BATCH = 0x01,
+};
+
+// Marks the end of a sequence table.
+static const uint8_t kSettingsStepDone = 0xFF;
+
+// A single step in a settings sequence. Sequences are defined as constant
+// tables of steps. Each step sends a request message and waits for a response
+// message which matches the expected prefix before moving to the next step.
+// Messages are exchanged over ISO-TP so requests and responses do not include
+// the frame's protocol control byte.
+struct SettingsStep {
+    // Flags which control how the step is run.
+    uint8_t flags;
+    // Request message. Bytes 1 and 2 are replaced with the update and value
+    // for batch steps.
+    byte request[3];
+    // The length of the request message.
+    uint8_t request_len;
+    // Expected response prefix. Batch steps also match the update in byte 1.
+    byte response[2];
+    // The number of response bytes to match.
+    uint8_t match;
+    // Index of the next step or kSettingsStepDone.
+    uint8_t next;
+};
+
+// Request types for which response latency is tracked.
+enum SettingsRequestType : uint8_t {
+    // Enter and exit settings mode.
+    REQUEST_SESSION = 0,
+    // Init, update, and reset requests.
+    REQUEST_WRITE = 1,
+    // State requests.
+    REQUEST_READ = 2,
+    REQUEST_TYPE_COUNT = 3,
+};
+
+// Response latency statistics for a request type. Latency is measured from
+// sending a request to receiving the complete matching response.
+struct SettingsLatency {
+    // The number of responses received.
+    uint16_t count;
+    // The number of requests resent after a missed deadline.
+    uint16_t retries;
+    // The number of requests which failed after all retries.
+    uint16_t failures;
+    // Minimum and maximum latency in ms.
+    uint16_t min;
+    uint16_t max;
+    // Sum of all latencies in ms. Divide by count for the mean.
+    uint32_t total;
+};
+
+// Sequence tables for each BCM operation. Init differs per frame ID. The
+// remaining operations are the same on both frame IDs.
+extern const SettingsStep kSettingsInitE[];
+extern const SettingsStep kSettingsInitF[];
+extern const SettingsStep kSettingsRetrieve[];
+extern const SettingsStep kSettingsUpdate[];
+extern const SettingsStep kSettingsReset[];
+
+// Runs sequence tables to exchange messages with the BCM over a single frame
+// ID. Only one sequence runs at a time. Setting updates are queued and applied
+// in a batch by the next update sequence. Messages are segmented and
+// reassembled by an ISO-TP transport owned by the sequence.
+//
+// Each request must be answered within SETTINGS_RESPONSE_TIMEOUT. Requests are
+// resent up to SETTINGS_RESPONSE_RETRIES times. If a request still fails then
+// the sequence sends an exit request so the BCM does not remain in settings
+// mode and the sequence ends.
 class SettingsSequence {
     public:
+        // The maximum number of distinct settings in a batch.
+        static const uint8_t kMaxUpdates = 9;
+
         // Create a sequence that communicates over the given frame ID.
-        SettingsSequence(SettingsFrameId id, Clock* clock = Clock::real()) :
-            request_id_((uint32_t)id), clock_(clock), started_(0),
-            value_(0xFF), state_(0), sent_(false) {}
+        SettingsSequence(SettingsFrameId id, TimerWheel* timers = TimerWheel::real());
 
-        // Trigger the sequence. The next call to receive will broadcast the
-        // first frame of the sequence. The sequence expects the next frame to
-        // match otherwise it resets.
-        bool trigger();
+        // Trigger the sequence defined by the given table. The next call to
+        // receive will broadcast the first frame of the sequence. Return false
+        // if a sequence is already running.
+        bool trigger(const SettingsStep* steps);
 
         // Return true if the sequence is ready to send.
         bool ready() const;
@@ -33,90 +110,84 @@ class SettingsSequence {
         // if the frame should be sent or false otherwise.
         bool receive(Frame* frame);
 
-        // Send a response frame back to the sequence. The frame frame matches
-        // the expected sequence then the sequence advances to the next state.
-        // Otherwise the sequence resets.
-        void send(const Frame& frame);
+        // Send a response frame back to the sequence. Return true when the
+        // frame completes a response message. If the message matches the
+        // current step then the sequence advances to the next step. Messages
+        // which do not match are ignored.
+        bool send(const Frame& frame);
 
-    protected:
-        // The sequence's request ID.
-        uint32_t requestId() const { return request_id_; }
+        // The most recently received response message.
+        const byte* message() const { return transport_.message(); }
 
-        // The sequence's current state.
-        uint8_t state() const { return state_; }
+        // The length of the most recently received response message.
+        uint16_t length() const { return transport_.length(); }
 
-        // Set the value to send with the state frames that require value.
-        void setValue(uint8_t value) { value_ = value; }
+        // Queue an item to update and its value. Queued items are sent by the
+        // next batch step. Queuing an item that is already pending replaces
+        // its value. Return false if the queue is full.
+        bool queue(uint8_t update, uint8_t value);
 
-        // Return the next state. If the returned state matches the incoming
-        // rame then the sequence transitions to the new state and a frame for
-        // the state is sent. If this returns the no state transition occurs
-        // and no frame is sent.
-        virtual uint8_t nextE() = 0;
-        virtual uint8_t nextF() = 0;
-    private:
-        const uint32_t request_id_;
-        Clock* clock_;
-        uint32_t started_;
-        uint8_t value_;
-        uint8_t state_;
-        bool sent_;
-        uint8_t next();
-};
+        // Return true if updates are waiting for a session.
+        bool pending() const { return pending_count_ > 0; }
 
-// Sequence to initialize communication with the BCM.
-class SettingsInit : public SettingsSequence {
-    public:
-        SettingsInit(SettingsFrameId id, Clock* clock = Clock::real()) :
-            SettingsSequence(id, clock) {}
-    protected:
-        uint8_t nextE() override;
-        uint8_t nextF() override;
-};
+        // The number of request/response round trips completed by the current
+        // or most recent session.
+        uint8_t roundTrips() const { return round_trips_; }
 
-// Sequence used to retrieve settings from the BCM.
-class SettingsRetrieve : public SettingsSequence {
-    public:
-        SettingsRetrieve(SettingsFrameId id, Clock* clock = Clock::real()) :
-            SettingsSequence(id, clock), state2x_(false) {}
-    protected:
-        uint8_t nextE() override;
-        uint8_t nextF() override;
-    private:
-        bool state2x_;
-};
+        // The duration in milliseconds of the most recently completed session.
+        uint32_t duration() const { return duration_; }
 
-// Sequence used to update a setting in the BCM.
-class SettingsUpdate : public SettingsSequence {
-    public:
-        SettingsUpdate(SettingsFrameId id, Clock* clock = Clock::real()) :
-            SettingsSequence(id, clock), update_(0), state2x_(false) {}
-
-        // Set the item to update and its value. 
-        void setPayload(uint8_t update, uint8_t value);
-    protected:
-        uint8_t nextE() override;
-        uint8_t nextF() override;
-    private:
-        uint8_t update_;
-        bool state2x_;
-};
+        // Return true if the current or most recent session failed.
+        bool failed() const { return failed_; }
+
+        // Response latency statistics for the given request type. Collected
+        // across all sessions.
+        const SettingsLatency& latency(SettingsRequestType type) const { return latency_[type]; }
 
-class SettingsReset : public SettingsSequence {
-    public:
-        SettingsReset(SettingsFrameId id, Clock* clock = Clock::real()) :
-            SettingsSequence(id, clock), state2x_(false) {}
-    protected:
-        uint8_t nextE() override;
-        uint8_t nextF() override;
     private:
-        bool state2x_;
+        struct Update {
+            uint8_t update;
+            uint8_t value;
+        };
+
+        const uint32_t request_id_;
+        TimerWheel* timers_;
+        IsoTp transport_;
+        const SettingsStep* steps_;
+        uint32_t started_;
+        uint32_t duration_;
+        uint32_t step_started_;
+        Timer timeout_;
+        uint8_t step_;
+        uint8_t round_trips_;
+        uint8_t attempts_;
+        bool sent_;
+        bool aborting_;
+        bool failed_;
+        SettingsLatency latency_[REQUEST_TYPE_COUNT];
+
+        Update pending_[kMaxUpdates];
+        uint8_t pending_count_;
+        Update batch_[kMaxUpdates];
+        uint8_t batch_count_;
+        uint8_t batch_index_;
+
+        void advance();
+        void abort();
+        void finish();
+        void record(uint32_t latency);
 };
 
 // Communicates with the BCM to retrieve and update body control settings.
 // Periodically sends state frames with the current settings. Responds to
 // control frames to incrementally change settings.
 //
+// Setting changes are queued and sent to the BCM in a single session per
+// frame ID. Changes made while a session is running are sent in the next
+// session. Incremental changes are computed from the last state retrieved
+// from the BCM so repeating a change before its session starts replaces the
+// queued value.
+//
 // Frame 0x5700: Settings State Frame
 //   Byte 0: Interior & Wipers
 //     Bit 0: Auto Interior Illumination; 0 off, 1 on
@@ -134,7 +205,14 @@ class SettingsReset : public SettingsSequence {
 //   Byte 3: Remote Key
 //     Bit 0: Remote Key Response Horn; 0 off, 1 on
 //     Bits 2-3: Remote Key Response Lights; 0 off, 1 unlock, 2 lock, 3 on
-//   Bytes 4-7: unused
+//   Bytes 4-5: unused
+//   Byte 6: Snapshot
+//     Bit 0-6: unused
+//     Bit 7: stale; set when restored from storage on boot
+//   Byte 7: unused
+//
+// The state frame is not sent until the BCM has responded to a retrieve
+// request.
 //
 // Frame 0x5701: Settings Control Frame
 //   Byte 0: Interior & Wipers
@@ -168,7 +246,7 @@ class SettingsReset : public SettingsSequence {
 //     Bit 7: Reset Settings to Default
 class Settings : public Node {
     public:
-        Settings(Clock* clock = Clock::real());
+        Settings(TimerWheel* timers = TimerWheel::real());
 
         // Recieve frames from the node.
         void receive(const Broadcast& broadcast) override;
@@ -207,28 +285,17 @@ class Settings : public Node {
             RELOCK_5M = 5,
         };
 
-        void handleState(const Frame& frame);
-        void handleState05(const byte* data);
-        void handleState10(const byte* data);
-        void handleState21(const byte* data);
-        void handleState22(const byte* data);
+        void handleStateE(const byte* data, uint16_t len);
+        void handleStateF(const byte* data, uint16_t len);
         void handleControl(const Frame& frame);
 
-        SettingsInit initE_;
-        SettingsRetrieve retrieveE_;
-        SettingsUpdate updateE_;
-        SettingsReset resetE_;
-        bool readyE() const;
-
-        SettingsInit initF_;
-        SettingsRetrieve retrieveF_;
-        SettingsUpdate updateF_;
-        SettingsReset resetF_;
-        bool readyF() const;
+        SettingsSequence sequenceE_;
+        SettingsSequence sequenceF_;
 
-        Clock* clock_;
+        TimerWheel* timers_;
+        uint8_t state_init_;
         bool state_changed_;
-        uint32_t state_last_broadcast_;
+        Timer state_timer_;
         Frame buffer_;
         Frame state_;
         byte control_state_[8];
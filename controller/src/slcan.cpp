@@ -0,0 +1,171 @@
+#include "slcan.h"
+
+#include "debug.h"
+#include "hex.h"
+
+#define LOG_MODULE LOG_SERIAL
+
+
+static const char kSlcanOk[] = "\r";
+static const char kSlcanError[] = "\a";
+
+Slcan::Slcan(TimerWheel* timers) :
+        timers_(timers), stream_(nullptr), line_len_(0), overflow_(false), open_(false),
+        listen_only_(false), timestamps_(false), dropped_(0) {}
+
+void Slcan::begin(Stream* stream) {
+    stream_ = stream;
+    line_len_ = 0;
+    overflow_ = false;
+    open_ = false;
+}
+
+void Slcan::receive(const Broadcast& broadcast) {
+    if (stream_ == nullptr) {
+        return;
+    }
+    while (stream_->available()) {
+        char c = stream_->read();
+        if (c == '\n') {
+            continue;
+        }
+        if (c != '\r') {
+            if (line_len_ < sizeof(line_) - 1) {
+                line_[line_len_++] = c;
+            } else {
+                overflow_ = true;
+            }
+            continue;
+        }
+
+        if (overflow_) {
+            ++dropped_;
+            ERROR_MSG("slcan: command overflow");
+            reply(kSlcanError);
+        } else if (line_len_ > 0) {
+            line_[line_len_] = 0;
+            command(broadcast);
+        }
+        line_len_ = 0;
+        overflow_ = false;
+    }
+}
+
+void Slcan::command(const Broadcast& broadcast) {
+    switch (line_[0]) {
+        case 'O':
+        case 'L':
+            if (open_) {
+                reply(kSlcanError);
+                return;
+            }
+            open_ = true;
+            listen_only_ = line_[0] == 'L';
+            reply(kSlcanOk);
+            return;
+        case 'C':
+            open_ = false;
+            reply(kSlcanOk);
+            return;
+        case 'S':
+            reply(line_len_ == 2 && line_[1] >= '0' && line_[1] <= '8' ? kSlcanOk : kSlcanError);
+            return;
+        case 's':
+        case 'M':
+        case 'm':
+        case 'X':
+            reply(kSlcanOk);
+            return;
+        case 'Z':
+            if (line_len_ != 2 || (line_[1] != '0' && line_[1] != '1')) {
+                reply(kSlcanError);
+                return;
+            }
+            timestamps_ = line_[1] == '1';
+            reply(kSlcanOk);
+            return;
+        case 'V':
+            reply("V1013\r");
+            return;
+        case 'N':
+            reply("NR051\r");
+            return;
+        case 'F':
+            reply("F00\r");
+            return;
+        case 't':
+        case 'T':
+            if (!open_ || listen_only_ || !parseFrame(line_[0] == 'T')) {
+                reply(kSlcanError);
+                return;
+            }
+            reply(line_[0] == 'T' ? "Z\r" : "z\r");
+            broadcast(frame_);
+            return;
+        default:
+            reply(kSlcanError);
+            return;
+    }
+}
+
+bool Slcan::parseFrame(bool extended) {
+    uint8_t id_len = extended ? 8 : 3;
+    if (line_len_ < 2 + id_len) {
+        return false;
+    }
+    uint32_t id = 0;
+    for (uint8_t i = 1; i <= id_len; i++) {
+        int8_t v = hexValue(line_[i]);
+        if (v < 0) {
+            return false;
+        }
+        id = (id << 4) | v;
+    }
+    char dlc = line_[id_len + 1];
+    if (dlc < '0' || dlc > '8') {
+        return false;
+    }
+    uint8_t len = dlc - '0';
+    const char* data = line_ + id_len + 2;
+    if (line_len_ != id_len + 2 + len * 2) {
+        return false;
+    }
+    for (uint8_t i = 0; i < len; i++) {
+        int8_t hi = hexValue(data[i * 2]);
+        int8_t lo = hexValue(data[i * 2 + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        frame_.data[i] = (hi << 4) | lo;
+    }
+    frame_.id = id;
+    frame_.len = len;
+    return true;
+}
+
+void Slcan::send(const Frame& frame) {
+    if (stream_ == nullptr || !open_ || frame.len > 8) {
+        return;
+    }
+    // T + 8 ID digits + DLC + 16 data digits + 4 timestamp digits + CR
+    char buffer[30];
+    char* p = buffer;
+    if (frame.id > 0x7FF) {
+        *p++ = 'T';
+        p = writeHex(p, frame.id, 8);
+    } else {
+        *p++ = 't';
+        p = writeHex(p, frame.id, 3);
+    }
+    *p++ = '0' + frame.len;
+    p = writeHexBytes(p, frame.data, frame.len);
+    if (timestamps_) {
+        p = writeHex(p, timers_->now() % 60000, 4);
+    }
+    *p++ = '\r';
+    stream_->write((const uint8_t*)buffer, p - buffer);
+}
+
+void Slcan::reply(const char* msg) {
+    stream_->write((const uint8_t*)msg, strlen(msg));
+}
@@ -0,0 +1,75 @@
+#ifndef __R51_SLCAN_H__
+#define __R51_SLCAN_H__
+
+#include <Arduino.h>
+
+#include "bus.h"
+#include "config.h"
+#include "timer.h"
+
+// The default SLCAN_SERIAL is the same port as DEBUG_SERIAL and the ports
+// cannot be compared by the preprocessor.
+#if defined(SLCAN_ENABLE) && (defined(DEBUG_ENABLE) || defined(TRACE_ENABLE))
+#error SLCAN_ENABLE cannot be set with DEBUG_ENABLE or TRACE_ENABLE
+#endif
+
+
+// Speaks the SLCAN (Lawicel) serial protocol so the controller can be attached
+// to Linux with slcand and used as a CAN interface for logging and injection.
+// Commands and frames are terminated by a CR. Successful commands are
+// acknowledged with a CR and failed commands with a BEL.
+//
+// Supported commands:
+//   O: Open the channel
+//   L: Open the channel in listen only mode
+//   C: Close the channel
+//   Sn, sxxyy: Set the bitrate. Accepted and ignored.
+//   Zn: Disable (0) or enable (1) timestamps
+//   V, N, F: Report the version, serial number and status flags
+//   tiiildd...: Send a standard frame with a 3 digit ID
+//   Tiiiiiiiildd...: Send an extended frame with an 8 digit ID
+//
+// Frames are only accepted and written while the channel is open. Frames with
+// IDs above 0x7FF are written as extended frames. Frames longer than 8 bytes
+// are not written. With timestamps enabled each frame ends with the loop time
+// in ms modulo 60000 as 4 hex digits.
+class Slcan : public Node {
+    public:
+        Slcan(TimerWheel* timers = TimerWheel::real());
+
+        // Start reading commands from the stream.
+        void begin(Stream* stream);
+
+        // Process commands and broadcast received frames.
+        void receive(const Broadcast& broadcast) override;
+
+        // Write a frame to the stream if the channel is open.
+        void send(const Frame& frame) override;
+
+        // Matches all frames.
+        bool filter(uint32_t) const override { return true; }
+
+        // The number of commands which overflowed the command buffer.
+        uint32_t dropped() const override { return dropped_; }
+
+        // Return true if the channel is open.
+        bool open() const { return open_; }
+
+    private:
+        TimerWheel* timers_;
+        Stream* stream_;
+        char line_[32];
+        uint8_t line_len_;
+        bool overflow_;
+        bool open_;
+        bool listen_only_;
+        bool timestamps_;
+        uint32_t dropped_;
+        Frame frame_;
+
+        void command(const Broadcast& broadcast);
+        bool parseFrame(bool extended);
+        void reply(const char* msg);
+};
+
+#endif  // __R51_SLCAN_H__
@@ -0,0 +1,144 @@
+#include "snapshot.h"
+
+#include "binary.h"
+#include "config.h"
+#include "debug.h"
+
+#define LOG_MODULE LOG_SYSTEM
+
+
+// Each slot is stored as a marker byte, 8 data bytes, and a checksum byte.
+static const byte kSnapshotMarker = 0x51;
+static const size_t kSnapshotSlotSize = 10;
+
+static byte snapshotChecksum(const byte* data) {
+    byte sum = kSnapshotMarker;
+    for (uint8_t i = 0; i < 8; i++) {
+        sum += data[i];
+    }
+    return ~sum;
+}
+
+Snapshot::Snapshot(TimerWheel* timers, Storage* storage) :
+        timers_(timers), storage_(storage), stale_changed_(false) {
+    const uint32_t ids[kSlotCount] = {CLIMATE_STATE_FRAME_ID, SETTINGS_STATE_FRAME_ID};
+    for (uint8_t i = 0; i < kSlotCount; i++) {
+        slots_[i].id = ids[i];
+        memset(slots_[i].data, 0, 8);
+        memset(slots_[i].stored, 0, 8);
+        slots_[i].stale = false;
+        slots_[i].dirty = false;
+    }
+    timers_->start(&write_timer_, SNAPSHOT_WRITE_INTERVAL);
+    timers_->start(&stale_timer_, SNAPSHOT_STALE_HB);
+}
+
+void Snapshot::begin() {
+    if (storage_->size() < SNAPSHOT_STORAGE_OFFSET + kSnapshotSlotSize * kSlotCount) {
+        ERROR_MSG("snapshot: storage not available");
+        return;
+    }
+    for (uint8_t i = 0; i < kSlotCount; i++) {
+        if (load(i)) {
+            slots_[i].stale = true;
+            stale_changed_ = true;
+        }
+    }
+}
+
+void Snapshot::receive(const Broadcast& broadcast) {
+    if (stale_changed_ || !stale_timer_.active()) {
+        stale_changed_ = false;
+        timers_->start(&stale_timer_, SNAPSHOT_STALE_HB);
+        for (uint8_t i = 0; i < kSlotCount; i++) {
+            if (!slots_[i].stale) {
+                continue;
+            }
+            initFrame(&frame_, slots_[i].id, 8);
+            memcpy(frame_.data, slots_[i].data, 8);
+            setBit(frame_.data, SNAPSHOT_STALE_BYTE, SNAPSHOT_STALE_BIT, true);
+            broadcast(frame_);
+        }
+    }
+
+    if (!write_timer_.active()) {
+        for (uint8_t i = 0; i < kSlotCount; i++) {
+            if (slots_[i].dirty) {
+                store(i);
+                timers_->start(&write_timer_, SNAPSHOT_WRITE_INTERVAL);
+            }
+        }
+    }
+}
+
+void Snapshot::send(const Frame& frame) {
+    if (frame.len < 8 || getBit(frame.data, SNAPSHOT_STALE_BYTE, SNAPSHOT_STALE_BIT)) {
+        // ignore short frames and our own stale broadcasts
+        return;
+    }
+    Slot* slot = findSlot(frame.id);
+    if (slot == nullptr) {
+        return;
+    }
+    slot->stale = false;
+    memcpy(slot->data, frame.data, 8);
+    slot->dirty = memcmp(slot->data, slot->stored, 8) != 0;
+}
+
+bool Snapshot::filter(uint32_t id) const {
+    return id == CLIMATE_STATE_FRAME_ID || id == SETTINGS_STATE_FRAME_ID;
+}
+
+Snapshot::Slot* Snapshot::findSlot(uint32_t id) {
+    for (uint8_t i = 0; i < kSlotCount; i++) {
+        if (slots_[i].id == id) {
+            return &slots_[i];
+        }
+    }
+    return nullptr;
+}
+
+bool Snapshot::load(uint8_t index) {
+    size_t address = SNAPSHOT_STORAGE_OFFSET + index * kSnapshotSlotSize;
+    if (storage_->read(address) != kSnapshotMarker) {
+        return false;
+    }
+    byte data[8];
+    for (uint8_t i = 0; i < 8; i++) {
+        data[i] = storage_->read(address + 1 + i);
+    }
+    if (storage_->read(address + 9) != snapshotChecksum(data)) {
+        ERROR_MSG_VAL_FMT("snapshot: checksum error for frame ", slots_[index].id, HEX);
+        return false;
+    }
+    memcpy(slots_[index].data, data, 8);
+    memcpy(slots_[index].stored, data, 8);
+    return true;
+}
+
+void Snapshot::store(uint8_t index) {
+    Slot* slot = &slots_[index];
+    if (storage_->size() < SNAPSHOT_STORAGE_OFFSET + kSnapshotSlotSize * kSlotCount) {
+        slot->dirty = false;
+        return;
+    }
+
+    // Only write bytes which have changed to reduce wear.
+    size_t address = SNAPSHOT_STORAGE_OFFSET + index * kSnapshotSlotSize;
+    if (storage_->read(address) != kSnapshotMarker) {
+        storage_->write(address, kSnapshotMarker);
+    }
+    for (uint8_t i = 0; i < 8; i++) {
+        if (storage_->read(address + 1 + i) != slot->data[i]) {
+            storage_->write(address + 1 + i, slot->data[i]);
+        }
+    }
+    byte checksum = snapshotChecksum(slot->data);
+    if (storage_->read(address + 9) != checksum) {
+        storage_->write(address + 9, checksum);
+    }
+
+    memcpy(slot->stored, slot->data, 8);
+    slot->dirty = false;
+    INFO_MSG_VAL_FMT("snapshot: stored frame ", slot->id, HEX);
+}
@@ -0,0 +1,63 @@
+#ifndef __R51_SNAPSHOT__
+#define __R51_SNAPSHOT__
+
+#include <Arduino.h>
+
+#include "bus.h"
+#include "storage.h"
+#include "timer.h"
+
+
+// Persists the last known climate and settings state frames so the dashboard
+// can be populated immediately on boot.
+//
+// Restored frames are broadcast on begin with the stale bit set and repeated
+// on a heartbeat until a live frame with the same ID is seen on the bus. Live
+// frames are written back to storage only when their payload changes and no
+// more often than SNAPSHOT_WRITE_INTERVAL to limit flash wear.
+//
+// Stale Flag: Byte 6, Bit 7 of 0x5400 and 0x5700
+//   Set when the frame was restored from storage. Cleared in live frames.
+class Snapshot : public Node {
+    public:
+        Snapshot(TimerWheel* timers = TimerWheel::real(), Storage* storage = Storage::real());
+
+        // Load stored frames. Should be called once in setup before the bus
+        // loop starts.
+        void begin();
+
+        // Broadcast stale frames until live frames replace them. Flush changed
+        // frames to storage.
+        void receive(const Broadcast& broadcast) override;
+
+        // Record live state frames.
+        void send(const Frame& frame) override;
+
+        // Matches climate and settings state frames.
+        bool filter(uint32_t id) const override;
+
+    private:
+        static const uint8_t kSlotCount = 2;
+
+        struct Slot {
+            uint32_t id;
+            byte data[8];
+            byte stored[8];
+            bool stale;
+            bool dirty;
+        };
+
+        TimerWheel* timers_;
+        Storage* storage_;
+        Slot slots_[kSlotCount];
+        Timer write_timer_;
+        Timer stale_timer_;
+        bool stale_changed_;
+        Frame frame_;
+
+        Slot* findSlot(uint32_t id);
+        bool load(uint8_t index);
+        void store(uint8_t index);
+};
+
+#endif  // __R51_SNAPSHOT__
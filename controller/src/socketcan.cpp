@@ -0,0 +1,160 @@
+#include "socketcan.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "debug.h"
+
+#define LOG_MODULE LOG_CAN
+
+
+SocketCan::SocketCan(const char* iface) :
+        iface_(iface), fd_(-1), dropped_(0), timestamp_(0), tx_count_(0) {
+    memset(rx_msgs_, 0, sizeof(rx_msgs_));
+    memset(tx_msgs_, 0, sizeof(tx_msgs_));
+    for (uint8_t i = 0; i < SOCKETCAN_BATCH; i++) {
+        rx_iov_[i].iov_base = &rx_frames_[i];
+        rx_iov_[i].iov_len = sizeof(rx_frames_[i]);
+        tx_iov_[i].iov_base = &tx_frames_[i];
+        tx_iov_[i].iov_len = sizeof(tx_frames_[i]);
+        tx_msgs_[i].msg_hdr.msg_iov = &tx_iov_[i];
+        tx_msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+SocketCan::~SocketCan() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+void SocketCan::begin() {
+    while (!open()) {
+        delay(1000);
+    }
+}
+
+bool SocketCan::open() {
+    int fd = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK, CAN_RAW);
+    if (fd < 0) {
+        ERROR_MSG_VAL("socketcan: socket failed: errno ", errno);
+        return false;
+    }
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, iface_, IFNAMSIZ - 1);
+    if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0) {
+        ERROR_MSG_VAL("socketcan: interface not found: errno ", errno);
+        close(fd);
+        return false;
+    }
+
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP, &enable, sizeof(enable));
+
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        ERROR_MSG_VAL("socketcan: bind failed: errno ", errno);
+        close(fd);
+        return false;
+    }
+    fd_ = fd;
+    return true;
+}
+
+void SocketCan::receive(const Broadcast& broadcast) {
+    if (fd_ < 0) {
+        return;
+    }
+    flush();
+
+    for (uint8_t i = 0; i < SOCKETCAN_BATCH; i++) {
+        struct msghdr* hdr = &rx_msgs_[i].msg_hdr;
+        hdr->msg_iov = &rx_iov_[i];
+        hdr->msg_iovlen = 1;
+        hdr->msg_control = rx_control_[i];
+        hdr->msg_controllen = sizeof(rx_control_[i]);
+    }
+    int count = recvmmsg(fd_, rx_msgs_, SOCKETCAN_BATCH, MSG_DONTWAIT, nullptr);
+    if (count < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            ++dropped_;
+            ERROR_MSG_VAL("socketcan: read failed: errno ", errno);
+        }
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const struct can_frame& can = rx_frames_[i];
+        if (rx_msgs_[i].msg_len < sizeof(can) ||
+                (can.can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG)) != 0) {
+            continue;
+        }
+
+        timestamp_ = 0;
+        struct msghdr* hdr = &rx_msgs_[i].msg_hdr;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMP) {
+                struct timeval tv;
+                memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+                timestamp_ = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+            }
+        }
+
+        frame_.id = can.can_id & ((can.can_id & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK);
+        frame_.len = can.can_dlc > CAN_MAX_DLEN ? CAN_MAX_DLEN : can.can_dlc;
+        memcpy(frame_.data, can.data, frame_.len);
+        broadcast(frame_);
+    }
+}
+
+void SocketCan::send(const Frame& frame) {
+    if (fd_ < 0) {
+        return;
+    }
+    if (frame.len > CAN_MAX_DLEN) {
+        ++dropped_;
+        ERROR_MSG_FRAME("socketcan: frame too long ", frame);
+        return;
+    }
+    if (tx_count_ >= SOCKETCAN_BATCH) {
+        flush();
+    }
+
+    struct can_frame* can = &tx_frames_[tx_count_++];
+    memset(can, 0, sizeof(*can));
+    can->can_id = frame.id > CAN_SFF_MASK ? (frame.id & CAN_EFF_MASK) | CAN_EFF_FLAG : frame.id;
+    can->can_dlc = frame.len;
+    memcpy(can->data, frame.data, frame.len);
+}
+
+void SocketCan::flush() {
+    if (fd_ < 0) {
+        return;
+    }
+    uint8_t sent = 0;
+    while (sent < tx_count_) {
+        int count = sendmmsg(fd_, tx_msgs_ + sent, tx_count_ - sent, MSG_DONTWAIT);
+        if (count <= 0) {
+            // drop the rest of the batch rather than block the loop
+            dropped_ += tx_count_ - sent;
+            ERROR_MSG_VAL("socketcan: write failed: errno ", errno);
+            break;
+        }
+        sent += count;
+    }
+    tx_count_ = 0;
+}
+
+#endif  // __linux__
@@ -0,0 +1,70 @@
+#ifndef __R51_SOCKETCAN__
+#define __R51_SOCKETCAN__
+
+#if defined(__linux__)
+
+#include <Arduino.h>
+#include <linux/can.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "bus.h"
+#include "config.h"
+
+
+// A CAN node backed by a Linux SocketCAN raw socket. Allows the controller to
+// run as a Linux process against a virtual (vcan) or USB CAN interface.
+//
+// Frames are read with a single non-blocking recvmmsg() call per loop which
+// returns up to SOCKETCAN_BATCH frames. Frames sent to the node are queued
+// and written with a single sendmmsg() call at the start of the next loop or
+// when the queue is full. Frames with IDs above 0x7FF are sent as extended
+// frames. Remote and error frames are ignored.
+class SocketCan : public Node {
+    public:
+        SocketCan(const char* iface = SOCKETCAN_INTERFACE);
+        ~SocketCan();
+
+        // Open the socket. Retries until the interface is available.
+        void begin();
+
+        // Flush queued frames and receive frames from the socket.
+        void receive(const Broadcast& broadcast) override;
+
+        // Queue a frame to send to the socket.
+        void send(const Frame& frame) override;
+
+        // The number of frames which failed to be read or written.
+        uint32_t dropped() const override { return dropped_; }
+
+        // The kernel receive timestamp in microseconds of the frame being
+        // broadcast. Only valid during receive().
+        uint64_t timestamp() const { return timestamp_; }
+
+        // Write all queued frames to the socket.
+        void flush();
+
+    private:
+        const char* iface_;
+        int fd_;
+        uint32_t dropped_;
+        uint64_t timestamp_;
+
+        struct can_frame rx_frames_[SOCKETCAN_BATCH];
+        struct iovec rx_iov_[SOCKETCAN_BATCH];
+        struct mmsghdr rx_msgs_[SOCKETCAN_BATCH];
+        char rx_control_[SOCKETCAN_BATCH][CMSG_SPACE(sizeof(struct timeval))];
+
+        struct can_frame tx_frames_[SOCKETCAN_BATCH];
+        struct iovec tx_iov_[SOCKETCAN_BATCH];
+        struct mmsghdr tx_msgs_[SOCKETCAN_BATCH];
+        uint8_t tx_count_;
+
+        Frame frame_;
+
+        bool open();
+};
+
+#endif  // __linux__
+
+#endif  // __R51_SOCKETCAN__
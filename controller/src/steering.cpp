@@ -4,100 +4,317 @@
 #include "config.h"
 #include "debug.h"
 
+#define LOG_MODULE LOG_STEERING
+
 
-// This needs to be placed in memory.
 static constexpr const int kSteeringKeypadValues[] = STEERING_SWITCH_VALUES;
-static constexpr const uint32_t kSteeringKeypadHeartbeat = 500;
+static_assert(sizeof(kSteeringKeypadValues) / sizeof(kSteeringKeypadValues[0]) == STEERING_SWITCH_COUNT,
+        "STEERING_SWITCH_VALUES must contain STEERING_SWITCH_COUNT values");
+
+// Both ladders use the same resistor values and share a table.
+static constexpr LadderTable<STEERING_SWITCH_RESOLUTION> kSteeringKeypadTable =
+        makeLadderTable<STEERING_SWITCH_RESOLUTION>(kSteeringKeypadValues, STEERING_SWITCH_COUNT);
+
+// State frame bit for each button on the A and B ladders.
+static const uint8_t kSteeringKeypadBitsA[STEERING_SWITCH_COUNT] = {
+    0,  // power
+    5,  // seek down
+    3,  // volume down
+};
+static const uint8_t kSteeringKeypadBitsB[STEERING_SWITCH_COUNT] = {
+    1,  // mode
+    4,  // seek up
+    2,  // volume up
+};
+
+// Calibration is stored as a marker byte, the boundaries and debounce
+// duration of each ladder as little endian uint16 values, and a checksum byte.
+static const byte kSteeringCalibrationMarker = 0x53;
+static const size_t kSteeringCalibrationLadderSize = (STEERING_SWITCH_COUNT + 1) * 2;
+static const size_t kSteeringCalibrationSize = 2 + kSteeringCalibrationLadderSize * 2;
+
+static byte steeringCalibrationChecksum(const byte* record) {
+    byte sum = 0;
+    for (size_t i = 0; i < kSteeringCalibrationSize - 1; i++) {
+        sum += record[i];
+    }
+    return ~sum;
+}
+
+static void encodeLadder(byte* data, const uint16_t* boundaries, uint16_t debounce) {
+    for (uint8_t i = 0; i < STEERING_SWITCH_COUNT; i++) {
+        data[i * 2] = boundaries[i] & 0xFF;
+        data[i * 2 + 1] = boundaries[i] >> 8;
+    }
+    data[STEERING_SWITCH_COUNT * 2] = debounce & 0xFF;
+    data[STEERING_SWITCH_COUNT * 2 + 1] = debounce >> 8;
+}
 
-SteeringKeypad::SteeringKeypad(Clock* clock, GPIO* gpio) : last_change_(0), clock_(clock) {
+static bool decodeLadder(const byte* data, uint16_t* boundaries, uint16_t* debounce) {
+    for (uint8_t i = 0; i < STEERING_SWITCH_COUNT; i++) {
+        boundaries[i] = data[i * 2] | (data[i * 2 + 1] << 8);
+        if (boundaries[i] > STEERING_SWITCH_RESOLUTION ||
+                (i > 0 && boundaries[i] <= boundaries[i - 1])) {
+            return false;
+        }
+    }
+    *debounce = data[STEERING_SWITCH_COUNT * 2] | (data[STEERING_SWITCH_COUNT * 2 + 1] << 8);
+    return true;
+}
+
+// Convert a label in the state frame layout to a button mask for a ladder.
+static uint8_t labelMask(uint8_t label, const uint8_t* bits) {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < STEERING_SWITCH_COUNT; i++) {
+        if (getBit(&label, 0, bits[i])) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+SteeringKeypad::SteeringKeypad(TimerWheel* timers, AnalogSampler* sampler, Storage* storage) :
+        last_change_(0), timers_(timers), sampler_(sampler), storage_(storage),
+        sw_a_(&kSteeringKeypadTable), sw_b_(&kSteeringKeypadTable),
+        repeat_a_(0), repeat_b_(0), calibrating_(false), state_changed_(false),
+        cal_a_(STEERING_SWITCH_COUNT, STEERING_CALIBRATION_MIN_SAMPLES,
+                STEERING_CALIBRATION_MAX_GLITCH, STEERING_CALIBRATION_TOLERANCE,
+                STEERING_CALIBRATION_DEBOUNCE_MARGIN,
+                STEERING_CALIBRATION_DEBOUNCE_MIN),
+        cal_b_(STEERING_SWITCH_COUNT, STEERING_CALIBRATION_MIN_SAMPLES,
+                STEERING_CALIBRATION_MAX_GLITCH, STEERING_CALIBRATION_TOLERANCE,
+                STEERING_CALIBRATION_DEBOUNCE_MARGIN,
+                STEERING_CALIBRATION_DEBOUNCE_MIN) {
     initFrame(&frame_, STEERING_SWITCH_FRAME_ID, STEERING_SWITCH_FRAME_LEN);
-    sw_a_ = new AnalogMultiButton(
-            STEERING_SWITCH_A_PIN, STEERING_SWITCH_COUNT, kSteeringKeypadValues,
-            AnalogMultiButton::DEFAULT_DEBOUNCE_DURATION,
-            AnalogMultiButton::DEFAULT_ANALOG_RESOLUTION,
-            clock, gpio);
-    sw_b_ = new AnalogMultiButton(
-            STEERING_SWITCH_B_PIN, STEERING_SWITCH_COUNT, kSteeringKeypadValues,
-            AnalogMultiButton::DEFAULT_DEBOUNCE_DURATION,
-            AnalogMultiButton::DEFAULT_ANALOG_RESOLUTION,
-            clock, gpio);
+    memset(control_state_, 0, 2);
 }
 
-SteeringKeypad::~SteeringKeypad() {
-    delete sw_a_;
-    delete sw_b_;
+void SteeringKeypad::begin() {
+    if (loadCalibration()) {
+        INFO_MSG("steering: loaded calibration");
+        setCalibrationState(1, true);
+    }
+    uint32_t pins[] = {STEERING_SWITCH_A_PIN, STEERING_SWITCH_B_PIN};
+    sampler_->begin(pins, 2);
 }
 
 void SteeringKeypad::receive(const Broadcast& broadcast) {
-    sw_a_->update();
-    bool changed = false;
-    if (sw_a_->onPress(0))  {
-        // power pressed
-        setBit(frame_.data, 0, 0, 1);
-        changed = true;
-        INFO_MSG("steering: press power");
-    } else if (sw_a_->onPress(1)) {
-        // seek down pressed
-        setBit(frame_.data, 0, 5, 1);
-        changed = true;
-        INFO_MSG("steering: press seek down");
-    } else if (sw_a_->onPress(2)) {
-        // volume down pressed
-        setBit(frame_.data, 0, 3, 1);
-        changed = true;
-        INFO_MSG("steering: press volume down");
-    } else if (sw_a_->onRelease(0))  {
-        // power released
-        setBit(frame_.data, 0, 0, 0);
-        changed = true;
-        INFO_MSG("steering: release power");
-    } else if (sw_a_->onRelease(1)) {
-        // seek down released
-        setBit(frame_.data, 0, 5, 0);
-        changed = true;
-        INFO_MSG("steering: release seek down");
-    } else if (sw_a_->onRelease(2)) {
-        // volume down released
-        setBit(frame_.data, 0, 3, 0);
-        changed = true;
-        INFO_MSG("steering: release volume down");
-    }
-
-    sw_b_->update();
-    if (sw_b_->onPress(0))  {
-        // mode pressed
-        setBit(frame_.data, 0, 1, 1);
-        changed = true;
-        INFO_MSG("steering: press mode");
-    } else if (sw_b_->onPress(1)) {
-        // seek up pressed
-        setBit(frame_.data, 0, 4, 1);
-        changed = true;
-        INFO_MSG("steering: press seek up");
-    } else if (sw_b_->onPress(2)) {
-        // volume up pressed
-        setBit(frame_.data, 0, 2, 1);
-        changed = true;
-        INFO_MSG("steering: press volume up");
-    } else if (sw_b_->onRelease(0))  {
-        // mode released
-        setBit(frame_.data, 0, 1, 0);
-        changed = true;
-        INFO_MSG("steering: release mode");
-    } else if (sw_b_->onRelease(1)) {
-        // seek up released
-        setBit(frame_.data, 0, 4, 0);
-        changed = true;
-        INFO_MSG("steering: release seek up");
-    } else if (sw_b_->onRelease(2)) {
-        // volume up released
-        setBit(frame_.data, 0, 2, 0);
-        changed = true;
-        INFO_MSG("steering: release volume up");
-    }
-
-    if (changed || clock_->millis() - last_change_ >= STEERING_SWITCH_FRAME_HB) {
-        last_change_ = clock_->millis();
+    uint32_t now = timers_->now();
+    byte previous[4];
+    memcpy(previous, frame_.data, 4);
+
+    if (calibrating_) {
+        uint16_t value = sampler_->read(STEERING_SWITCH_A_PIN);
+        cal_a_.record(value, now);
+        value = sampler_->read(STEERING_SWITCH_B_PIN);
+        cal_b_.record(value, now);
+    } else {
+        updateLadder(&sw_a_, STEERING_SWITCH_A_PIN, kSteeringKeypadBitsA, &repeat_a_, now);
+        updateLadder(&sw_b_, STEERING_SWITCH_B_PIN, kSteeringKeypadBitsB, &repeat_b_, now);
+
+        uint32_t held = 0;
+        if (sw_a_.pressed() != 0 && now - sw_a_.pressTime() > held) {
+            held = now - sw_a_.pressTime();
+        }
+        if (sw_b_.pressed() != 0 && now - sw_b_.pressTime() > held) {
+            held = now - sw_b_.pressTime();
+        }
+        held /= 100;
+        frame_.data[3] = held > 0xFF ? 0xFF : held;
+    }
+
+    bool changed = memcmp(previous, frame_.data, 4) != 0 || state_changed_;
+    state_changed_ = false;
+    if (previous[0] != frame_.data[0]) {
+        INFO_MSG_VAL_FMT("steering: buttons ", frame_.data[0], HEX);
+    }
+    if (changed || now - last_change_ >= STEERING_SWITCH_FRAME_HB) {
+        last_change_ = now;
         broadcast(frame_);
     }
 }
+
+void SteeringKeypad::updateLadder(LadderInput* input, uint32_t pin, const uint8_t* bits,
+        uint32_t* next_repeat, uint32_t now) {
+    if (input->update(sampler_->read(pin), now)) {
+        setButtons(0, input->pressed(), bits);
+        setButtons(1, 0, bits);
+        if (input->onPress() != 0) {
+            ++frame_.data[2];
+            *next_repeat = now + STEERING_SWITCH_REPEAT_DELAY;
+        }
+    }
+    if (input->pressed() == 0) {
+        return;
+    }
+    if (now - input->pressTime() >= STEERING_SWITCH_LONG_PRESS) {
+        setButtons(1, input->pressed(), bits);
+    }
+    if ((int32_t)(now - *next_repeat) >= 0) {
+        ++frame_.data[2];
+        *next_repeat += STEERING_SWITCH_REPEAT;
+    }
+}
+
+void SteeringKeypad::setButtons(uint8_t offset, uint8_t mask, const uint8_t* bits) {
+    for (uint8_t i = 0; i < STEERING_SWITCH_COUNT; i++) {
+        setBit(frame_.data, offset, bits[i], (mask >> i) & 0x01);
+    }
+}
+
+void SteeringKeypad::send(const Frame& frame) {
+    if (frame.id != STEERING_CALIBRATION_FRAME_ID || frame.len < 2) {
+        return;
+    }
+
+    // check if any bits have flipped
+    if (xorBits(control_state_, frame.data, 0, 0)) {
+        startCalibration();
+    }
+    if (xorBits(control_state_, frame.data, 0, 1)) {
+        saveCalibration();
+    }
+    if (xorBits(control_state_, frame.data, 0, 2)) {
+        stopCalibration();
+    }
+    if (xorBits(control_state_, frame.data, 0, 3)) {
+        clearCalibration();
+    }
+    memcpy(control_state_, frame.data, 2);
+    setLabel(control_state_[1]);
+}
+
+bool SteeringKeypad::filter(uint32_t id) const {
+    return id == STEERING_CALIBRATION_FRAME_ID;
+}
+
+void SteeringKeypad::startCalibration() {
+    INFO_MSG("steering: start calibration");
+    cal_a_.reset();
+    cal_b_.reset();
+    sw_a_.reset();
+    sw_b_.reset();
+    frame_.data[0] = 0;
+    frame_.data[1] = 0;
+    frame_.data[3] = 0;
+    state_changed_ = true;
+    calibrating_ = true;
+    setCalibrationState(0, true);
+    setCalibrationState(2, false);
+}
+
+void SteeringKeypad::saveCalibration() {
+    if (!calibrating_) {
+        return;
+    }
+    uint16_t boundaries_a[STEERING_SWITCH_COUNT];
+    uint16_t boundaries_b[STEERING_SWITCH_COUNT];
+    uint16_t debounce_a;
+    uint16_t debounce_b;
+    if (cal_a_.compute(boundaries_a, &debounce_a) &&
+            cal_b_.compute(boundaries_b, &debounce_b)) {
+        INFO_MSG("steering: save calibration");
+        applyCalibration(boundaries_a, debounce_a, boundaries_b, debounce_b);
+        storeCalibration(boundaries_a, debounce_a, boundaries_b, debounce_b);
+        setCalibrationState(1, true);
+        setCalibrationState(2, false);
+    } else {
+        ERROR_MSG("steering: calibration failed");
+        setCalibrationState(2, true);
+    }
+    stopCalibration();
+}
+
+void SteeringKeypad::stopCalibration() {
+    if (!calibrating_) {
+        return;
+    }
+    INFO_MSG("steering: stop calibration");
+    calibrating_ = false;
+    setCalibrationState(0, false);
+}
+
+void SteeringKeypad::clearCalibration() {
+    INFO_MSG("steering: clear calibration");
+    size_t address = STEERING_CALIBRATION_STORAGE_OFFSET;
+    if (storage_->size() >= address + kSteeringCalibrationSize &&
+            storage_->read(address) == kSteeringCalibrationMarker) {
+        storage_->write(address, 0xFF);
+    }
+    sw_a_.setTable(kSteeringKeypadTable.masks, STEERING_SWITCH_RESOLUTION,
+            LadderInput::kDefaultDebounce);
+    sw_b_.setTable(kSteeringKeypadTable.masks, STEERING_SWITCH_RESOLUTION,
+            LadderInput::kDefaultDebounce);
+    setCalibrationState(1, false);
+}
+
+void SteeringKeypad::setLabel(uint8_t label) {
+    cal_a_.setLabel(labelMask(label, kSteeringKeypadBitsA));
+    cal_b_.setLabel(labelMask(label, kSteeringKeypadBitsB));
+}
+
+void SteeringKeypad::setCalibrationState(uint8_t bit, bool value) {
+    if (setBit(frame_.data, 4, bit, value)) {
+        state_changed_ = true;
+    }
+}
+
+bool SteeringKeypad::loadCalibration() {
+    size_t address = STEERING_CALIBRATION_STORAGE_OFFSET;
+    if (storage_->size() < address + kSteeringCalibrationSize) {
+        ERROR_MSG("steering: storage not available");
+        return false;
+    }
+    byte record[kSteeringCalibrationSize];
+    for (size_t i = 0; i < kSteeringCalibrationSize; i++) {
+        record[i] = storage_->read(address + i);
+    }
+    if (record[0] != kSteeringCalibrationMarker) {
+        return false;
+    }
+    if (record[kSteeringCalibrationSize - 1] != steeringCalibrationChecksum(record)) {
+        ERROR_MSG("steering: calibration checksum error");
+        return false;
+    }
+
+    uint16_t boundaries_a[STEERING_SWITCH_COUNT];
+    uint16_t boundaries_b[STEERING_SWITCH_COUNT];
+    uint16_t debounce_a;
+    uint16_t debounce_b;
+    if (!decodeLadder(record + 1, boundaries_a, &debounce_a) ||
+            !decodeLadder(record + 1 + kSteeringCalibrationLadderSize, boundaries_b, &debounce_b)) {
+        ERROR_MSG("steering: invalid calibration");
+        return false;
+    }
+    applyCalibration(boundaries_a, debounce_a, boundaries_b, debounce_b);
+    return true;
+}
+
+void SteeringKeypad::storeCalibration(const uint16_t* boundaries_a, uint16_t debounce_a,
+        const uint16_t* boundaries_b, uint16_t debounce_b) {
+    size_t address = STEERING_CALIBRATION_STORAGE_OFFSET;
+    if (storage_->size() < address + kSteeringCalibrationSize) {
+        ERROR_MSG("steering: storage not available");
+        return;
+    }
+    byte record[kSteeringCalibrationSize];
+    record[0] = kSteeringCalibrationMarker;
+    encodeLadder(record + 1, boundaries_a, debounce_a);
+    encodeLadder(record + 1 + kSteeringCalibrationLadderSize, boundaries_b, debounce_b);
+    record[kSteeringCalibrationSize - 1] = steeringCalibrationChecksum(record);
+
+    // Only write bytes which have changed to reduce wear.
+    for (size_t i = 0; i < kSteeringCalibrationSize; i++) {
+        if (storage_->read(address + i) != record[i]) {
+            storage_->write(address + i, record[i]);
+        }
+    }
+}
+
+void SteeringKeypad::applyCalibration(const uint16_t* boundaries_a, uint16_t debounce_a,
+        const uint16_t* boundaries_b, uint16_t debounce_b) {
+    memcpy(boundaries_a_, boundaries_a, sizeof(boundaries_a_));
+    memcpy(boundaries_b_, boundaries_b, sizeof(boundaries_b_));
+    sw_a_.setBoundaries(boundaries_a_, STEERING_SWITCH_COUNT, debounce_a);
+    sw_b_.setBoundaries(boundaries_b_, STEERING_SWITCH_COUNT, debounce_b);
+}
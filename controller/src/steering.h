@@ -1,13 +1,17 @@
 #ifndef __R51_STEERING__
 #define __R51_STEERING__
 
-#include "AnalogMultiButton.h"
+#include "analog.h"
 #include "bus.h"
-#include "clock.h"
-#include "gpio.h"
+#include "calibration.h"
+#include "config.h"
+#include "ladder.h"
+#include "storage.h"
+#include "timer.h"
 
 
-// Steering wheel keypad. Sends 0x5800 CAN frames on button press and release.
+// Steering wheel keypad. Sends 0x5800 CAN frames on button press, release,
+// long press, repeat, and as the hold duration increases.
 //
 // Frame 0x5800: Steering Keypad State Frame
 //   Byte 0: Button State
@@ -18,34 +22,94 @@
 //     Bit 4: Seek Up
 //     Bit 5: Seek Down
 //     Bit 6-7: unused
-//   Byte 1-7: unused
+//   Byte 1: Long Press State; same layout as byte 0
+//   Byte 2: Repeat Tick; incremented on press and then every
+//           STEERING_SWITCH_REPEAT ms once a button is held for
+//           STEERING_SWITCH_REPEAT_DELAY ms; wraps at 255
+//   Byte 3: Hold Duration; time the longest held button has been held in
+//           100ms units; saturates at 255; 0 when released
+//   Byte 4: Calibration State
+//     Bit 0: Calibrating
+//     Bit 1: Calibrated; thresholds were loaded from storage
+//     Bit 2: Calibration Failed; the last calibration could not be saved
+//     Bit 3-7: unused
+//   Byte 5-7: unused
 //
-// Bits are set to 1 when a button on the keypad is held down and 0 when
-// released.
+// Bits in byte 0 are set to 1 when a button on the keypad is held down and 0
+// when released. Buttons on different ladders may be held together. Bits in
+// byte 1 are set once a button has been held for STEERING_SWITCH_LONG_PRESS ms
+// and cleared on release. A change in the repeat tick indicates a press or
+// repeat of the held buttons.
+//
+// Frame 0x5801: Steering Keypad Calibration Frame
+//   Byte 0: Calibration Control; flip a bit to trigger the action
+//     Bit 0: Start calibration; clears recorded readings
+//     Bit 1: Save calibration; computes and stores thresholds
+//     Bit 2: Cancel calibration
+//     Bit 3: Clear stored calibration and restore default thresholds
+//     Bit 4-7: unused
+//   Byte 1: Held Buttons; the button being held during calibration in the
+//           same layout as byte 0 of the state frame; 0 when idle
+//   Byte 2-7: unused
+//
+// Calibration records the readings of each ladder while the user holds each
+// button in turn and while the keypad is idle. Button state is not reported
+// while calibrating. On save the thresholds are set midway between the
+// recorded levels and the debounce duration is set just above the longest
+// noise seen while a button was held. See LadderCalibration.
 class SteeringKeypad : public Node {
     public:
         // Construct a new steering switch keypad object.
         // analog pins to communicate. See config.h for configuration.
-        SteeringKeypad(Clock* clock = Clock::real(), GPIO* gpio = GPIO::real());
+        SteeringKeypad(TimerWheel* timers = TimerWheel::real(),
+                AnalogSampler* sampler = AnalogSampler::real(),
+                Storage* storage = Storage::real());
 
-        // Free resources associated with the keypad.
-        ~SteeringKeypad() override;
+        // Load stored calibration and start sampling the keypad pins in the
+        // background. Should be called once in setup.
+        void begin();
 
         // Broadcast a frame on keypad state change.
         void receive(const Broadcast& broadcast) override;
 
-        // Noop. This node does not process frames.
-        void send(const Frame&) override {}
+        // Handle calibration control frames.
+        void send(const Frame& frame) override;
 
-        // Always returns false. This node does not process frames.
-        bool filter(uint32_t) const override { return false; }
+        // Matches the calibration control frame.
+        bool filter(uint32_t id) const override;
 
     private:
         uint32_t last_change_;
-        Clock* clock_;
+        TimerWheel* timers_;
+        AnalogSampler* sampler_;
+        Storage* storage_;
         Frame frame_;
-        AnalogMultiButton* sw_a_;
-        AnalogMultiButton* sw_b_;
+        LadderInput sw_a_;
+        LadderInput sw_b_;
+        uint32_t repeat_a_;
+        uint32_t repeat_b_;
+        byte control_state_[2];
+        bool calibrating_;
+        bool state_changed_;
+        LadderCalibration cal_a_;
+        LadderCalibration cal_b_;
+        uint16_t boundaries_a_[STEERING_SWITCH_COUNT];
+        uint16_t boundaries_b_[STEERING_SWITCH_COUNT];
+
+        void startCalibration();
+        void saveCalibration();
+        void stopCalibration();
+        void clearCalibration();
+        void setLabel(uint8_t label);
+        void setCalibrationState(uint8_t bit, bool value);
+        bool loadCalibration();
+        void storeCalibration(const uint16_t* boundaries_a, uint16_t debounce_a,
+                const uint16_t* boundaries_b, uint16_t debounce_b);
+        void applyCalibration(const uint16_t* boundaries_a, uint16_t debounce_a,
+                const uint16_t* boundaries_b, uint16_t debounce_b);
+        void updateLadder(LadderInput* input, uint32_t pin, const uint8_t* bits,
+                uint32_t* next_repeat, uint32_t now);
+        void setButtons(uint8_t offset, uint8_t mask, const uint8_t* bits);
 };
 
 #endif  // __R51_STEERING__
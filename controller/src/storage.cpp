@@ -0,0 +1,57 @@
+#include "storage.h"
+
+
+#if defined(__SAMD51__)
+
+// SmartEEPROM backed storage. The SmartEEPROM is configured by the SBLK and
+// PSZ fuses in the NVM user page. Storage is unavailable if SBLK is zero.
+class SmartEepromStorage : public Storage {
+    public:
+        size_t size() override {
+            if (NVMCTRL->SEESTAT.bit.SBLK == 0) {
+                return 0;
+            }
+            return 512 << NVMCTRL->SEESTAT.bit.PSZ;
+        }
+
+        byte read(size_t address) override {
+            if (address >= size()) {
+                return 0xFF;
+            }
+            wait();
+            return ((volatile byte*)SEEPROM_ADDR)[address];
+        }
+
+        void write(size_t address, byte value) override {
+            if (address >= size() || NVMCTRL->SEESTAT.bit.LOCK) {
+                return;
+            }
+            wait();
+            ((volatile byte*)SEEPROM_ADDR)[address] = value;
+        }
+
+    private:
+        void wait() {
+            while (NVMCTRL->SEESTAT.bit.BUSY);
+        }
+};
+
+SmartEepromStorage real_storage;
+
+#else
+
+// Fallback for boards without SmartEEPROM. Nothing is persisted.
+class NullStorage : public Storage {
+    public:
+        size_t size() override { return 0; }
+        byte read(size_t) override { return 0xFF; }
+        void write(size_t, byte) override {}
+};
+
+NullStorage real_storage;
+
+#endif  // __SAMD51__
+
+Storage* Storage::real() {
+    return &real_storage;
+}
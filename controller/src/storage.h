@@ -0,0 +1,29 @@
+#ifndef __R51_STORAGE__
+#define __R51_STORAGE__
+
+#include <Arduino.h>
+
+
+// Base non-volatile storage interface. Allows persistent storage to be mocked.
+// The real implementation uses the SAME51 SmartEEPROM which handles wear
+// leveling in hardware. Callers should still avoid writing unchanged bytes.
+class Storage {
+    public:
+        // Return the real storage interface.
+        static Storage* real();
+
+        Storage() = default;
+        virtual ~Storage() = default;
+
+        // Return the number of bytes available. Returns 0 if the storage is
+        // not available. SmartEEPROM must be enabled in the user page fuses.
+        virtual size_t size() = 0;
+
+        // Read a byte from the given address.
+        virtual byte read(size_t address) = 0;
+
+        // Write a byte to the given address.
+        virtual void write(size_t address, byte value) = 0;
+};
+
+#endif  // __R51_STORAGE__
@@ -0,0 +1,113 @@
+#include "timer.h"
+
+
+TimerWheel* TimerWheel::real() {
+    // Constructed on first use so nodes may register timers from their
+    // constructors regardless of static initialization order.
+    static TimerWheel real_timers;
+    return &real_timers;
+}
+
+TimerWheel::TimerWheel(Clock* clock) : clock_(clock), tick_{0, 0}, next_(0), count_(0) {
+    for (uint8_t i = 0; i < kSlots; i++) {
+        slots_[i] = nullptr;
+    }
+}
+
+void TimerWheel::start(Timer* timer, uint32_t delay) {
+    if (timer->active_) {
+        remove(timer);
+    }
+    timer->deadline_ = tick_.millis + delay;
+    timer->period_ = 0;
+    timer->expired_ = false;
+    insert(timer);
+}
+
+void TimerWheel::startPeriodic(Timer* timer, uint32_t period) {
+    start(timer, period);
+    timer->period_ = period;
+}
+
+void TimerWheel::stop(Timer* timer) {
+    if (timer->active_) {
+        remove(timer);
+    }
+    timer->expired_ = false;
+}
+
+uint8_t TimerWheel::update() {
+    uint32_t last = tick_.millis;
+    tick_ = clock_->tick();
+    uint32_t now = tick_.millis;
+    if (count_ == 0 || (int32_t)(now - next_) < 0) {
+        return 0;
+    }
+
+    uint32_t elapsed = now - last;
+    uint8_t steps = elapsed >= kSlots ? kSlots : elapsed + 1;
+    uint8_t fired = 0;
+    for (uint8_t i = 0; i < steps; i++) {
+        Timer** link = &slots_[(last + i) & (kSlots - 1)];
+        while (*link != nullptr) {
+            Timer* timer = *link;
+            if ((int32_t)(now - timer->deadline_) < 0) {
+                link = &timer->next_;
+                continue;
+            }
+            *link = timer->next_;
+            timer->next_ = nullptr;
+            timer->active_ = false;
+            timer->expired_ = true;
+            --count_;
+            ++fired;
+            if (timer->period_ != 0) {
+                // skip missed periods instead of expiring in a burst
+                timer->deadline_ += timer->period_;
+                if ((int32_t)(now - timer->deadline_) >= 0) {
+                    timer->deadline_ = now + timer->period_;
+                }
+                insert(timer);
+            }
+        }
+    }
+    findNext();
+    return fired;
+}
+
+void TimerWheel::insert(Timer* timer) {
+    Timer** slot = &slots_[timer->deadline_ & (kSlots - 1)];
+    timer->next_ = *slot;
+    *slot = timer;
+    timer->active_ = true;
+    if (count_ == 0 || (int32_t)(timer->deadline_ - next_) < 0) {
+        next_ = timer->deadline_;
+    }
+    ++count_;
+}
+
+void TimerWheel::remove(Timer* timer) {
+    Timer** link = &slots_[timer->deadline_ & (kSlots - 1)];
+    while (*link != nullptr) {
+        if (*link == timer) {
+            *link = timer->next_;
+            timer->next_ = nullptr;
+            timer->active_ = false;
+            --count_;
+            return;
+        }
+        link = &(*link)->next_;
+    }
+}
+
+void TimerWheel::findNext() {
+    bool found = false;
+    for (uint8_t i = 0; i < kSlots; i++) {
+        for (Timer* timer = slots_[i]; timer != nullptr; timer = timer->next_) {
+            if (!found || (int32_t)(timer->deadline_ - next_) < 0) {
+                next_ = timer->deadline_;
+                found = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef __R51_TIMER__
+#define __R51_TIMER__
+
+#include <Arduino.h>
+
+#include "clock.h"
+
+
+// A deadline scheduled on a TimerWheel. Timers are owned by the caller and
+// must outlive their registration with the wheel.
+class Timer {
+    public:
+        Timer() : next_(nullptr), deadline_(0), period_(0), active_(false), expired_(false) {}
+
+        // Return true if the timer expired since the last call.
+        bool expired() {
+            bool expired = expired_;
+            expired_ = false;
+            return expired;
+        }
+
+        // Return true if the timer is waiting for its deadline. One-shot
+        // timers are inactive once they expire.
+        bool active() const { return active_; }
+
+    private:
+        friend class TimerWheel;
+
+        Timer* next_;
+        uint32_t deadline_;
+        uint32_t period_;
+        bool active_;
+        bool expired_;
+};
+
+// Shared timer service and loop context. Nodes register one-shot and periodic
+// deadlines instead of polling the clock. The wheel samples the clock once per
+// update and nodes read the sampled tick so all nodes see the same time within
+// an iteration. The wheel only walks its slots when the earliest deadline has
+// passed.
+//
+// Timers are hashed into slots by deadline in milliseconds. An update visits
+// the slots between the previous update and now, or every slot once if more
+// than a full rotation has passed, and expires the timers whose deadline has
+// been reached. Deadlines further away than a rotation stay in their slot
+// until a later pass.
+class TimerWheel {
+    public:
+        // The number of slots in the wheel. Must be a power of 2.
+        static const uint8_t kSlots = 32;
+
+        // Return the wheel used by the main loop.
+        static TimerWheel* real();
+
+        TimerWheel(Clock* clock = Clock::real());
+
+        // Schedule a one-shot timer to expire delay ms after the last update.
+        // Restarting an active timer replaces its deadline.
+        void start(Timer* timer, uint32_t delay);
+
+        // Schedule a timer to expire every period ms after the last update.
+        void startPeriodic(Timer* timer, uint32_t period);
+
+        // Cancel a timer.
+        void stop(Timer* timer);
+
+        // Sample the clock and expire timers whose deadline has passed.
+        // Should be called once per main loop iteration. Return the number of
+        // timers which expired.
+        uint8_t update();
+
+        // The time of the last update in milliseconds.
+        uint32_t now() const { return tick_.millis; }
+
+        // The time of the last update in microseconds.
+        uint32_t micros() const { return tick_.micros; }
+
+        // The clock sample taken by the last update.
+        const Tick& tick() const { return tick_; }
+
+    private:
+        Clock* clock_;
+        Timer* slots_[kSlots];
+        Tick tick_;
+        uint32_t next_;
+        uint8_t count_;
+
+        void insert(Timer* timer);
+        void remove(Timer* timer);
+        void findNext();
+};
+
+#endif  // __R51_TIMER__
@@ -0,0 +1,46 @@
+#include "trace.h"
+
+#include "binary.h"
+
+
+// Length of a record following the length byte without arguments.
+static const uint8_t kTraceHeaderLen = 9;
+
+Trace::Trace(LogRing* ring, Clock* clock) : ring_(ring), clock_(clock) {}
+
+void Trace::header(uint8_t len, LogModule module, LogLevel level, uint32_t id) {
+    uint8_t data[11];
+    data[0] = kSync;
+    data[1] = kTraceHeaderLen + len;
+    setLE32(data + 2, id);
+    setLE32(data + 6, clock_->micros());
+    data[10] = (level & 0x0F) | (module << 4);
+    ring_->write(data, sizeof(data));
+}
+
+bool Trace::message(LogModule module, LogLevel level, uint32_t id) {
+    header(0, module, level, id);
+    return ring_->commit();
+}
+
+bool Trace::value(LogModule module, LogLevel level, uint32_t id, uint32_t value,
+        uint8_t base) {
+    uint8_t data[5];
+    data[0] = base;
+    setLE32(data + 1, value);
+    header(sizeof(data), module, level, id);
+    ring_->write(data, sizeof(data));
+    return ring_->commit();
+}
+
+bool Trace::frame(LogModule module, LogLevel level, uint32_t id, const Frame& frame) {
+    uint8_t data[6];
+    uint8_t len = frame.len > 64 ? 64 : frame.len;
+    data[0] = kArgFrame;
+    setLE32(data + 1, frame.id);
+    data[5] = len;
+    header(sizeof(data) + len, module, level, id);
+    ring_->write(data, sizeof(data));
+    ring_->write(frame.data, len);
+    return ring_->commit();
+}
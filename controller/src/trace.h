@@ -0,0 +1,61 @@
+#ifndef __R51_TRACE__
+#define __R51_TRACE__
+
+#include <Arduino.h>
+
+#include "bus.h"
+#include "clock.h"
+#include "log.h"
+
+
+// Hash a message string into its trace ID at compile time. Uses 32-bit FNV-1a
+// so the host decoder can rebuild the string table by hashing the messages
+// found in the source. Returns 0 for a null message.
+constexpr uint32_t traceId(const char* msg, uint32_t hash = 0x811C9DC5) {
+    return msg == nullptr ? 0 :
+        *msg == 0 ? hash : traceId(msg + 1, (hash ^ (uint8_t)*msg) * 0x01000193);
+}
+
+// Writes tokenized binary trace records to a log ring. Messages are referenced
+// by their trace ID so the message strings are not stored in flash and only a
+// few bytes are sent per message. Records are decoded on the host by
+// tools/decode_trace.py.
+//
+// Record format:
+//   Byte 0: sync byte 0xA5
+//   Byte 1: length of the remainder of the record
+//   Bytes 2-5: message ID, little endian
+//   Bytes 6-9: timestamp in microseconds, little endian
+//   Byte 10: log level in bits 0-3 and log module in bits 4-7
+//   Bytes 11+: optional argument
+//     Byte 0: argument type
+//       2, 8, 10, 16: integer value printed in that base
+//       0xF0: frame
+//     Integer: 4 bytes, little endian
+//     Frame: 4 byte little endian ID, 1 byte length, then the frame data
+class Trace {
+    public:
+        static const uint8_t kSync = 0xA5;
+        static const uint8_t kArgFrame = 0xF0;
+
+        Trace(LogRing* ring, Clock* clock = Clock::real());
+
+        // Trace a message without arguments. Return false if the record was
+        // dropped.
+        bool message(LogModule module, LogLevel level, uint32_t id);
+
+        // Trace a message with an integer value printed in the given base.
+        bool value(LogModule module, LogLevel level, uint32_t id, uint32_t value,
+                uint8_t base = DEC);
+
+        // Trace a message with a frame.
+        bool frame(LogModule module, LogLevel level, uint32_t id, const Frame& frame);
+
+    private:
+        LogRing* ring_;
+        Clock* clock_;
+
+        void header(uint8_t len, LogModule module, LogLevel level, uint32_t id);
+};
+
+#endif  // __R51_TRACE__
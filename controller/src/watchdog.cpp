@@ -0,0 +1,73 @@
+#include "watchdog.h"
+
+
+#if defined(__SAMD51__)
+
+// The WDT counts the 1.024kHz ultra low power oscillator. Periods range from 8
+// to 16384 cycles in powers of 2.
+static const uint8_t kWatchdogMaxPeriod = 0x0B;
+
+class Same51Watchdog : public Watchdog {
+    public:
+        bool begin(uint32_t timeout_ms) override {
+            uint8_t period = 0;
+            while (period < kWatchdogMaxPeriod && (8u << period) < timeout_ms) {
+                ++period;
+            }
+            WDT->CTRLA.reg = 0;
+            while (WDT->SYNCBUSY.reg);
+            WDT->INTENCLR.reg = WDT_INTENCLR_EW;
+            WDT->CONFIG.reg = WDT_CONFIG_PER(period);
+            WDT->CTRLA.reg = WDT_CTRLA_ENABLE;
+            while (WDT->SYNCBUSY.reg);
+            return true;
+        }
+
+        void feed() override {
+            // A clear which is still synchronizing already restarted the
+            // timeout so skip it rather than wait on the slow clock.
+            if (!WDT->SYNCBUSY.bit.CLEAR) {
+                WDT->CLEAR.reg = WDT_CLEAR_CLEAR_KEY;
+            }
+        }
+
+        ResetCause resetCause() override {
+            uint8_t cause = RSTC->RCAUSE.reg;
+            if (cause & RSTC_RCAUSE_WDT) {
+                return RESET_CAUSE_WATCHDOG;
+            }
+            if (cause & RSTC_RCAUSE_SYST) {
+                return RESET_CAUSE_SOFTWARE;
+            }
+            if (cause & RSTC_RCAUSE_EXT) {
+                return RESET_CAUSE_EXTERNAL;
+            }
+            if (cause & (RSTC_RCAUSE_BODCORE | RSTC_RCAUSE_BODVDD)) {
+                return RESET_CAUSE_BROWN_OUT;
+            }
+            if (cause & RSTC_RCAUSE_POR) {
+                return RESET_CAUSE_POWER_ON;
+            }
+            return cause == 0 ? RESET_CAUSE_UNKNOWN : RESET_CAUSE_OTHER;
+        }
+};
+
+Same51Watchdog real_watchdog;
+
+#else
+
+// Fallback for other boards. A watchdog is not supported.
+class UnsupportedWatchdog : public Watchdog {
+    public:
+        bool begin(uint32_t) override { return false; }
+        void feed() override {}
+        ResetCause resetCause() override { return RESET_CAUSE_UNKNOWN; }
+};
+
+UnsupportedWatchdog real_watchdog;
+
+#endif  // __SAMD51__
+
+Watchdog* Watchdog::real() {
+    return &real_watchdog;
+}
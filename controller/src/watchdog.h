@@ -0,0 +1,40 @@
+#ifndef __R51_WATCHDOG__
+#define __R51_WATCHDOG__
+
+#include <Arduino.h>
+
+
+// The cause of the last reset.
+enum ResetCause : uint8_t {
+    RESET_CAUSE_UNKNOWN = 0,
+    RESET_CAUSE_POWER_ON = 1,
+    RESET_CAUSE_BROWN_OUT = 2,
+    RESET_CAUSE_EXTERNAL = 3,
+    RESET_CAUSE_WATCHDOG = 4,
+    RESET_CAUSE_SOFTWARE = 5,
+    RESET_CAUSE_OTHER = 6,
+};
+
+// Base hardware watchdog interface. Allows the watchdog to be mocked. The real
+// implementation on the SAME51 uses the WDT peripheral which resets the MCU if
+// it is not fed within the timeout. Other boards do not support a watchdog.
+class Watchdog {
+    public:
+        // Return the real watchdog.
+        static Watchdog* real();
+
+        Watchdog() = default;
+        virtual ~Watchdog() = default;
+
+        // Start the watchdog. The timeout is rounded up to the nearest
+        // supported period. Return false if a watchdog is not supported.
+        virtual bool begin(uint32_t timeout_ms) = 0;
+
+        // Restart the timeout. Does not block.
+        virtual void feed() = 0;
+
+        // Return the cause of the last reset.
+        virtual ResetCause resetCause() = 0;
+};
+
+#endif  // __R51_WATCHDOG__
@@ -0,0 +1,58 @@
+#ifndef __R51_TESTS_MOCK_ANALOG__
+#define __R51_TESTS_MOCK_ANALOG__
+
+#include "src/analog.h"
+
+
+class MockAnalogSampler : public AnalogSampler {
+    public:
+        MockAnalogSampler(uint32_t pin_count = 64) : pin_count_(pin_count), reads_(0) {
+            values_ = new uint16_t[pin_count];
+            started_ = new bool[pin_count]();
+            for (uint32_t i = 0; i < pin_count; i++) {
+                values_[i] = kFullScale;
+            }
+        }
+
+        ~MockAnalogSampler() {
+            delete[] values_;
+            delete[] started_;
+        }
+
+        // Mark pins as sampled.
+        bool begin(const uint32_t* pins, uint8_t count) override {
+            for (uint8_t i = 0; i < count; i++) {
+                started_[pins[i]] = true;
+            }
+            return true;
+        }
+
+        // Return the mocked value for a pin. Counts the number of reads.
+        uint16_t read(uint32_t pin) override {
+            ++reads_;
+            return values_[pin];
+        }
+
+        // Set the value returned for a pin.
+        void write(uint32_t pin, uint16_t value) {
+            values_[pin] = value;
+        }
+
+        // Return true if sampling was started for a pin.
+        bool started(uint32_t pin) const {
+            return started_[pin];
+        }
+
+        // Return the number of reads since creation.
+        uint32_t reads() const {
+            return reads_;
+        }
+
+    private:
+        uint32_t pin_count_;
+        uint32_t reads_;
+        uint16_t* values_;
+        bool* started_;
+};
+
+#endif  // __R51_TESTS_MOCK_ANALOG__
@@ -2,29 +2,77 @@
 #define __R51_TESTS_MOCK_CLOCK__
 
 #include "src/clock.h"
+#include "src/timer.h"
 
 
 class MockClock : public Clock {
     public:
-        MockClock() : millis_(0) {}
+        MockClock() : millis_(0), micros_(0), reads_(0), timers_(nullptr) {}
 
         // Return the current mocked time.
         uint32_t millis() override {
+            ++reads_;
             return millis_;
         }
 
+        // Return the current mocked time in microseconds.
+        uint32_t micros() override {
+            ++reads_;
+            return micros_;
+        }
+
+        // Return the current mocked time. Counts as a single read.
+        Tick tick() override {
+            ++reads_;
+            return {millis_, micros_};
+        }
+
         // Mock a delay. Advances time by ms and returns immediately.
         void delay(uint32_t ms) override {
             millis_ += ms;
+            micros_ += ms * 1000;
+            notify();
+        }
+
+        // Advance time by us. Milliseconds advance once a whole millisecond
+        // has passed.
+        void delayMicros(uint32_t us) {
+            uint32_t fraction = micros_ % 1000 + us;
+            micros_ += us;
+            millis_ += fraction / 1000;
+            notify();
         }
 
         // Set the clock to a specific time.
         void set(uint32_t millis) {
             millis_ = millis;
-        } 
+            micros_ = millis * 1000;
+            notify();
+        }
+
+        // Update a timer wheel whenever the time changes. Stands in for the
+        // bus loop in node tests.
+        void attach(TimerWheel* timers) {
+            timers_ = timers;
+            notify();
+        }
+
+        // The number of times the time was read.
+        uint32_t reads() const {
+            return reads_;
+        }
 
     private:
         uint32_t millis_;
+        uint32_t micros_;
+        uint32_t reads_;
+        TimerWheel* timers_;
+
+        void notify() {
+            if (timers_ != nullptr) {
+                timers_->update();
+            }
+        }
 };
 
 #endif  // __R51_TESTS_MOCK_CLOCK__
@@ -0,0 +1,32 @@
+#ifndef __R51_TESTS_MOCK_CYCLES__
+#define __R51_TESTS_MOCK_CYCLES__
+
+#include "src/cycles.h"
+
+
+class MockCycleCounter : public CycleCounter {
+    public:
+        MockCycleCounter(uint32_t read_cost = 0) : cycles_(0), read_cost_(read_cost) {}
+
+        // Return the current count. Advances the count by the read cost.
+        uint32_t read() override {
+            uint32_t cycles = cycles_;
+            cycles_ += read_cost_;
+            return cycles;
+        }
+
+        uint32_t frequency() override {
+            return 1000000;
+        }
+
+        // Advance the count.
+        void advance(uint32_t cycles) {
+            cycles_ += cycles;
+        }
+
+    private:
+        uint32_t cycles_;
+        uint32_t read_cost_;
+};
+
+#endif  // __R51_TESTS_MOCK_CYCLES__
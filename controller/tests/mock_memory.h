@@ -0,0 +1,36 @@
+#ifndef __R51_TESTS_MOCK_MEMORY__
+#define __R51_TESTS_MOCK_MEMORY__
+
+#include "src/memory.h"
+
+
+// Fake RAM layout backed by a buffer. The heap ends heap bytes into the buffer
+// and the stack pointer is sp bytes from its end.
+class FakeMemoryLayout : public MemoryLayout {
+    public:
+        static const uint32_t kSize = 4096;
+
+        FakeMemoryLayout(uint32_t heap, uint32_t sp) :
+            heap_(heap), sp_(sp), heap_used_(0), static_size_(0) {
+            memset(ram_, 0, sizeof(ram_));
+        }
+
+        uint8_t* heapEnd() override { return (uint8_t*)ram_ + heap_; }
+        uint8_t* stackTop() override { return (uint8_t*)ram_ + kSize; }
+        uint8_t* stackPointer() override { return (uint8_t*)ram_ + kSize - sp_; }
+        uint32_t heapUsed() override { return heap_used_; }
+        uint32_t staticSize() override { return static_size_; }
+
+        // Write a word at offset bytes from the top of the stack.
+        void touch(uint32_t offset) {
+            ram_[(kSize - offset) / 4] = 0;
+        }
+
+        uint32_t ram_[kSize / 4];
+        uint32_t heap_;
+        uint32_t sp_;
+        uint32_t heap_used_;
+        uint32_t static_size_;
+};
+
+#endif  // __R51_TESTS_MOCK_MEMORY__
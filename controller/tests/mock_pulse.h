@@ -0,0 +1,60 @@
+#ifndef __R51_TESTS_MOCK_PULSE__
+#define __R51_TESTS_MOCK_PULSE__
+
+#include "src/pulse.h"
+
+
+// Mock pulse timer which supports a single pin.
+class MockPulse : public Pulse {
+    public:
+        MockPulse(uint32_t pin) : pin_(pin), attached_(false), high_(false),
+            active_(false), width_(0), count_(0) {}
+
+        // Attach the supported pin.
+        bool begin(uint32_t pin, bool high) override {
+            if (pin != pin_) {
+                return false;
+            }
+            attached_ = true;
+            high_ = high;
+            return true;
+        }
+
+        // Record the pulse width.
+        bool trigger(uint32_t pin, uint32_t us) override {
+            if (!attached_ || pin != pin_ || active_) {
+                return false;
+            }
+            active_ = true;
+            width_ = us;
+            ++count_;
+            return true;
+        }
+
+        // Return true until the pulse is ended with finish().
+        bool active(uint32_t pin) override {
+            return pin == pin_ && active_;
+        }
+
+        // End the current pulse.
+        void finish() { active_ = false; }
+
+        // Return true if the pin was attached with an active high level.
+        bool high() const { return high_; }
+
+        // The width of the last pulse.
+        uint32_t width() const { return width_; }
+
+        // The number of pulses triggered.
+        uint32_t count() const { return count_; }
+
+    private:
+        uint32_t pin_;
+        bool attached_;
+        bool high_;
+        bool active_;
+        uint32_t width_;
+        uint32_t count_;
+};
+
+#endif  // __R51_TESTS_MOCK_PULSE__
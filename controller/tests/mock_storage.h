@@ -0,0 +1,45 @@
+#ifndef __R51_TESTS_MOCK_STORAGE__
+#define __R51_TESTS_MOCK_STORAGE__
+
+#include "src/storage.h"
+
+
+class MockStorage : public Storage {
+    public:
+        MockStorage(size_t size = 256) : size_(size), writes_(0) {
+            data_ = new byte[size_];
+            memset(data_, 0xFF, size_);
+        }
+
+        ~MockStorage() {
+            delete[] data_;
+        }
+
+        // Return the size of the storage.
+        size_t size() override {
+            return size_;
+        }
+
+        // Read a byte from storage.
+        byte read(size_t address) override {
+            return data_[address];
+        }
+
+        // Write a byte to storage. Counts the number of writes.
+        void write(size_t address, byte value) override {
+            data_[address] = value;
+            ++writes_;
+        }
+
+        // Return the number of bytes written since creation.
+        uint32_t writes() const {
+            return writes_;
+        }
+
+    private:
+        size_t size_;
+        uint32_t writes_;
+        byte* data_;
+};
+
+#endif  // __R51_TESTS_MOCK_STORAGE__
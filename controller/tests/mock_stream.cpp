@@ -30,6 +30,7 @@ size_t FakeReadStream::remaining() {
 }
 
 size_t FakeWriteStream::write(uint8_t byte) {
+    ++writes_;
     if (remaining() == 0) {
         return 0;
     }
@@ -38,6 +39,7 @@ size_t FakeWriteStream::write(uint8_t byte) {
 }
 
 size_t FakeWriteStream::write(const uint8_t* data, size_t len) {
+    ++writes_;
     if (remaining() < len) {
         len = remaining();
     }
@@ -51,8 +53,17 @@ void FakeWriteStream::set(byte* buffer, int len) {
     buffer_ = buffer;
     size_ = len;
     pos_ = 0;
+    writes_ = 0;
 }
 
 size_t FakeWriteStream::remaining() {
     return size_ - pos_;
 }
+
+int FakeWriteStream::availableForWrite() {
+    int remaining = size_ - pos_;
+    if (write_limit_ >= 0 && write_limit_ < remaining) {
+        return write_limit_;
+    }
+    return remaining;
+}
@@ -39,7 +39,7 @@ class FakeReadStream : public Stream {
 // A fake stream for writing to a buffer.
 class FakeWriteStream : public Stream {
     public:
-        FakeWriteStream() : buffer_(nullptr), size_(0), pos_(0) {}
+        FakeWriteStream() : buffer_(nullptr), size_(0), pos_(0), write_limit_(-1), writes_(0) {}
 
         // Write a byte to the buffer and advance the position. Returns 0 if
         // there is no more space in the buffer.
@@ -56,6 +56,16 @@ class FakeWriteStream : public Stream {
         // The number of bytes remaining in the read buffer.
         size_t remaining();
 
+        // Return the remaining capacity or the write limit if it is smaller.
+        int availableForWrite() override;
+
+        // Limit the number of bytes reported by availableForWrite() to mock a
+        // serial transmit buffer. Set to -1 to remove the limit.
+        void setWriteLimit(int limit) { write_limit_ = limit; }
+
+        // The number of calls to write().
+        int writes() const { return writes_; }
+
         // We don't use these so they are noops.
         int available() override { return 0; }
         int read() override { return 0; }
@@ -65,6 +75,23 @@ class FakeWriteStream : public Stream {
         byte* buffer_;
         int size_;
         int pos_;
+        int write_limit_;
+        int writes_;
+};
+
+// A fake stream which reads from one buffer and writes to another.
+class FakeStream : public FakeWriteStream {
+    public:
+        // Set the buffer to read from. Does not take ownership of the pointer.
+        void setRead(byte* buffer, int len) { read_.set(buffer, len); }
+
+        // Read from the read buffer.
+        int available() override { return read_.available(); }
+        int read() override { return read_.read(); }
+        int peek() override { return read_.peek(); }
+
+    private:
+        FakeReadStream read_;
 };
 
 #endif  // __R51_TESTS_MOCK_STREAM__
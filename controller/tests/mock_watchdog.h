@@ -0,0 +1,37 @@
+#ifndef __R51_TESTS_MOCK_WATCHDOG__
+#define __R51_TESTS_MOCK_WATCHDOG__
+
+#include "src/watchdog.h"
+
+
+class MockWatchdog : public Watchdog {
+    public:
+        MockWatchdog(ResetCause cause = RESET_CAUSE_POWER_ON) :
+            cause_(cause), timeout_(0), feeds_(0) {}
+
+        bool begin(uint32_t timeout_ms) override {
+            timeout_ = timeout_ms;
+            return true;
+        }
+
+        void feed() override {
+            ++feeds_;
+        }
+
+        ResetCause resetCause() override {
+            return cause_;
+        }
+
+        // The timeout passed to begin() or 0 if not started.
+        uint32_t timeout() const { return timeout_; }
+
+        // The number of times the watchdog was fed.
+        uint32_t feeds() const { return feeds_; }
+
+    private:
+        ResetCause cause_;
+        uint32_t timeout_;
+        uint32_t feeds_;
+};
+
+#endif  // __R51_TESTS_MOCK_WATCHDOG__
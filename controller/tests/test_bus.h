@@ -68,6 +68,32 @@ class MockNode : public Node {
         }
 };
 
+// Records monitor events as a string of characters.
+class RecordingMonitor : public BusMonitor {
+    public:
+        RecordingMonitor(char* events, char tag) : events_(events), tag_(tag) {}
+
+        void attach(Node**, uint8_t) override { record('a'); }
+        void loopStart() override { record('L'); }
+        void loopEnd() override { record('l'); }
+        void receiveStart(uint8_t) override { record('R'); }
+        void receiveEnd(uint8_t) override { record('r'); }
+        void broadcast(uint8_t, const Frame&) override { record('b'); }
+        void sendStart(uint8_t, const Frame&) override { record('S'); }
+        void sendEnd(uint8_t) override { record('s'); }
+
+    private:
+        char* events_;
+        char tag_;
+
+        void record(char event) {
+            size_t len = strlen(events_);
+            events_[len] = event;
+            events_[len + 1] = tag_;
+            events_[len + 2] = 0;
+        }
+};
+
 test(BusTest, SingleBroadcast) {
     MockNode n1 = MockNode(1);
     n1.receive_ = new Frame();
@@ -204,4 +230,28 @@ test(BusTest, MultiLoop) {
 
 }
 
+test(BusTest, MultiMonitor) {
+    MockNode n1 = MockNode(1);
+    n1.receive_ = new Frame();
+    n1.receive_->id = 1;
+    n1.receive_->len = 0;
+    n1.filter1_ = 1;
+    Node* nodes[] = {&n1};
+
+    char events[64];
+    memset(events, 0, sizeof(events));
+    RecordingMonitor m1(events, '1');
+    RecordingMonitor m2(events, '2');
+    BusMonitor* monitors[] = {&m1, &m2};
+    MultiMonitor monitor(monitors, 2);
+
+    Bus bus(nodes, 1, TimerWheel::real(), &monitor);
+    assertEqual(strcmp(events, "a1a2"), 0);
+
+    // Start events are forwarded in order and end events in reverse.
+    events[0] = 0;
+    bus.loop();
+    assertEqual(strcmp(events, "L1L2R1R2b1b2S1S2s2s1r2r1l2l1"), 0);
+}
+
 #endif  // __R51_TESTS_TEST_BUS__
@@ -0,0 +1,140 @@
+#ifndef __R51_TESTS_TEST_CALIBRATION__
+#define __R51_TESTS_TEST_CALIBRATION__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "src/calibration.h"
+
+using namespace aunit;
+
+
+// Record readings for a level every 5ms. Readings alternate between value and
+// value + spread.
+void calibrationRecord(LadderCalibration* cal, uint8_t label, uint16_t value,
+        uint16_t spread, uint32_t* now, uint32_t duration) {
+    cal->setLabel(label);
+    for (uint32_t end = *now + duration; *now < end; *now += 5) {
+        uint16_t v = (*now / 5) % 2 == 0 ? value : value + spread;
+        cal->record(v, *now);
+    }
+}
+
+test(LadderCalibrationTest, Compute) {
+    LadderCalibration cal(3, 10, 100, 40, 5, 5);
+    uint32_t now = 0;
+    calibrationRecord(&cal, 0x01, 60, 4, &now, 500);
+    calibrationRecord(&cal, 0x02, 300, 6, &now, 500);
+    calibrationRecord(&cal, 0x04, 600, 10, &now, 500);
+    calibrationRecord(&cal, 0x00, 1010, 13, &now, 500);
+
+    assertEqual(cal.stats(0).min, (uint16_t)60);
+    assertEqual(cal.stats(0).max, (uint16_t)64);
+    assertEqual(cal.stats(0).mean(), (uint16_t)62);
+    assertEqual(cal.stats(3).max, (uint16_t)1023);
+
+    uint16_t boundaries[3];
+    uint16_t debounce;
+    assertTrue(cal.compute(boundaries, &debounce));
+    assertEqual(boundaries[0], (uint16_t)182);
+    assertEqual(boundaries[1], (uint16_t)453);
+    assertEqual(boundaries[2], (uint16_t)810);
+    assertEqual(debounce, (uint16_t)5);
+}
+
+test(LadderCalibrationTest, IgnoreUnlabeledRuns) {
+    LadderCalibration cal(3, 10, 100, 40, 5, 5);
+    uint32_t now = 0;
+
+    // Idle readings recorded before the button is pressed are not added to
+    // the button's level.
+    calibrationRecord(&cal, 0x00, 1000, 0, &now, 500);
+    cal.setLabel(0x01);
+    for (uint32_t end = now + 300; now < end; now += 5) {
+        cal.record(1000, now);
+    }
+    calibrationRecord(&cal, 0x01, 50, 0, &now, 500);
+    assertEqual(cal.stats(0).min, (uint16_t)50);
+    assertEqual(cal.stats(0).max, (uint16_t)50);
+    assertEqual(cal.stats(3).min, (uint16_t)1000);
+
+    // A run shorter than the max glitch is not recorded.
+    cal.setLabel(0x02);
+    for (uint32_t end = now + 50; now < end; now += 5) {
+        cal.record(300, now);
+    }
+    assertEqual(cal.stats(1).count, (uint32_t)0);
+}
+
+test(LadderCalibrationTest, GlitchSetsDebounce) {
+    LadderCalibration cal(3, 10, 100, 40, 5, 5);
+    uint32_t now = 0;
+    calibrationRecord(&cal, 0x01, 50, 0, &now, 500);
+    calibrationRecord(&cal, 0x02, 280, 0, &now, 500);
+    calibrationRecord(&cal, 0x04, 640, 0, &now, 200);
+
+    // Volume down bounces to idle for 30ms.
+    for (uint32_t end = now + 30; now < end; now += 5) {
+        cal.record(1023, now);
+    }
+    calibrationRecord(&cal, 0x04, 640, 0, &now, 200);
+
+    // Longer gaps are ignored.
+    for (uint32_t end = now + 200; now < end; now += 5) {
+        cal.record(1023, now);
+    }
+    calibrationRecord(&cal, 0x04, 640, 0, &now, 200);
+    calibrationRecord(&cal, 0x00, 1023, 0, &now, 500);
+
+    uint16_t boundaries[3];
+    uint16_t debounce;
+    assertTrue(cal.compute(boundaries, &debounce));
+    assertEqual(cal.maxGlitch(), (uint16_t)30);
+    assertEqual(debounce, (uint16_t)35);
+
+    // Glitch readings are not part of the level.
+    assertEqual(cal.stats(2).max, (uint16_t)640);
+}
+
+test(LadderCalibrationTest, NotEnoughSamples) {
+    LadderCalibration cal(3, 200, 100, 40, 5, 5);
+    uint32_t now = 0;
+    calibrationRecord(&cal, 0x01, 50, 0, &now, 500);
+    calibrationRecord(&cal, 0x02, 280, 0, &now, 500);
+    calibrationRecord(&cal, 0x04, 640, 0, &now, 500);
+
+    uint16_t boundaries[3];
+    uint16_t debounce;
+    assertFalse(cal.compute(boundaries, &debounce));
+}
+
+test(LadderCalibrationTest, NeighboringLevel) {
+    LadderCalibration cal(3, 10, 100, 40, 5, 5);
+    uint32_t now = 0;
+
+    // Seek down reads 480 which the default thresholds decode as volume
+    // down.
+    calibrationRecord(&cal, 0x01, 60, 4, &now, 500);
+    calibrationRecord(&cal, 0x02, 480, 6, &now, 500);
+    calibrationRecord(&cal, 0x04, 700, 10, &now, 500);
+    calibrationRecord(&cal, 0x00, 1000, 10, &now, 500);
+    assertEqual(cal.stats(1).min, (uint16_t)480);
+    assertEqual(cal.stats(1).max, (uint16_t)486);
+
+    uint16_t boundaries[3];
+    uint16_t debounce;
+    assertTrue(cal.compute(boundaries, &debounce));
+    assertEqual(boundaries[0], (uint16_t)272);
+    assertEqual(boundaries[1], (uint16_t)593);
+    assertEqual(boundaries[2], (uint16_t)855);
+}
+
+test(LadderCalibrationTest, IgnoreChords) {
+    LadderCalibration cal(3, 10, 100, 40, 5, 5);
+    uint32_t now = 0;
+    calibrationRecord(&cal, 0x03, 50, 0, &now, 500);
+    assertEqual(cal.stats(0).count, (uint32_t)0);
+    assertEqual(cal.stats(1).count, (uint32_t)0);
+}
+
+#endif  // __R51_TESTS_TEST_CALIBRATION__
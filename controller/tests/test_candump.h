@@ -0,0 +1,193 @@
+#ifndef __R51_TESTS_TEST_CANDUMP__
+#define __R51_TESTS_TEST_CANDUMP__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_broadcast.h"
+#include "mock_clock.h"
+#include "mock_stream.h"
+#include "src/bus.h"
+#include "src/candump.h"
+
+using namespace aunit;
+
+
+test(CandumpTest, Format) {
+    char line[kCandumpLineSize];
+    byte data[] = {0xDE, 0xAD, 0xBE, 0xEF};
+    size_t len = formatCandump(line, 1234567890123, "can0", 0x123, data, 4);
+    assertEqual(strcmp(line, "(0001234567.890123) can0 123#DEADBEEF"), 0);
+    assertEqual(len, strlen(line));
+
+    len = formatCandump(line, 0, "node3", 0x5F00, data, 0);
+    assertEqual(strcmp(line, "(0000000000.000000) node3 00005F00#"), 0);
+    assertEqual(len, strlen(line));
+}
+
+test(CandumpTest, FormatFd) {
+    char line[kCandumpLineSize];
+    byte data[64];
+    for (int i = 0; i < 64; i++) {
+        data[i] = i;
+    }
+    size_t len = formatCandump(line, 1, "can0", 0x5F00, data, 64);
+    assertEqual(len, (size_t)(36 + 128));
+    assertEqual(strncmp(line, "(0000000000.000001) can0 00005F00##0000102", 42), 0);
+}
+
+test(CandumpTest, Parse) {
+    uint64_t micros;
+    Frame frame;
+    assertTrue(parseCandump("(1436509052.249713) vcan0 044#2A366C2BBA", &micros, &frame));
+    assertTrue(micros == 1436509052249713ULL);
+    Frame expect = {0x044, 5, {0x2A, 0x36, 0x6C, 0x2B, 0xBA}};
+    assertTrue(frameEquals(frame, expect));
+
+    // extended ID, lowercase, short fraction and trailing line ending
+    assertTrue(parseCandump("(12.5) can0 00005f00#0102\r\n", &micros, &frame));
+    assertTrue(micros == 12500000ULL);
+    expect = {0x5F00, 2, {0x01, 0x02}};
+    assertTrue(frameEquals(frame, expect));
+
+    // empty payload
+    assertTrue(parseCandump("(0.000001) can0 123#", &micros, &frame));
+    assertEqual(frame.len, 0);
+
+    // CAN FD
+    assertTrue(parseCandump("(0.000001) can0 123##1000102030405060708", &micros, &frame));
+    assertEqual(frame.len, 9);
+    assertEqual(frame.data[8], 0x08);
+}
+
+test(CandumpTest, ParseInvalid) {
+    uint64_t micros;
+    Frame frame;
+    assertFalse(parseCandump("", &micros, &frame));
+    assertFalse(parseCandump("123#00", &micros, &frame));
+    assertFalse(parseCandump("(1.0 can0 123#00", &micros, &frame));
+    assertFalse(parseCandump("(1.0) can0 #00", &micros, &frame));
+    assertFalse(parseCandump("(1.0) can0 123456789#00", &micros, &frame));
+    assertFalse(parseCandump("(1.0) can0 123#0", &micros, &frame));
+    assertFalse(parseCandump("(1.0) can0 123#0G", &micros, &frame));
+    assertFalse(parseCandump("(1.0) can0 123#R", &micros, &frame));
+    assertFalse(parseCandump("(1.0) can0 123#000102030405060708", &micros, &frame));
+}
+
+test(CandumpTest, ReplayRealTime) {
+    const char log[] =
+        "(100.000000) can0 001#01\n"
+        "(100.001000) can0 002#02\n"
+        "not a frame\n"
+        "\n"
+        "(100.003000) can0 003#03\n";
+    FakeReadStream stream;
+    stream.set((byte*)log, strlen(log));
+
+    MockClock clock;
+    TimerWheel timers(&clock);
+    MockBroadcast cb(4);
+    CandumpReplay replay(&timers);
+    replay.begin(&stream);
+
+    clock.set(500);
+    timers.update();
+    replay.receive(cb.impl);
+    assertEqual(cb.count(), 1);
+    assertEqual(cb.frames()[0].id, (uint32_t)0x001);
+
+    clock.delayMicros(999);
+    timers.update();
+    replay.receive(cb.impl);
+    assertEqual(cb.count(), 1);
+
+    clock.delayMicros(1);
+    timers.update();
+    replay.receive(cb.impl);
+    assertEqual(cb.count(), 2);
+    assertEqual(cb.frames()[1].id, (uint32_t)0x002);
+
+    clock.delayMicros(2000);
+    timers.update();
+    replay.receive(cb.impl);
+    assertEqual(cb.count(), 3);
+    assertEqual(cb.frames()[2].id, (uint32_t)0x003);
+    assertEqual(replay.count(), (uint32_t)3);
+    assertEqual(replay.dropped(), (uint32_t)1);
+}
+
+test(CandumpTest, ReplayAccelerated) {
+    const char log[] =
+        "(0.000000) can0 001#01\n"
+        "(0.010000) can0 002#02\n";
+    FakeReadStream stream;
+    stream.set((byte*)log, strlen(log));
+
+    MockClock clock;
+    TimerWheel timers(&clock);
+    MockBroadcast cb(2);
+    CandumpReplay replay(&timers);
+    replay.begin(&stream, 10);
+
+    replay.receive(cb.impl);
+    assertEqual(cb.count(), 1);
+    clock.delayMicros(999);
+    timers.update();
+    replay.receive(cb.impl);
+    assertEqual(cb.count(), 1);
+    clock.delayMicros(1);
+    timers.update();
+    replay.receive(cb.impl);
+    assertEqual(cb.count(), 2);
+}
+
+test(CandumpTest, ReplayFast) {
+    char log[64 * 24];
+    log[0] = 0;
+    for (int i = 0; i < CANDUMP_REPLAY_BATCH + 4; i++) {
+        sprintf(log + strlen(log), "(%d.000000) can0 %03X#00\n", i * 100, i + 1);
+    }
+    FakeReadStream stream;
+    stream.set((byte*)log, strlen(log));
+
+    MockClock clock;
+    TimerWheel timers(&clock);
+    MockBroadcast cb(CANDUMP_REPLAY_BATCH + 4);
+    CandumpReplay replay(&timers);
+    replay.begin(&stream, 0);
+
+    // Frames are limited to a batch per loop.
+    replay.receive(cb.impl);
+    assertEqual(cb.count(), CANDUMP_REPLAY_BATCH);
+    replay.receive(cb.impl);
+    assertEqual(cb.count(), CANDUMP_REPLAY_BATCH + 4);
+    assertEqual(cb.frames()[CANDUMP_REPLAY_BATCH + 3].id, (uint32_t)CANDUMP_REPLAY_BATCH + 4);
+}
+
+test(CandumpTest, Capture) {
+    char actual[128];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set((byte*)actual, sizeof(actual) - 1);
+
+    MockClock clock;
+    TimerWheel timers(&clock);
+    CandumpCapture capture(&timers);
+    capture.begin(&stream);
+
+    clock.set(2000);
+    clock.delayMicros(5);
+    timers.update();
+    Frame frame = {0x540, 2, {0x60, 0x80}};
+    capture.send(frame);
+
+    // The captured line can be replayed.
+    assertEqual(strcmp(actual, "(0000000002.000005) " CANDUMP_INTERFACE " 540#6080\n"), 0);
+    uint64_t micros;
+    Frame parsed;
+    assertTrue(parseCandump(actual, &micros, &parsed));
+    assertTrue(micros == 2000005ULL);
+    assertTrue(frameEquals(frame, parsed));
+}
+
+#endif  // __R51_TESTS_TEST_CANDUMP__
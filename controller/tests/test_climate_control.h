@@ -18,8 +18,10 @@ using namespace aunit;
 
 #define INIT_CONTROL(ACTIVE) \
     MockClock clock;\
+    TimerWheel timers(&clock);\
+    clock.attach(&timers);\
     MockGPIO gpio;\
-    Climate climate(&clock, &gpio);\
+    Climate climate(&timers, &gpio);\
     initClimate(&climate, &clock, ACTIVE);
     
 void initClimate(Climate* climate, MockClock* clock, bool active = false) {
@@ -53,6 +55,8 @@ bool checkNoControlFrames(Climate* climate, const Frame& control) {
 
 test(ClimateControlTest, Init) {
     MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
     MockGPIO gpio;
     MockBroadcast cast(2, 0x540, 0xFFFFFFF0);
 
@@ -61,7 +65,7 @@ test(ClimateControlTest, Init) {
     Frame ready540 = {0x540, 8, {0x60, 0x40, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00}};
     Frame ready541 = {0x541, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
 
-    Climate climate(&clock, &gpio);
+    Climate climate(&timers, &gpio);
     for (int i = 0; i < 4; i++) {
         climate.receive(cast.impl);
         assertTrue(checkFrameCount(cast, 2) &&
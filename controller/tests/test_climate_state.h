@@ -15,8 +15,10 @@ using namespace aunit;
 
 #define INIT_STATE() \
     MockClock clock;\
+    TimerWheel timers(&clock);\
+    clock.attach(&timers);\
     MockGPIO gpio;\
-    Climate climate(&clock, &gpio);
+    Climate climate(&timers, &gpio);
 
 bool checkStateFrames(Climate* climate, const Frame& state54A, const Frame& state54B, const Frame& expect) {
     MockBroadcast cast(1, 0x5400);
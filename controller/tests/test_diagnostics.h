@@ -0,0 +1,171 @@
+#ifndef __R51_TESTS_TEST_DIAGNOSTICS__
+#define __R51_TESTS_TEST_DIAGNOSTICS__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_broadcast.h"
+#include "mock_clock.h"
+#include "testing.h"
+#include "src/bus.h"
+#include "src/diagnostics.h"
+
+using namespace aunit;
+
+
+// A node which takes a fixed amount of time to receive and send frames.
+class DiagnosticsWorkNode : public Node {
+    public:
+        DiagnosticsWorkNode(MockClock* clock, uint32_t receive_us, uint32_t send_us) :
+            clock_(clock), receive_us_(receive_us), send_us_(send_us),
+            broadcast_id_(0), filter_id_(0), dropped_(0) {}
+
+        MockClock* clock_;
+        uint32_t receive_us_;
+        uint32_t send_us_;
+        uint32_t broadcast_id_;
+        uint32_t filter_id_;
+        uint32_t dropped_;
+
+        void receive(const Broadcast& broadcast) override {
+            clock_->delayMicros(receive_us_);
+            if (broadcast_id_ != 0) {
+                Frame frame;
+                initFrame(&frame, broadcast_id_, 8);
+                broadcast(frame);
+            }
+        }
+
+        void send(const Frame&) override {
+            clock_->delayMicros(send_us_);
+        }
+
+        bool filter(uint32_t id) const override {
+            return filter_id_ != 0 && id == filter_id_;
+        }
+
+        uint32_t dropped() const override {
+            return dropped_;
+        }
+};
+
+// A node which captures diagnostics frames.
+class DiagnosticsCaptureNode : public Node {
+    public:
+        DiagnosticsCaptureNode() : count_(0) {}
+
+        Frame frames_[16];
+        uint8_t count_;
+
+        void receive(const Broadcast&) override {}
+
+        void send(const Frame& frame) override {
+            if (count_ < 16) {
+                copyFrame(&frames_[count_++], frame);
+            }
+        }
+
+        bool filter(uint32_t id) const override {
+            return (id & 0xFFFFFF00) == 0x5F00;
+        }
+};
+
+test(DiagnosticsTest, Publish) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    Diagnostics diagnostics(&timers, &clock);
+
+    DiagnosticsWorkNode sender(&clock, 100, 0);
+    sender.broadcast_id_ = 0x100;
+    DiagnosticsWorkNode receiver(&clock, 20, 50);
+    receiver.filter_id_ = 0x100;
+    receiver.dropped_ = 3;
+    DiagnosticsCaptureNode capture;
+
+    Node* nodes[] = {&diagnostics, &sender, &receiver, &capture};
+    Bus bus(nodes, 4, &timers, &diagnostics);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        clock.set(i * 100);
+        bus.loop();
+    }
+    assertEqual(capture.count_, 0);
+
+    clock.set(1000);
+    bus.loop();
+    assertEqual(capture.count_, 6);
+
+    Frame summary = {0x5F00, 16, {
+        10, 0x00, 170, 0x00, 10, 0x00, 10, 0x00,
+        0x03, 0x00, 0x00, 0x00, 0x04, 0x01, 0x00, 0x00}};
+    assertTrue(checkFrameEquals(capture.frames_[0], summary));
+
+    Frame node0 = {0x5F10, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
+    assertTrue(checkFrameEquals(capture.frames_[1], node0));
+    // The send to the receiver is not included in the sender's receive time.
+    Frame node1 = {0x5F11, 8, {100, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
+    assertTrue(checkFrameEquals(capture.frames_[2], node1));
+    Frame node2 = {0x5F12, 8, {20, 0x00, 50, 0x00, 0x03, 0x00, 0x00, 0x00}};
+    assertTrue(checkFrameEquals(capture.frames_[3], node2));
+    Frame node3 = {0x5F13, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
+    assertTrue(checkFrameEquals(capture.frames_[4], node3));
+
+    Frame id = {0x5F02, 8, {0x00, 0x01, 0x00, 0x00, 10, 0x00, 10, 0x00}};
+    assertTrue(checkFrameEquals(capture.frames_[5], id));
+}
+
+test(DiagnosticsTest, ResetEachPeriod) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    Diagnostics diagnostics(&timers, &clock);
+
+    DiagnosticsWorkNode sender(&clock, 100, 0);
+    DiagnosticsCaptureNode capture;
+
+    Node* nodes[] = {&diagnostics, &sender, &capture};
+    Bus bus(nodes, 3, &timers, &diagnostics);
+
+    bus.loop();
+    // The sender no longer takes any time.
+    sender.receive_us_ = 0;
+    clock.set(1000);
+    bus.loop();
+    assertEqual(capture.count_, 4);
+    assertEqual(capture.frames_[0].data[2], 100);
+
+    clock.set(1500);
+    bus.loop();
+    capture.count_ = 0;
+    clock.set(2000);
+    bus.loop();
+    assertEqual(capture.count_, 5);
+    assertEqual(capture.frames_[0].data[2], 0);
+    // Two loops in the last second. The diagnostics frames from the previous
+    // period are counted.
+    assertEqual(capture.frames_[0].data[0], 2);
+    assertEqual(capture.frames_[0].data[4], 4);
+    assertEqual(capture.frames_[0].data[13], 4);
+}
+
+test(DiagnosticsTest, NodeSizes) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    Diagnostics diagnostics(&timers, &clock);
+    DiagnosticsCaptureNode capture;
+
+    Node* nodes[] = {&diagnostics, &capture};
+    uint16_t sizes[] = {0x1234, 0x56};
+    diagnostics.nodeSizes(sizes);
+    Bus bus(nodes, 2, &timers, &diagnostics);
+
+    clock.set(1000);
+    bus.loop();
+    assertEqual(capture.count_, 3);
+
+    Frame node0 = {0x5F10, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x34, 0x12}};
+    assertTrue(checkFrameEquals(capture.frames_[1], node0));
+    Frame node1 = {0x5F11, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x56, 0x00}};
+    assertTrue(checkFrameEquals(capture.frames_[2], node1));
+}
+
+#endif  // __R51_TESTS_TEST_DIAGNOSTICS__
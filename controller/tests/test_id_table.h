@@ -0,0 +1,65 @@
+#ifndef __R51_TESTS_TEST_ID_TABLE__
+#define __R51_TESTS_TEST_ID_TABLE__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "src/id_table.h"
+
+using namespace aunit;
+
+
+struct TestIdEntry {
+    uint32_t id;
+    bool used;
+    int value;
+};
+
+test(IdTableTest, Insert) {
+    IdTable<TestIdEntry, 4> table;
+    assertEqual(table.find(0x540), nullptr);
+
+    bool added = false;
+    TestIdEntry* entry = table.insert(0x540, &added);
+    assertNotEqual(entry, nullptr);
+    assertTrue(added);
+    assertEqual(entry->id, 0x540u);
+    entry->value = 1;
+
+    assertEqual(table.insert(0x540, &added), entry);
+    assertFalse(added);
+    assertEqual(table.find(0x540), entry);
+    assertEqual(table.count(), 1u);
+}
+
+test(IdTableTest, Full) {
+    IdTable<TestIdEntry, 4> table;
+    for (uint32_t id = 1; id <= 4; id++) {
+        assertNotEqual(table.insert(id), nullptr);
+    }
+    assertEqual(table.count(), 4u);
+    for (uint32_t id = 1; id <= 4; id++) {
+        TestIdEntry* entry = table.find(id);
+        assertNotEqual(entry, nullptr);
+        assertEqual(entry->id, id);
+    }
+
+    bool added = true;
+    assertEqual(table.insert(5, &added), nullptr);
+    assertFalse(added);
+    assertEqual(table.find(5), nullptr);
+}
+
+test(IdTableTest, Clear) {
+    IdTable<TestIdEntry, 4> table;
+    table.insert(0x540);
+    table.insert(0x541);
+    table.clear();
+    assertEqual(table.count(), 0u);
+    assertEqual(table.find(0x540), nullptr);
+    for (size_t i = 0; i < table.slots(); i++) {
+        assertFalse(table[i].used);
+    }
+}
+
+#endif  // __R51_TESTS_TEST_ID_TABLE__
@@ -0,0 +1,267 @@
+#ifndef __R51_TESTS_TEST_ISOTP__
+#define __R51_TESTS_TEST_ISOTP__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_clock.h"
+#include "src/bus.h"
+#include "src/isotp.h"
+#include "testing.h"
+
+using namespace aunit;
+
+
+test(IsoTpTest, SingleFrame) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    IsoTp isotp(0x71E, 0x72E, 0, 0, 100, &timers);
+    Frame frame;
+
+    byte request[] = {0x10, 0xC0};
+    Frame expect_request = {0x71E, 8, {0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+    assertTrue(isotp.write(request, 2));
+    assertTrue(isotp.receive(&frame));
+    assertTrue(checkFrameEquals(frame, expect_request));
+    assertFalse(isotp.receive(&frame));
+    assertFalse(isotp.busy());
+
+    Frame response = {0x72E, 8, {0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+    assertTrue(isotp.send(response));
+    assertEqual(isotp.length(), (uint16_t)2);
+    assertEqual(isotp.message()[0], 0x50);
+    assertEqual(isotp.message()[1], 0xC0);
+}
+
+test(IsoTpTest, IgnoreOtherId) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    IsoTp isotp(0x71E, 0x72E, 0, 0, 100, &timers);
+    Frame frame = {0x72F, 8, {0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+    assertFalse(isotp.send(frame));
+}
+
+test(IsoTpTest, ReceiveMultiFrame) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    IsoTp isotp(0x71E, 0x72E, 0, 0x0A, 100, &timers);
+    Frame frame;
+
+    Frame first = {0x72E, 8, {0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00}};
+    Frame fc = {0x71E, 8, {0x30, 0x00, 0x0A, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+    Frame cf1 = {0x72E, 8, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00}};
+    Frame cf2 = {0x72E, 8, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}};
+    byte expect[] = {
+        0x61, 0x01, 0x00, 0x1E, 0x24, 0x00, 0x10, 0x0C, 0x40,
+        0x40, 0x01, 0x64, 0x00, 0x94, 0x00, 0x00, 0x47};
+
+    assertFalse(isotp.send(first));
+    assertTrue(isotp.busy());
+    assertTrue(isotp.receive(&frame));
+    assertTrue(checkFrameEquals(frame, fc));
+    assertFalse(isotp.receive(&frame));
+    assertFalse(isotp.send(cf1));
+    assertTrue(isotp.send(cf2));
+    assertFalse(isotp.busy());
+    assertEqual(isotp.length(), (uint16_t)sizeof(expect));
+    assertEqual(memcmp(isotp.message(), expect, sizeof(expect)), 0);
+}
+
+test(IsoTpTest, ReceiveBlockSize) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    IsoTp isotp(0x71E, 0x72E, 1, 0, 100, &timers);
+    Frame frame;
+
+    Frame first = {0x72E, 8, {0x10, 0x0F, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06}};
+    Frame fc = {0x71E, 8, {0x30, 0x01, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+    Frame cf1 = {0x72E, 8, {0x21, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D}};
+    Frame cf2 = {0x72E, 8, {0x22, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+
+    assertFalse(isotp.send(first));
+    assertTrue(isotp.receive(&frame));
+    assertTrue(checkFrameEquals(frame, fc));
+    assertFalse(isotp.send(cf1));
+
+    // Block is complete. Another flow control is needed.
+    assertTrue(isotp.receive(&frame));
+    assertTrue(checkFrameEquals(frame, fc));
+    assertTrue(isotp.send(cf2));
+    assertEqual(isotp.length(), (uint16_t)15);
+    for (uint8_t i = 0; i < 15; i++) {
+        assertEqual(isotp.message()[i], i + 1);
+    }
+}
+
+test(IsoTpTest, ReceiveOutOfSequence) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    IsoTp isotp(0x71E, 0x72E, 0, 0, 100, &timers);
+    Frame frame;
+
+    Frame first = {0x72E, 8, {0x10, 0x0F, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06}};
+    Frame cf2 = {0x72E, 8, {0x22, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+
+    assertFalse(isotp.send(first));
+    assertTrue(isotp.receive(&frame));
+    assertFalse(isotp.send(cf2));
+    assertFalse(isotp.busy());
+}
+
+test(IsoTpTest, ReceiveTimeout) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    IsoTp isotp(0x71E, 0x72E, 0, 0, 100, &timers);
+    Frame frame;
+
+    Frame first = {0x72E, 8, {0x10, 0x0F, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06}};
+    Frame cf1 = {0x72E, 8, {0x21, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D}};
+
+    assertFalse(isotp.send(first));
+    assertTrue(isotp.receive(&frame));
+    clock.delay(100);
+    assertFalse(isotp.receive(&frame));
+    assertFalse(isotp.busy());
+    assertFalse(isotp.send(cf1));
+}
+
+test(IsoTpTest, ReceiveOverflow) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    IsoTp isotp(0x71E, 0x72E, 0, 0, 100, &timers);
+    Frame frame;
+
+    Frame first = {0x72E, 8, {0x11, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06}};
+    Frame fc = {0x71E, 8, {0x32, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+
+    assertFalse(isotp.send(first));
+    assertTrue(isotp.receive(&frame));
+    assertTrue(checkFrameEquals(frame, fc));
+    assertFalse(isotp.busy());
+}
+
+test(IsoTpTest, SendMultiFrame) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    IsoTp isotp(0x71E, 0x72E, 0, 0, 100, &timers);
+    Frame frame;
+
+    byte request[16];
+    for (uint8_t i = 0; i < 16; i++) {
+        request[i] = i + 1;
+    }
+    Frame first = {0x71E, 8, {0x10, 0x10, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06}};
+    Frame fc = {0x72E, 8, {0x30, 0x02, 0x05, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+    Frame cf1 = {0x71E, 8, {0x21, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D}};
+    Frame cf2 = {0x71E, 8, {0x22, 0x0E, 0x0F, 0x10, 0xFF, 0xFF, 0xFF, 0xFF}};
+
+    assertTrue(isotp.write(request, 16));
+    assertFalse(isotp.write(request, 16));
+    assertTrue(isotp.receive(&frame));
+    assertTrue(checkFrameEquals(frame, first));
+
+    // Wait for flow control.
+    assertFalse(isotp.receive(&frame));
+    isotp.send(fc);
+
+    // First consecutive frame is sent immediately.
+    assertTrue(isotp.receive(&frame));
+    assertTrue(checkFrameEquals(frame, cf1));
+
+    // Wait STmin before the next.
+    clock.delay(4);
+    assertFalse(isotp.receive(&frame));
+    clock.delay(1);
+    assertTrue(isotp.receive(&frame));
+    assertTrue(checkFrameEquals(frame, cf2));
+    assertFalse(isotp.receive(&frame));
+    assertFalse(isotp.busy());
+}
+
+test(IsoTpTest, SendSubMillisecondStMin) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    IsoTp isotp(0x71E, 0x72E, 0, 0, 100, &timers);
+    Frame frame;
+
+    byte request[27] = {0};
+    Frame fc = {0x72E, 8, {0x30, 0x00, 0xF5, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+
+    assertTrue(isotp.write(request, 27));
+    assertTrue(isotp.receive(&frame));
+    isotp.send(fc);
+    assertTrue(isotp.receive(&frame));
+    assertEqual(frame.data[0], 0x21);
+
+    // STmin 0xF5 is 500us.
+    clock.delayMicros(499);
+    assertFalse(isotp.receive(&frame));
+    clock.delayMicros(1);
+    assertTrue(isotp.receive(&frame));
+    assertEqual(frame.data[0], 0x22);
+    assertFalse(isotp.receive(&frame));
+    clock.delayMicros(500);
+    assertTrue(isotp.receive(&frame));
+    assertEqual(frame.data[0], 0x23);
+    assertFalse(isotp.busy());
+}
+
+test(IsoTpTest, SendBlockSize) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    IsoTp isotp(0x71E, 0x72E, 0, 0, 100, &timers);
+    Frame frame;
+
+    byte request[16] = {0};
+    Frame fc = {0x72E, 8, {0x30, 0x01, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+
+    assertTrue(isotp.write(request, 16));
+    assertTrue(isotp.receive(&frame));
+    isotp.send(fc);
+    assertTrue(isotp.receive(&frame));
+    assertEqual(frame.data[0], 0x21);
+
+    // Block is complete. Wait for flow control.
+    assertFalse(isotp.receive(&frame));
+    isotp.send(fc);
+    assertTrue(isotp.receive(&frame));
+    assertEqual(frame.data[0], 0x22);
+    assertFalse(isotp.busy());
+}
+
+test(IsoTpTest, SendFlowControlTimeout) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    IsoTp isotp(0x71E, 0x72E, 0, 0, 100, &timers);
+    Frame frame;
+
+    byte request[16] = {0};
+    Frame wait = {0x72E, 8, {0x31, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+
+    assertTrue(isotp.write(request, 16));
+    assertTrue(isotp.receive(&frame));
+
+    // Wait frame restarts the timeout.
+    clock.delay(99);
+    isotp.send(wait);
+    clock.delay(99);
+    assertFalse(isotp.receive(&frame));
+    assertTrue(isotp.busy());
+    clock.delay(1);
+    assertFalse(isotp.receive(&frame));
+    assertFalse(isotp.busy());
+    assertTrue(isotp.write(request, 16));
+}
+
+#endif  // __R51_TESTS_TEST_ISOTP__
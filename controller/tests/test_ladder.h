@@ -0,0 +1,143 @@
+#ifndef __R51_TESTS_TEST_LADDER__
+#define __R51_TESTS_TEST_LADDER__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_clock.h"
+#include "mock_gpio.h"
+#include "src/AnalogMultiButton.h"
+#include "src/config.h"
+#include "src/ladder.h"
+
+using namespace aunit;
+
+
+static constexpr const int kLadderTestValues[] = STEERING_SWITCH_VALUES;
+static constexpr LadderTable<1024> kLadderTestTable =
+    makeLadderTable<1024>(kLadderTestValues, STEERING_SWITCH_COUNT);
+static_assert(kLadderTestTable.masks[0] == 0x01, "table is generated at compile time");
+
+static constexpr const LadderLevel kLadderTestChords[] = {
+    {100, 0x01},
+    {300, 0x02},
+    {450, 0x03},
+    {700, 0x04},
+};
+static constexpr LadderTable<1024> kLadderTestChordTable =
+    makeLadderTable<1024>(kLadderTestChords, 4);
+
+// Return the mask of the button pressed by an AnalogMultiButton.
+uint8_t analogMultiButtonMask(AnalogMultiButton* button) {
+    for (uint8_t i = 0; i < STEERING_SWITCH_COUNT; i++) {
+        if (button->isPressed(i)) {
+            return 1 << i;
+        }
+    }
+    return 0;
+}
+
+test(LadderTest, DecodeMatchesAnalogMultiButton) {
+    MockClock clock;
+    MockGPIO gpio;
+    AnalogMultiButton button(0, STEERING_SWITCH_COUNT, kLadderTestValues,
+            AnalogMultiButton::DEFAULT_DEBOUNCE_DURATION,
+            AnalogMultiButton::DEFAULT_ANALOG_RESOLUTION,
+            &clock, &gpio);
+
+    for (uint16_t value = 0; value < 1024; value++) {
+        gpio.analogWrite(0, value);
+        button.update();
+        clock.delay(AnalogMultiButton::DEFAULT_DEBOUNCE_DURATION + 1);
+        button.update();
+        assertEqual(kLadderTestTable.decode(value), analogMultiButtonMask(&button));
+    }
+    assertEqual(kLadderTestTable.decode(1024), 0);
+}
+
+test(LadderTest, DebounceMatchesAnalogMultiButton) {
+    MockClock clock;
+    MockGPIO gpio;
+    AnalogMultiButton button(0, STEERING_SWITCH_COUNT, kLadderTestValues,
+            AnalogMultiButton::DEFAULT_DEBOUNCE_DURATION,
+            AnalogMultiButton::DEFAULT_ANALOG_RESOLUTION,
+            &clock, &gpio);
+    LadderInput input(&kLadderTestTable, AnalogMultiButton::DEFAULT_DEBOUNCE_DURATION);
+
+    // Replay a pseudo-random series of readings and update intervals.
+    uint32_t seed = 51;
+    for (uint16_t i = 0; i < 2000; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint16_t value = (seed >> 8) % 1024;
+        seed = seed * 1103515245 + 12345;
+        uint8_t repeat = (seed >> 8) % 8;
+        seed = seed * 1103515245 + 12345;
+        uint8_t step = (seed >> 8) % 10;
+
+        gpio.analogWrite(0, value);
+        for (uint8_t j = 0; j <= repeat; j++) {
+            clock.delay(step);
+            button.update();
+            input.update(value, clock.millis());
+            uint8_t expect = analogMultiButtonMask(&button);
+            assertEqual(input.pressed(), expect);
+            for (uint8_t b = 0; b < STEERING_SWITCH_COUNT; b++) {
+                assertEqual((bool)(input.onPress() & (1 << b)), (bool)button.onPress(b));
+                assertEqual((bool)(input.onRelease() & (1 << b)), (bool)button.onRelease(b));
+            }
+            if (expect != 0) {
+                assertEqual((int)(clock.millis() - input.pressTime()), button.getPressDuration());
+            }
+        }
+    }
+}
+
+test(LadderTest, Chords) {
+    assertEqual(kLadderTestChordTable.decode(0), 0x01);
+    assertEqual(kLadderTestChordTable.decode(199), 0x01);
+    assertEqual(kLadderTestChordTable.decode(200), 0x02);
+    assertEqual(kLadderTestChordTable.decode(375), 0x03);
+    assertEqual(kLadderTestChordTable.decode(575), 0x04);
+    assertEqual(kLadderTestChordTable.decode(862), 0x00);
+
+    LadderInput input(&kLadderTestChordTable, 20);
+    assertFalse(input.update(100, 0));
+    assertTrue(input.update(100, 21));
+    assertEqual(input.pressed(), 0x01);
+    assertEqual(input.onPress(), 0x01);
+
+    // Second button pressed while the first is held.
+    assertFalse(input.update(450, 30));
+    assertFalse(input.update(450, 50));
+    assertTrue(input.update(450, 51));
+    assertEqual(input.pressed(), 0x03);
+    assertEqual(input.onPress(), 0x02);
+    assertEqual(input.onRelease(), 0x00);
+
+    // First button released.
+    assertFalse(input.update(300, 60));
+    assertTrue(input.update(300, 81));
+    assertEqual(input.pressed(), 0x02);
+    assertEqual(input.onPress(), 0x00);
+    assertEqual(input.onRelease(), 0x01);
+}
+
+test(LadderTest, BoundariesMatchTable) {
+    uint16_t boundaries[STEERING_SWITCH_COUNT];
+    for (uint8_t i = 0; i < STEERING_SWITCH_COUNT; i++) {
+        boundaries[i] = ladder::boundary(kLadderTestValues, STEERING_SWITCH_COUNT, 1024, i);
+    }
+    LadderInput table(&kLadderTestTable);
+    LadderInput input(&kLadderTestTable);
+    input.setBoundaries(boundaries, STEERING_SWITCH_COUNT, 20);
+    for (uint16_t value = 0; value < 1100; value++) {
+        assertEqual(input.decode(value), table.decode(value));
+    }
+
+    // Restoring the table stops using the boundaries.
+    boundaries[0] = 0;
+    input.setTable(kLadderTestTable.masks, 1024, 20);
+    assertEqual(input.decode(0), 0x01);
+}
+
+#endif  // __R51_TESTS_TEST_LADDER__
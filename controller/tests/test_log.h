@@ -0,0 +1,167 @@
+#ifndef __R51_TESTS_TEST_LOG__
+#define __R51_TESTS_TEST_LOG__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_stream.h"
+#include "src/log.h"
+
+using namespace aunit;
+
+
+test(LogRingTest, DrainCommitted) {
+    uint8_t buffer[32];
+    LogRing log(buffer, sizeof(buffer));
+
+    byte actual[32];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set(actual, sizeof(actual));
+
+    log.print("hello");
+    assertEqual(log.available(), 0u);
+    assertEqual(log.drain(&stream), 0u);
+
+    assertTrue(log.commit());
+    assertEqual(log.available(), 1u);
+    assertEqual(log.drain(&stream), 5u);
+    assertEqual(log.available(), 0u);
+    assertEqual(memcmp(actual, "hello", 5), 0);
+}
+
+test(LogRingTest, DrainWholeMessages) {
+    uint8_t buffer[32];
+    LogRing log(buffer, sizeof(buffer));
+
+    byte actual[32];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set(actual, sizeof(actual));
+    stream.setWriteLimit(12);
+
+    // The second message waits for room instead of being split.
+    log.print("abcdefgh");
+    log.commit();
+    log.print("ijklmn");
+    log.commit();
+    assertEqual(log.drain(&stream), 8u);
+    assertEqual(log.available(), 1u);
+    stream.setWriteLimit(4);
+    assertEqual(log.drain(&stream), 0u);
+
+    // wraps around the end of the ring
+    log.print("opqrstuvwxyz");
+    log.commit();
+    stream.setWriteLimit(-1);
+    assertEqual(log.drain(&stream), 18u);
+    assertEqual(log.available(), 0u);
+    assertEqual(memcmp(actual, "abcdefghijklmnopqrstuvwxyz", 26), 0);
+}
+
+test(LogRingTest, DrainLongMessage) {
+    uint8_t buffer[32];
+    LogRing log(buffer, sizeof(buffer));
+
+    byte actual[32];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set(actual, sizeof(actual));
+    stream.setWriteLimit(4);
+
+    // A message which can never fit in the port's buffer is written whole.
+    log.print("0123456789");
+    log.commit();
+    assertEqual(log.drain(&stream), 10u);
+    assertEqual(memcmp(actual, "0123456789", 10), 0);
+}
+
+test(LogRingTest, DropWhenFull) {
+    uint8_t buffer[32];
+    LogRing log(buffer, sizeof(buffer));
+
+    byte actual[64];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set(actual, sizeof(actual));
+
+    log.print("0123456789abcdef");
+    assertTrue(log.commit());
+    log.print("ghijklmnopqrst");
+    assertFalse(log.commit());
+    assertEqual(log.dropped(), 1u);
+    assertEqual(log.available(), 1u);
+
+    // the next message fits after the drop
+    log.print("xyz");
+    assertTrue(log.commit());
+
+    const char expect[] = "0123456789abcdefxyz[ERROR] log: dropped 1\r\n";
+    size_t len = sizeof(expect) - 1;
+    assertEqual(log.drain(&stream), len);
+    assertEqual(memcmp(actual, expect, len), 0);
+
+    // drops are reported once
+    assertEqual(log.drain(&stream), 0u);
+}
+
+test(LogRingTest, Sync) {
+    uint8_t buffer[32];
+    LogRing log(buffer, sizeof(buffer));
+
+    byte actual[32];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set(actual, sizeof(actual));
+    stream.setWriteLimit(0);
+
+    // Messages logged before sync are flushed when it starts.
+    log.print("abc");
+    log.commit();
+    log.sync(&stream);
+    assertEqual(log.available(), 0u);
+    assertEqual(memcmp(actual, "abc", 3), 0);
+
+    // Messages are written on commit even though the port is full.
+    log.print("def");
+    log.commit();
+    assertEqual(log.available(), 0u);
+    assertEqual(memcmp(actual, "abcdef", 6), 0);
+
+    log.sync(nullptr);
+    log.print("ghi");
+    log.commit();
+    assertEqual(log.available(), 1u);
+    assertEqual(actual[6], 0);
+}
+
+test(LogControlTest, SetLevels) {
+    LogLevels levels;
+    LogControl control(&levels);
+    assertTrue(levels.enabled(LOG_SETTINGS, LOG_LEVEL_INFO));
+
+    Frame frame = {0x5F01, 8, {LOG_SETTINGS, LOG_LEVEL_ERROR}};
+    assertTrue(control.filter(frame.id));
+    control.send(frame);
+    assertFalse(levels.enabled(LOG_SETTINGS, LOG_LEVEL_INFO));
+    assertTrue(levels.enabled(LOG_SETTINGS, LOG_LEVEL_ERROR));
+    assertTrue(levels.enabled(LOG_CAN, LOG_LEVEL_INFO));
+
+    frame.data[0] = 0xFF;
+    frame.data[1] = LOG_LEVEL_OFF;
+    control.send(frame);
+    for (uint8_t i = 0; i < LOG_MODULE_COUNT; i++) {
+        assertFalse(levels.enabled((LogModule)i, LOG_LEVEL_ERROR));
+    }
+
+    // invalid modules and levels are ignored
+    frame.data[0] = LOG_MODULE_COUNT;
+    frame.data[1] = LOG_LEVEL_INFO;
+    control.send(frame);
+    frame.data[0] = LOG_CAN;
+    frame.data[1] = 3;
+    control.send(frame);
+    assertTrue(levels.level(LOG_CAN) == LOG_LEVEL_OFF);
+}
+
+#endif  // __R51_TESTS_TEST_LOG__
@@ -0,0 +1,94 @@
+#ifndef __R51_TESTS_TEST_LOOP_MONITOR__
+#define __R51_TESTS_TEST_LOOP_MONITOR__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_broadcast.h"
+#include "mock_clock.h"
+#include "mock_watchdog.h"
+#include "src/bus.h"
+#include "src/loop_monitor.h"
+
+using namespace aunit;
+
+
+// A node which takes a fixed amount of time to receive frames.
+class LoopMonitorWorkNode : public Node {
+    public:
+        LoopMonitorWorkNode(MockClock* clock, uint32_t receive_us) :
+            clock_(clock), receive_us_(receive_us) {}
+
+        MockClock* clock_;
+        uint32_t receive_us_;
+
+        void receive(const Broadcast&) override {
+            clock_->delayMicros(receive_us_);
+        }
+
+        void send(const Frame&) override {}
+
+        bool filter(uint32_t) const override { return false; }
+};
+
+test(LoopMonitorTest, FeedAndOverrun) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    MockWatchdog watchdog;
+    LoopMonitorState state;
+    LoopMonitor monitor(&watchdog, &state, &timers, &clock);
+    monitor.begin();
+    assertEqual(watchdog.timeout(), (uint32_t)WATCHDOG_TIMEOUT);
+
+    LoopMonitorWorkNode fast(&clock, 100);
+    LoopMonitorWorkNode slow(&clock, WATCHDOG_LOOP_DEADLINE * 1000);
+    Node* nodes[] = {&fast, &monitor, &slow};
+    Bus bus(nodes, 3, &timers, &monitor);
+
+    slow.receive_us_ = 10;
+    bus.loop();
+    assertEqual(watchdog.feeds(), (uint32_t)1);
+    assertEqual(monitor.overruns(), (uint32_t)0);
+    assertEqual(monitor.overrunNode(), LoopMonitor::kNoNode);
+
+    slow.receive_us_ = WATCHDOG_LOOP_DEADLINE * 1000;
+    bus.loop();
+    assertEqual(watchdog.feeds(), (uint32_t)2);
+    assertEqual(monitor.overruns(), (uint32_t)1);
+    assertEqual(monitor.overrunNode(), 2);
+    assertEqual(state.node, LoopMonitor::kNoNode);
+}
+
+test(LoopMonitorTest, WatchdogReset) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    LoopMonitorState state;
+    state.magic = 0;
+
+    // Node state is not trusted after a power on.
+    MockWatchdog power_on(RESET_CAUSE_POWER_ON);
+    LoopMonitor before(&power_on, &state, &timers, &clock);
+    before.begin();
+    assertEqual(before.resetNode(), LoopMonitor::kNoNode);
+
+    // Mock a node which blocks while sending to another node.
+    before.receiveStart(3);
+    before.sendStart(5, Frame());
+
+    MockWatchdog watchdog(RESET_CAUSE_WATCHDOG);
+    LoopMonitor after(&watchdog, &state, &timers, &clock);
+    after.begin();
+    assertEqual(after.resetCause(), RESET_CAUSE_WATCHDOG);
+    assertEqual(after.resetNode(), 3);
+    assertEqual(after.resetSendNode(), 5);
+
+    clock.set(WATCHDOG_FRAME_HB);
+    timers.update();
+    MockBroadcast cb;
+    after.receive(cb.impl);
+    assertEqual(cb.count(), 1);
+    Frame expect = {WATCHDOG_FRAME_ID, 8, {RESET_CAUSE_WATCHDOG, 3, 5, 0xFF, 0, 0, 0, 0}};
+    assertTrue(frameEquals(cb.frames()[0], expect));
+}
+
+#endif  // __R51_TESTS_TEST_LOOP_MONITOR__
@@ -0,0 +1,144 @@
+#ifndef __R51_TESTS_TEST_MEMORY__
+#define __R51_TESTS_TEST_MEMORY__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_broadcast.h"
+#include "mock_clock.h"
+#include "mock_memory.h"
+#include "mock_stream.h"
+#include "testing.h"
+#include "src/bus.h"
+#include "src/memory.h"
+
+using namespace aunit;
+
+
+// Receive until a full scan of free RAM has completed.
+void memoryScan(MemoryMonitor* monitor, const Broadcast& broadcast) {
+    for (uint32_t i = 0; i <= FakeMemoryLayout::kSize / 4 / MemoryMonitor::kScanWords + 1; i++) {
+        monitor->receive(broadcast);
+    }
+}
+
+test(MemoryTest, HighWater) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    FakeMemoryLayout layout(1000, 512);
+    MemoryMonitor monitor(&layout, &timers);
+    monitor.begin();
+    assertTrue(monitor.supported());
+
+    // Painting stops below the margin under the stack pointer.
+    uint32_t painted_top = 512 + MEMORY_STACK_MARGIN;
+    assertEqual(monitor.stackHighWater(), painted_top);
+    assertEqual(monitor.freeRam(), FakeMemoryLayout::kSize - painted_top - 1000);
+
+    MockBroadcast cb;
+    memoryScan(&monitor, cb.impl);
+    assertEqual(monitor.stackHighWater(), painted_top);
+
+    // Words left untouched between stack frames do not hide deeper use.
+    layout.touch(painted_top + 64);
+    layout.touch(painted_top + 200);
+    memoryScan(&monitor, cb.impl);
+    assertEqual(monitor.stackHighWater(), painted_top + 200);
+    assertEqual(monitor.freeRam(), FakeMemoryLayout::kSize - painted_top - 200 - 1000);
+
+    // Heap growth reduces free RAM but is not counted as stack.
+    layout.heap_ = 1200;
+    memoryScan(&monitor, cb.impl);
+    assertEqual(monitor.stackHighWater(), painted_top + 200);
+    assertEqual(monitor.freeRam(), FakeMemoryLayout::kSize - painted_top - 200 - 1200);
+}
+
+test(MemoryTest, ScanBudget) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    FakeMemoryLayout layout(0, 0);
+    MemoryMonitor monitor(&layout, &timers);
+    monitor.begin();
+
+    // The scan starts at the heap so the top of the painted region is only
+    // reached after several loops.
+    uint32_t offset = MEMORY_STACK_MARGIN + 4;
+    layout.touch(offset);
+    MockBroadcast cb;
+    monitor.receive(cb.impl);
+    assertEqual(monitor.stackHighWater(), (uint32_t)MEMORY_STACK_MARGIN);
+    memoryScan(&monitor, cb.impl);
+    assertEqual(monitor.stackHighWater(), offset);
+
+    // Stack use down to the heap leaves no free RAM.
+    layout.touch(FakeMemoryLayout::kSize);
+    memoryScan(&monitor, cb.impl);
+    assertEqual(monitor.stackHighWater(), FakeMemoryLayout::kSize);
+    assertEqual(monitor.freeRam(), (uint32_t)0);
+}
+
+test(MemoryTest, Frame) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    FakeMemoryLayout layout(1024, 0);
+    layout.heap_used_ = 0x0304;
+    layout.static_size_ = 0x050607;
+    MemoryMonitor monitor(&layout, &timers);
+    monitor.begin();
+
+    MockBroadcast cb;
+    monitor.receive(cb.impl);
+    assertEqual(cb.count(), 0);
+
+    clock.set(MEMORY_FRAME_HB);
+    timers.update();
+    monitor.receive(cb.impl);
+    assertEqual(cb.count(), 1);
+
+    uint32_t stack = MEMORY_STACK_MARGIN;
+    uint32_t free = FakeMemoryLayout::kSize - MEMORY_STACK_MARGIN - 1024;
+    Frame expect = {MEMORY_FRAME_ID, 16, {
+        (uint8_t)stack, (uint8_t)(stack >> 8), 0x00, 0x00,
+        0x04, 0x03, 0x00, 0x00,
+        (uint8_t)free, (uint8_t)(free >> 8), 0x00, 0x00,
+        0x07, 0x06, 0x05, 0x00}};
+    assertTrue(checkFrameEquals(cb.frames()[0], expect));
+}
+
+test(MemoryTest, Report) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    FakeMemoryLayout layout(1024, 0);
+    layout.heap_used_ = 48;
+    layout.static_size_ = 2000;
+    MemoryMonitor monitor(&layout, &timers);
+    uint16_t sizes[] = {72, 420};
+    monitor.nodeSizes(sizes, 2);
+
+    char actual[256];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set((byte*)actual, sizeof(actual) - 1);
+    monitor.begin(&stream);
+
+    MockBroadcast cb;
+    monitor.receive(cb.impl);
+    assertEqual(strlen(actual), (size_t)0);
+
+    Frame control = {MEMORY_CONTROL_FRAME_ID, 1, {0x01}};
+    assertTrue(monitor.filter(control.id));
+    monitor.send(control);
+    monitor.receive(cb.impl);
+
+    const char expect[] =
+        "memory: static 2000 heap 48 stack 256 free 2816\r\n"
+        "memory: node 0 size 72\r\n"
+        "memory: node 1 size 420\r\n";
+    assertEqual(strcmp(actual, expect), 0);
+
+    // Nothing is written until requested again.
+    monitor.receive(cb.impl);
+    assertEqual(strlen(actual), strlen(expect));
+}
+
+#endif  // __R51_TESTS_TEST_MEMORY__
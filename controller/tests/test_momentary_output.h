@@ -6,6 +6,7 @@
 
 #include "mock_clock.h"
 #include "mock_gpio.h"
+#include "mock_pulse.h"
 #include "src/momentary_output.h"
 
 using namespace aunit;
@@ -13,9 +14,11 @@ using namespace aunit;
 
 test(MomentaryOutputTest, TriggerHigh) {
     MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
     MockGPIO gpio;
 
-    MomentaryOutput output(16, 100, &clock, &gpio);
+    MomentaryOutput output(16, 100, &timers, &gpio);
     assertEqual(gpio.pinMode(16), (uint32_t)OUTPUT);
     assertEqual(gpio.digitalRead(16), LOW);
 
@@ -42,9 +45,11 @@ test(MomentaryOutputTest, TriggerHigh) {
 
 test(MomentaryOutputTest, TriggerLow) {
     MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
     MockGPIO gpio;
 
-    MomentaryOutput output(16, 100, -1, false, &clock, &gpio);
+    MomentaryOutput output(16, 100, -1, false, &timers, &gpio);
     assertEqual(gpio.pinMode(16), (uint32_t)OUTPUT);
     assertEqual(gpio.digitalRead(16), HIGH);
 
@@ -71,9 +76,11 @@ test(MomentaryOutputTest, TriggerLow) {
 
 test(MomentaryOutputTest, ShortCooldown) {
     MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
     MockGPIO gpio;
 
-    MomentaryOutput output(16, 200, 10, true, &clock, &gpio);
+    MomentaryOutput output(16, 200, 10, true, &timers, &gpio);
     assertEqual(gpio.pinMode(16), (uint32_t)OUTPUT);
     assertEqual(gpio.digitalRead(16), LOW);
 
@@ -98,4 +105,58 @@ test(MomentaryOutputTest, ShortCooldown) {
     assertEqual(gpio.digitalRead(16), HIGH);
 }
 
+test(MomentaryOutputTest, HardwarePulse) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockGPIO gpio;
+    MockPulse pulse(16);
+
+    MomentaryOutput output(16, 100, -1, false, &timers, &gpio, &pulse);
+    assertTrue(output.begin());
+    assertFalse(pulse.high());
+    assertEqual(gpio.digitalRead(16), HIGH);
+
+    assertTrue(output.trigger());
+    assertEqual(pulse.count(), 1u);
+    assertEqual(pulse.width(), 100000u);
+    assertEqual(gpio.digitalRead(16), HIGH);
+
+    // pulse is ended by hardware
+    clock.delay(100);
+    pulse.finish();
+    output.update();
+    assertEqual(gpio.digitalRead(16), HIGH);
+    assertFalse(output.trigger());
+
+    clock.delay(99);
+    output.update();
+    assertFalse(output.trigger());
+
+    clock.delay(1);
+    output.update();
+    assertTrue(output.trigger());
+    assertEqual(pulse.count(), 2u);
+    assertEqual(gpio.digitalRead(16), HIGH);
+}
+
+test(MomentaryOutputTest, HardwarePulseUnsupported) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockGPIO gpio;
+    MockPulse pulse(17);
+
+    MomentaryOutput output(16, 100, &timers, &gpio, &pulse);
+    assertFalse(output.begin());
+
+    assertTrue(output.trigger());
+    assertEqual(pulse.count(), 0u);
+    assertEqual(gpio.digitalRead(16), HIGH);
+
+    clock.delay(100);
+    output.update();
+    assertEqual(gpio.digitalRead(16), LOW);
+}
+
 #endif  // __R51_TESTS_TEST_MOMENTARY_OUTPUT__
@@ -0,0 +1,142 @@
+#ifndef __R51_TESTS_TEST_PROFILER__
+#define __R51_TESTS_TEST_PROFILER__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_broadcast.h"
+#include "mock_clock.h"
+#include "mock_cycles.h"
+#include "mock_stream.h"
+#include "src/bus.h"
+#include "src/profiler.h"
+
+using namespace aunit;
+
+
+// A node which takes a fixed number of cycles to receive and send frames.
+class ProfilerWorkNode : public Node {
+    public:
+        ProfilerWorkNode(MockCycleCounter* counter, uint32_t receive_cycles,
+                uint32_t send_cycles) :
+            counter_(counter), receive_cycles_(receive_cycles),
+            send_cycles_(send_cycles), broadcast_id_(0), filter_id_(0) {}
+
+        MockCycleCounter* counter_;
+        uint32_t receive_cycles_;
+        uint32_t send_cycles_;
+        uint32_t broadcast_id_;
+        uint32_t filter_id_;
+
+        void receive(const Broadcast& broadcast) override {
+            counter_->advance(receive_cycles_);
+            if (broadcast_id_ != 0) {
+                Frame frame;
+                initFrame(&frame, broadcast_id_, 8);
+                broadcast(frame);
+            }
+        }
+
+        void send(const Frame&) override {
+            counter_->advance(send_cycles_);
+        }
+
+        bool filter(uint32_t id) const override {
+            return filter_id_ != 0 && id == filter_id_;
+        }
+};
+
+test(ProfilerTest, Bucket) {
+    assertEqual(ProfileStats::bucket(0), 0);
+    assertEqual(ProfileStats::bucket(63), 0);
+    assertEqual(ProfileStats::bucket(64), 1);
+    assertEqual(ProfileStats::bucket(127), 1);
+    assertEqual(ProfileStats::bucket(128), 2);
+    assertEqual(ProfileStats::bucket(0xFFFFFFFF), 15);
+}
+
+test(ProfilerTest, Overhead) {
+    MockCycleCounter counter(7);
+    Profiler profiler(&counter);
+    profiler.begin(nullptr);
+    assertEqual(profiler.overhead(), (uint32_t)7);
+}
+
+test(ProfilerTest, Stats) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    MockCycleCounter counter;
+    Profiler profiler(&counter);
+    profiler.begin(nullptr);
+
+    ProfilerWorkNode sender(&counter, 300, 0);
+    sender.broadcast_id_ = 0x100;
+    ProfilerWorkNode receiver(&counter, 40, 200);
+    receiver.filter_id_ = 0x100;
+
+    Node* nodes[] = {&sender, &receiver, &profiler};
+    Bus bus(nodes, 3, &timers, &profiler);
+    for (int i = 0; i < 3; i++) {
+        bus.loop();
+    }
+    receiver.send_cycles_ = 500;
+    bus.loop();
+
+    assertEqual(profiler.loopStats().count, (uint32_t)4);
+    assertEqual(profiler.loopStats().min, (uint32_t)540);
+    assertEqual(profiler.loopStats().max, (uint32_t)840);
+
+    // The send to the receiver is excluded from the sender's receive.
+    const ProfileStats* stats = profiler.receiveStats(0);
+    assertEqual(stats->count, (uint32_t)4);
+    assertEqual(stats->min, (uint32_t)300);
+    assertEqual(stats->max, (uint32_t)300);
+    assertEqual(stats->histogram[ProfileStats::bucket(300)], 4);
+
+    stats = profiler.receiveStats(1);
+    assertEqual(stats->avg(), (uint32_t)40);
+    stats = profiler.sendStats(0);
+    assertEqual(stats->count, (uint32_t)0);
+    stats = profiler.sendStats(1);
+    assertEqual(stats->count, (uint32_t)4);
+    assertEqual(stats->avg(), (uint32_t)275);
+
+    stats = profiler.idStats(0x100);
+    assertTrue(stats != nullptr);
+    assertEqual(stats->min, (uint32_t)200);
+    assertEqual(stats->max, (uint32_t)500);
+    assertTrue(profiler.idStats(0x200) == nullptr);
+}
+
+test(ProfilerTest, DumpAndReset) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    MockCycleCounter counter;
+    Profiler profiler(&counter);
+
+    char actual[512];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set((byte*)actual, sizeof(actual) - 1);
+    profiler.begin(&stream);
+
+    ProfilerWorkNode sender(&counter, 300, 0);
+    Node* nodes[] = {&sender, &profiler};
+    Bus bus(nodes, 2, &timers, &profiler);
+    bus.loop();
+
+    Frame control = {0x5F03, 8, {0x03}};
+    assertTrue(profiler.filter(control.id));
+    MockBroadcast cb;
+    profiler.send(control);
+    profiler.receive(cb.impl);
+    assertTrue(strstr(actual, "profile: node 0 receive count 1 min 300 avg 300 max 300") != nullptr);
+    assertEqual(profiler.receiveStats(0)->count, (uint32_t)0);
+
+    // Nothing is written until requested again.
+    size_t len = strlen(actual);
+    profiler.receive(cb.impl);
+    assertEqual(strlen(actual), len);
+}
+
+#endif  // __R51_TESTS_TEST_PROFILER__
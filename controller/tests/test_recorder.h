@@ -0,0 +1,126 @@
+#ifndef __R51_TESTS_TEST_RECORDER__
+#define __R51_TESTS_TEST_RECORDER__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_broadcast.h"
+#include "mock_clock.h"
+#include "mock_stream.h"
+#include "src/bus.h"
+#include "src/recorder.h"
+
+using namespace aunit;
+
+
+test(RecorderTest, Dump) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    RecorderLog log;
+    memset(&log, 0, sizeof(log));
+    Recorder recorder(&log, &timers);
+
+    char actual[256];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set((byte*)actual, sizeof(actual) - 1);
+    recorder.begin(&stream);
+    assertEqual(recorder.count(), (uint32_t)0);
+
+    clock.set(1234);
+    timers.update();
+    Frame frame = {0x123, 3, {0xDE, 0xAD, 0x01}};
+    recorder.broadcast(2, frame);
+    clock.delayMicros(10);
+    timers.update();
+    frame = {0x5F00, 16, {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09}};
+    recorder.broadcast(7, frame);
+    assertEqual(recorder.count(), (uint32_t)2);
+
+    MockBroadcast cb;
+    Frame control = {0x5F04, 8, {0x01}};
+    assertTrue(recorder.filter(control.id));
+    recorder.send(control);
+    recorder.receive(cb.impl);
+
+    const char expect[] =
+        "(0000000001.234000) node2 123#DEAD01\r\n"
+        "(0000000001.234010) node7 00005F00#0102030405060708\r\n";
+    assertEqual(strcmp(actual, expect), 0);
+    assertEqual(recorder.count(), (uint32_t)2);
+
+    // Nothing is written until requested again.
+    recorder.receive(cb.impl);
+    assertEqual(strlen(actual), strlen(expect));
+}
+
+test(RecorderTest, Wrap) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    RecorderLog log;
+    memset(&log, 0, sizeof(log));
+    Recorder recorder(&log, &timers);
+    recorder.begin();
+
+    Frame frame = {0, 1, {}};
+    for (uint32_t i = 1; i <= RECORDER_SIZE + 2; i++) {
+        frame.id = i;
+        frame.data[0] = i;
+        recorder.broadcast(0, frame);
+    }
+    assertEqual(recorder.count(), (uint32_t)RECORDER_SIZE);
+
+    // The oldest frames are overwritten.
+    char actual[4096];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set((byte*)actual, sizeof(actual) - 1);
+    recorder.dump(&stream);
+    assertEqual(strncmp(actual, "(0000000000.000000) node0 003#03\r\n", 34), 0);
+    assertTrue(strstr(actual, "node0 002#") == nullptr);
+}
+
+test(RecorderTest, Clear) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    RecorderLog log;
+    memset(&log, 0, sizeof(log));
+    Recorder recorder(&log, &timers);
+    recorder.begin();
+
+    Frame frame = {0x123, 0, {}};
+    recorder.broadcast(0, frame);
+    assertEqual(recorder.count(), (uint32_t)1);
+
+    MockBroadcast cb;
+    Frame control = {0x5F04, 8, {0x02}};
+    recorder.send(control);
+    recorder.receive(cb.impl);
+    assertEqual(recorder.count(), (uint32_t)0);
+}
+
+test(RecorderTest, Recover) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    RecorderLog log;
+    memset(&log, 0xA5, sizeof(log));
+
+    // A log with random contents is cleared.
+    Recorder before(&log, &timers);
+    before.begin();
+    assertEqual(before.count(), (uint32_t)0);
+    assertEqual(before.recovered(), (uint32_t)0);
+
+    Frame frame = {0x123, 0, {}};
+    before.broadcast(0, frame);
+    before.broadcast(0, frame);
+
+    // A valid log survives a reset.
+    Recorder after(&log, &timers);
+    after.begin();
+    assertEqual(after.recovered(), (uint32_t)2);
+    after.broadcast(0, frame);
+    assertEqual(after.count(), (uint32_t)3);
+}
+
+#endif  // __R51_TESTS_TEST_RECORDER__
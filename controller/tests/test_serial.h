@@ -0,0 +1,227 @@
+#ifndef __R51_TESTS_TEST_SERIAL__
+#define __R51_TESTS_TEST_SERIAL__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_broadcast.h"
+#include "mock_clock.h"
+#include "mock_stream.h"
+#include "src/bus.h"
+#include "src/cycles.h"
+#include "src/serial.h"
+
+using namespace aunit;
+
+
+// Return true if sending the frame writes the expected text in one write.
+bool checkSerialTextSend(const Frame& frame, const char* expect) {
+    char actual[256];
+    memset(actual, 0, sizeof(actual));
+    FakeStream stream;
+    stream.set((byte*)actual, sizeof(actual) - 1);
+    SerialText serial;
+    serial.begin(&stream);
+    serial.send(frame);
+    if (strcmp(actual, expect) != 0 || stream.writes() != 1) {
+        Serial.print("serial text not equal:\n  actual: ");
+        Serial.print(actual);
+        Serial.print("  expect: ");
+        Serial.print(expect);
+        Serial.print("  writes: ");
+        Serial.println(stream.writes());
+        return false;
+    }
+    return true;
+}
+
+// Return the frames broadcast after receiving the text.
+int serialTextReceive(const char* text, MockBroadcast* cb) {
+    FakeStream stream;
+    stream.setRead((byte*)text, strlen(text));
+    SerialText serial;
+    serial.begin(&stream);
+    while (stream.available()) {
+        serial.receive(cb->impl);
+    }
+    return cb->count();
+}
+
+test(SerialTextTest, Send) {
+    Frame frame = {0x540, 8, {0x60, 0x80, 0x00, 0x0F, 0xA0, 0x01, 0xFF, 0x10}};
+    assertTrue(checkSerialTextSend(frame, "540#60:80:00:0F:A0:01:FF:10\r\n"));
+
+    frame = {0x0, 0, {}};
+    assertTrue(checkSerialTextSend(frame, "0#\r\n"));
+
+    frame = {0x12345678, 1, {0x0A}};
+    assertTrue(checkSerialTextSend(frame, "12345678#0A\r\n"));
+
+    frame = {0x5F00, 16, {}};
+    assertTrue(checkSerialTextSend(frame,
+        "5F00#00:00:00:00:00:00:00:00:00:00:00:00:00:00:00:00\r\n"));
+}
+
+test(SerialTextTest, Receive) {
+    MockBroadcast cb(4);
+    assertEqual(serialTextReceive("540#60:80:0F:a0\n5400#0102030405060708\r5#\n", &cb), 3);
+    Frame expect = {0x540, 4, {0x60, 0x80, 0x0F, 0xA0}};
+    assertTrue(frameEquals(cb.frames()[0], expect));
+    expect = {0x5400, 8, {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08}};
+    assertTrue(frameEquals(cb.frames()[1], expect));
+    expect = {0x5, 0, {}};
+    assertTrue(frameEquals(cb.frames()[2], expect));
+}
+
+test(SerialTextTest, ReceiveInvalid) {
+    MockBroadcast cb(4);
+    assertEqual(serialTextReceive("0#00\n123456789#00\n540#0\n540\n#00\n", &cb), 0);
+
+    // Lines which overflow the buffer are dropped.
+    assertEqual(serialTextReceive("540#00112233445566778899AABBCCDDEEFF\n540#00\n", &cb), 1);
+    Frame expect = {0x540, 1, {0x00}};
+    assertTrue(frameEquals(cb.frames()[0], expect));
+}
+
+test(SerialTextTest, Filter) {
+    IdFilter filter;
+    assertTrue(filter.match(0x540));
+
+    // Only allowed IDs match.
+    assertTrue(filter.allow(0x54B));
+    assertTrue(filter.allow(0x5400));
+    assertTrue(filter.match(0x54B));
+    assertTrue(filter.match(0x5400));
+    assertFalse(filter.match(0x540));
+
+    // Deny rules take precedence.
+    assertTrue(filter.allow(0x5F00, 0xFF00));
+    assertTrue(filter.match(0x5F01));
+    assertTrue(filter.deny(0x5F02));
+    assertFalse(filter.match(0x5F02));
+    assertTrue(filter.match(0x5F10));
+
+    filter.clear();
+    assertTrue(filter.match(0x540));
+    assertTrue(filter.deny(0x540, 0xFFFFFFFE));
+    assertFalse(filter.match(0x541));
+    assertTrue(filter.match(0x542));
+
+    for (uint8_t i = filter.count(); i < SERIAL_FILTER_RULES; i++) {
+        assertTrue(filter.deny(i));
+    }
+    assertFalse(filter.deny(0x100));
+}
+
+test(SerialTextTest, FilterRate) {
+    IdFilter filter;
+    filter.allow(0x540, 0xFFFFFFFE, 100);
+    filter.allow(0x5400);
+    assertTrue(filter.pass(0x540, 1000));
+    assertTrue(filter.pass(0x541, 1000));
+    assertFalse(filter.pass(0x540, 1099));
+    assertTrue(filter.pass(0x540, 1100));
+    assertTrue(filter.pass(0x5400, 1100));
+    assertTrue(filter.pass(0x5400, 1101));
+    assertFalse(filter.pass(0x5401, 1101));
+}
+
+test(SerialTextTest, FilterCommands) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    char actual[256];
+    memset(actual, 0, sizeof(actual));
+    FakeStream stream;
+    stream.set((byte*)actual, sizeof(actual) - 1);
+    const char commands[] = "+54B\n+5400/FF00@200\n-5401\n+\n-540@10\n+12345678Z\n?\n";
+    stream.setRead((byte*)commands, sizeof(commands) - 1);
+
+    SerialText serial(&timers);
+    serial.begin(&stream);
+    MockBroadcast cb;
+    while (stream.available()) {
+        serial.receive(cb.impl);
+    }
+    assertEqual(cb.count(), 0);
+    assertEqual(serial.idFilter()->count(), 3);
+    assertEqual(strcmp(actual,
+        "filter: allow 54B/FFFFFFFF\r\n"
+        "filter: allow 5400/FF00 every 200ms\r\n"
+        "filter: deny 5401/FFFFFFFF\r\n"), 0);
+
+    assertTrue(serial.filter(0x54B));
+    assertTrue(serial.filter(0x5402));
+    assertFalse(serial.filter(0x5401));
+    assertFalse(serial.filter(0x540));
+
+    // Rate limited frames are dropped.
+    memset(actual, 0, sizeof(actual));
+    stream.set((byte*)actual, sizeof(actual) - 1);
+    Frame frame = {0x5400, 0, {}};
+    serial.send(frame);
+    serial.send(frame);
+    assertEqual(strcmp(actual, "5400#\r\n"), 0);
+
+    const char clear[] = "!\n";
+    stream.setRead((byte*)clear, sizeof(clear) - 1);
+    serial.receive(cb.impl);
+    assertEqual(serial.idFilter()->count(), 0);
+    assertTrue(serial.filter(0x540));
+}
+
+test(SerialTextTest, Text) {
+    byte actual[32];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set(actual, sizeof(actual));
+    SerialText serial;
+
+    // discarded before begin
+    serial.text()->print("lost\r\n");
+    serial.begin(&stream);
+
+    serial.text()->print("memory: ");
+    serial.text()->print(12);
+    assertEqual(stream.writes(), 0);
+    serial.text()->println();
+    assertEqual(stream.writes(), 1);
+    assertEqual(memcmp(actual, "memory: 12\r\n", 12), 0);
+}
+
+// Report the cost of encoding and decoding frames. Does not assert timing.
+test(SerialTextTest, Benchmark) {
+    static const int kIterations = 1000;
+    CycleCounter* counter = CycleCounter::real();
+    Frame frame = {0x540, 8, {0x60, 0x80, 0x00, 0x0F, 0xA0, 0x01, 0xFF, 0x10}};
+
+    char buffer[64];
+    FakeStream stream;
+    SerialText serial;
+    serial.begin(&stream);
+    uint32_t start = counter->read();
+    for (int i = 0; i < kIterations; i++) {
+        stream.set((byte*)buffer, sizeof(buffer));
+        serial.send(frame);
+    }
+    uint32_t send = counter->read() - start;
+
+    const char text[] = "540#60:80:00:0F:A0:01:FF:10\n";
+    MockBroadcast cb(1);
+    start = counter->read();
+    for (int i = 0; i < kIterations; i++) {
+        cb.reset();
+        stream.setRead((byte*)text, sizeof(text) - 1);
+        serial.receive(cb.impl);
+    }
+    uint32_t receive = counter->read() - start;
+    assertEqual(cb.count(), 1);
+
+    Serial.print("serial: counts per frame at ");
+    Serial.print(counter->frequency());
+    Serial.print("Hz: send ");
+    Serial.print(send / kIterations);
+    Serial.print(" receive ");
+    Serial.println(receive / kIterations);
+}
+
+#endif  // __R51_TESTS_TEST_SERIAL__
@@ -15,10 +15,11 @@ using namespace aunit;
 
 class SettingsTest : public TestOnce {
     public:
-        SettingsTest() : TestOnce(), clock() {}
+        SettingsTest() : TestOnce(), clock(), timers(&clock) {}
 
         void setup() override {
             TestOnce::setup();
+            clock.attach(&timers);
             clock.set(0);
         }
 
@@ -174,6 +175,18 @@ class SettingsTest : public TestOnce {
                     nullptr, nullptr, nullptr, &state_71F_05);
         }
 
+        // Receive a single request frame from settings, check it, and respond.
+        bool checkExchange(Settings* settings, const Frame& request, const Frame& response) {
+            MockBroadcast cast(1, request.id);
+            settings->receive(cast.impl);
+            if (!checkFrameCount(cast, 1) ||
+                !checkFrameEquals(cast.frames()[0], request)) {
+                return false;
+            }
+            settings->send(response);
+            return true;
+        }
+
         bool checkNoop(Settings* settings, const Frame& control) {
             MockBroadcast cast(1, 0x700, 0xFFFFFF00);
             settings->send(control);
@@ -181,11 +194,12 @@ class SettingsTest : public TestOnce {
         }
 
         MockClock clock;
+        TimerWheel timers;
 };
 
 testF(SettingsTest, Init) {
     MockBroadcast cast(2, 0x700, 0xFFFFFF00);
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     Frame frameE;
     Frame frameF;
@@ -258,7 +272,7 @@ testF(SettingsTest, Init) {
 
 testF(SettingsTest, Retrieve) {
     MockBroadcast cast(3);
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     Frame frameE;
     Frame frameF;
@@ -327,9 +341,21 @@ testF(SettingsTest, Retrieve) {
     settings.send(frameE);
 }
 
+testF(SettingsTest, NoStateBeforeRetrieve) {
+    MockBroadcast cast(1, SETTINGS_STATE_FRAME_ID);
+    Settings settings(&timers);
+
+    settings.receive(cast.impl);
+    assertTrue(checkFrameCount(cast, 0));
+
+    clock.delay(SETTINGS_STATE_FRAME_HB);
+    settings.receive(cast.impl);
+    assertTrue(checkFrameCount(cast, 0));
+}
+
 testF(SettingsTest, ResetToDefault) {
     MockBroadcast cast(3);
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     Frame frameE;
     Frame frameF;
@@ -413,7 +439,7 @@ testF(SettingsTest, ResetToDefault) {
 }
 
 testF(SettingsTest, ToggleAutoInteriorIllumination) {
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     // Initial state.
     Frame control = {0x5701, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
@@ -438,7 +464,7 @@ testF(SettingsTest, ToggleAutoInteriorIllumination) {
 }
 
 testF(SettingsTest, ToggleSlideDriverSeat) {
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     // Initial state.
     Frame control = {0x5701, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
@@ -461,7 +487,7 @@ testF(SettingsTest, ToggleSlideDriverSeat) {
 }
 
 testF(SettingsTest, ToggleSpeedSendingWipers) {
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     // Initial state.
     Frame control = {0x5701, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
@@ -486,7 +512,7 @@ testF(SettingsTest, ToggleSpeedSendingWipers) {
 }
 
 testF(SettingsTest, AutoHeadlighSensitivity) {
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     // Initial state.
     Frame control = {0x5701, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
@@ -539,7 +565,7 @@ void setAutoHeadlightDelayState(Frame* state21, byte value) {
 }
 
 testF(SettingsTest, AutoHeadlightOffDelay) {
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     // Initial state.
     byte value = 0x00;
@@ -642,7 +668,7 @@ testF(SettingsTest, AutoHeadlightOffDelay) {
 }
 
 testF(SettingsTest, ToggleSelectiveDoorUnlock) {
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     // Initial state.
     Frame control = {0x5701, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
@@ -671,7 +697,7 @@ void setAutoReLockTime(Frame* state21, byte value) {
 }
 
 testF(SettingsTest, AutoReLockTime) {
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     // Initial state.
     byte value = 0x00;
@@ -714,7 +740,7 @@ testF(SettingsTest, AutoReLockTime) {
 }
 
 testF(SettingsTest, RemoteKeyResponseHorn) {
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     // Initial state.
     Frame control = {0x5701, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
@@ -743,7 +769,7 @@ void setRemoteKeyResponseLights(Frame* state21, byte value) {
 }
 
 testF(SettingsTest, RemoteKeyResponseLights) {
-    Settings settings(&clock);
+    Settings settings(&timers);
 
     // Initial state.
     byte value = 0x00;
@@ -797,4 +823,424 @@ testF(SettingsTest, RemoteKeyResponseLights) {
     assertTrue(checkNoop(&settings, control));
 }
 
+testF(SettingsTest, BatchUpdates) {
+    Settings settings(&timers);
+    Frame request, response;
+    Frame control = {0x5701, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
+    Frame state10 = {0x72E, 8, {0x10, 0x11, 0x61, 0x01, 0x20, 0x1E, 0x24, 0x08}};
+    Frame state21 = {0x72E, 8, {0x21, 0x10, 0x00, 0x40, 0x40, 0x01, 0x64, 0x00}};
+    Frame state22 = {0x72E, 8, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}};
+
+    // Change three settings before the next loop.
+    toggleBit(control.data, 0, 0);
+    settings.send(control);
+    toggleBit(control.data, 1, 0);
+    settings.send(control);
+    toggleBit(control.data, 3, 0);
+    settings.send(control);
+
+    // All three updates are sent in a single session. This takes 7 round
+    // trips instead of 15 when each update uses its own session.
+    fillEnterRequest(&request, 0x71E);
+    fillEnterResponse(&response, 0x72E);
+    assertTrue(checkExchange(&settings, request, response));
+    fillUpdateRequest(&request, 0x71E, 0x10, 0x01);
+    fillUpdateResponse(&response, 0x72E, 0x10);
+    assertTrue(checkExchange(&settings, request, response));
+    fillUpdateRequest(&request, 0x71E, 0x37, 0x00);
+    fillUpdateResponse(&response, 0x72E, 0x37);
+    assertTrue(checkExchange(&settings, request, response));
+    fillUpdateRequest(&request, 0x71E, 0x2A, 0x01);
+    fillUpdateResponse(&response, 0x72E, 0x2A);
+    assertTrue(checkExchange(&settings, request, response));
+    fillState0221Request(&request, 0x71E);
+    assertTrue(checkExchange(&settings, request, state10));
+    fillState3000Request(&request, 0x71E);
+    assertTrue(checkExchange(&settings, request, state21));
+    settings.send(state22);
+    fillExitRequest(&request, 0x71E);
+    fillExitResponse(&response, 0x72E);
+    assertTrue(checkExchange(&settings, request, response));
+
+    // Session is complete.
+    MockBroadcast cast(1, 0x71E);
+    settings.receive(cast.impl);
+    assertTrue(checkFrameCount(cast, 0));
+}
+
+testF(SettingsTest, QueueDuringSession) {
+    Settings settings(&timers);
+    Frame request, response;
+    Frame control = {0x5701, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
+    Frame state10 = {0x72E, 8, {0x10, 0x11, 0x61, 0x01, 0x20, 0x1E, 0x24, 0x00}};
+    Frame state21 = {0x72E, 8, {0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00}};
+    Frame state22 = {0x72E, 8, {0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF}};
+
+    // Start a session.
+    toggleBit(control.data, 0, 0);
+    settings.send(control);
+    fillEnterRequest(&request, 0x71E);
+    fillEnterResponse(&response, 0x72E);
+    assertTrue(checkExchange(&settings, request, response));
+
+    // Change another setting while the session is running.
+    toggleBit(control.data, 3, 0);
+    settings.send(control);
+
+    // The running session is unchanged.
+    fillUpdateRequest(&request, 0x71E, 0x10, 0x01);
+    fillUpdateResponse(&response, 0x72E, 0x10);
+    assertTrue(checkExchange(&settings, request, response));
+    fillState0221Request(&request, 0x71E);
+    assertTrue(checkExchange(&settings, request, state10));
+    fillState3000Request(&request, 0x71E);
+    assertTrue(checkExchange(&settings, request, state21));
+    settings.send(state22);
+    fillExitRequest(&request, 0x71E);
+    fillExitResponse(&response, 0x72E);
+    assertTrue(checkExchange(&settings, request, response));
+
+    // The queued change is sent in the next session.
+    fillEnterRequest(&request, 0x71E);
+    fillEnterResponse(&response, 0x72E);
+    assertTrue(checkExchange(&settings, request, response));
+    fillUpdateRequest(&request, 0x71E, 0x2A, 0x01);
+    fillUpdateResponse(&response, 0x72E, 0x2A);
+    assertTrue(checkExchange(&settings, request, response));
+}
+
+// A request frame and the BCM response. A request ID of zero indicates no
+// request is expected before the response.
+struct SettingsExchange {
+    Frame request;
+    Frame response;
+};
+
+#define REQ_E(...) {0x71E, 8, {__VA_ARGS__}}
+#define RESP_E(...) {0x72E, 8, {__VA_ARGS__}}
+#define REQ_F(...) {0x71F, 8, {__VA_ARGS__}}
+#define RESP_F(...) {0x72F, 8, {__VA_ARGS__}}
+#define NO_REQ {0, 0, {}}
+
+#define EXCHANGE_ENTER_E {REQ_E(0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)}
+#define EXCHANGE_EXIT_E {REQ_E(0x02, 0x10, 0x81, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x02, 0x50, 0x81, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)}
+#define EXCHANGE_STATE_E \
+    {REQ_E(0x02, 0x21, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x10, 0x11, 0x61, 0x01, 0x00, 0x1E, 0x24, 0x00)},\
+    {REQ_E(0x30, 0x00, 0x0A, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x21, 0x10, 0x0C, 0x40, 0x40, 0x01, 0x64, 0x00)},\
+    {NO_REQ, RESP_E(0x22, 0x94, 0x00, 0x00, 0x47, 0xFF, 0xFF, 0xFF)}
+#define EXCHANGE_ENTER_F {REQ_F(0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_F(0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)}
+#define EXCHANGE_EXIT_F {REQ_F(0x02, 0x10, 0x81, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_F(0x02, 0x50, 0x81, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)}
+#define EXCHANGE_STATE_F \
+    {REQ_F(0x02, 0x21, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_F(0x05, 0x61, 0x01, 0x00, 0x00, 0x00, 0xFF, 0xFF)}
+
+class SettingsSequenceTest : public TestOnce {
+    public:
+        SettingsSequenceTest() : TestOnce(), clock(), timers(&clock) {}
+
+        void setup() override {
+            TestOnce::setup();
+            clock.attach(&timers);
+        }
+
+        // Replay a series of exchanges against a sequence. Check that the
+        // sequence is complete after the last exchange.
+        bool checkExchanges(SettingsSequence* sequence, const SettingsExchange* exchanges, uint8_t count) {
+            Frame frame;
+            for (uint8_t i = 0; i < count; i++) {
+                const SettingsExchange& exchange = exchanges[i];
+                bool sent = sequence->receive(&frame);
+                if (exchange.request.id == 0) {
+                    if (sent) {
+                        Serial.print("unexpected request at exchange ");
+                        Serial.println(i);
+                        return false;
+                    }
+                } else if (!sent) {
+                    Serial.print("missing request at exchange ");
+                    Serial.println(i);
+                    return false;
+                } else if (!checkFrameEquals(frame, exchange.request)) {
+                    return false;
+                }
+                sequence->send(exchange.response);
+            }
+            if (!sequence->ready()) {
+                Serial.println("sequence not complete");
+                return false;
+            }
+            return !sequence->receive(&frame);
+        }
+
+        MockClock clock;
+        TimerWheel timers;
+};
+
+testF(SettingsSequenceTest, InitE) {
+    SettingsExchange exchanges[] = {
+        EXCHANGE_ENTER_E,
+        {REQ_E(0x02, 0x3B, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x06, 0x7B, 0x00, 0x60, 0x01, 0x0E, 0x07, 0xFF)},
+        {REQ_E(0x02, 0x3B, 0x20, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x06, 0x7B, 0x20, 0xC2, 0x6F, 0x73, 0xD3, 0xFF)},
+        {REQ_E(0x02, 0x3B, 0x40, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x06, 0x7B, 0x40, 0xC2, 0xA1, 0x90, 0x01, 0xFF)},
+        {REQ_E(0x02, 0x3B, 0x60, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x06, 0x7B, 0x60, 0x00, 0xFF, 0xF1, 0x70, 0xFF)},
+        EXCHANGE_EXIT_E,
+    };
+    SettingsSequence sequence(SETTINGS_FRAME_E, &timers);
+    assertTrue(sequence.trigger(kSettingsInitE));
+    assertFalse(sequence.trigger(kSettingsInitE));
+    assertTrue(checkExchanges(&sequence, exchanges, sizeof(exchanges)/sizeof(exchanges[0])));
+    assertEqual(sequence.roundTrips(), 6);
+}
+
+testF(SettingsSequenceTest, InitF) {
+    SettingsExchange exchanges[] = {
+        EXCHANGE_ENTER_F,
+        {REQ_F(0x02, 0x3B, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), RESP_F(0x06, 0x7B, 0x00, 0x60, 0x01, 0x0E, 0x07, 0xFF)},
+        EXCHANGE_EXIT_F,
+    };
+    SettingsSequence sequence(SETTINGS_FRAME_F, &timers);
+    assertTrue(sequence.trigger(kSettingsInitF));
+    assertTrue(checkExchanges(&sequence, exchanges, sizeof(exchanges)/sizeof(exchanges[0])));
+}
+
+testF(SettingsSequenceTest, RetrieveE) {
+    SettingsExchange exchanges[] = {
+        EXCHANGE_ENTER_E,
+        EXCHANGE_STATE_E,
+        EXCHANGE_EXIT_E,
+    };
+    SettingsSequence sequence(SETTINGS_FRAME_E, &timers);
+    assertTrue(sequence.trigger(kSettingsRetrieve));
+    assertTrue(checkExchanges(&sequence, exchanges, sizeof(exchanges)/sizeof(exchanges[0])));
+    assertEqual(sequence.roundTrips(), 4);
+}
+
+testF(SettingsSequenceTest, RetrieveF) {
+    SettingsExchange exchanges[] = {
+        EXCHANGE_ENTER_F,
+        EXCHANGE_STATE_F,
+        EXCHANGE_EXIT_F,
+    };
+    SettingsSequence sequence(SETTINGS_FRAME_F, &timers);
+    assertTrue(sequence.trigger(kSettingsRetrieve));
+    assertTrue(checkExchanges(&sequence, exchanges, sizeof(exchanges)/sizeof(exchanges[0])));
+}
+
+testF(SettingsSequenceTest, UpdateE) {
+    SettingsExchange exchanges[] = {
+        EXCHANGE_ENTER_E,
+        {REQ_E(0x03, 0x3B, 0x10, 0x01, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x02, 0x7B, 0x10, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)},
+        {REQ_E(0x03, 0x3B, 0x37, 0x02, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x02, 0x7B, 0x37, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)},
+        {REQ_E(0x03, 0x3B, 0x39, 0x05, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x02, 0x7B, 0x39, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)},
+        {REQ_E(0x03, 0x3B, 0x47, 0x00, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x02, 0x7B, 0x47, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)},
+        {REQ_E(0x03, 0x3B, 0x2A, 0x01, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x02, 0x7B, 0x2A, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)},
+        {REQ_E(0x03, 0x3B, 0x2E, 0x03, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x02, 0x7B, 0x2E, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)},
+        {REQ_E(0x03, 0x3B, 0x2F, 0x02, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x02, 0x7B, 0x2F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)},
+        {REQ_E(0x03, 0x3B, 0x02, 0x01, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x02, 0x7B, 0x02, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)},
+        EXCHANGE_STATE_E,
+        EXCHANGE_EXIT_E,
+    };
+    SettingsSequence sequence(SETTINGS_FRAME_E, &timers);
+    assertTrue(sequence.queue(0x10, 0x00));
+    assertTrue(sequence.queue(0x37, 0x02));
+    assertTrue(sequence.queue(0x39, 0x05));
+    assertTrue(sequence.queue(0x47, 0x00));
+    assertTrue(sequence.queue(0x2A, 0x01));
+    assertTrue(sequence.queue(0x2E, 0x03));
+    assertTrue(sequence.queue(0x2F, 0x02));
+    assertTrue(sequence.queue(0x02, 0x01));
+    // Replaces the queued value.
+    assertTrue(sequence.queue(0x10, 0x01));
+    assertTrue(sequence.pending());
+    assertTrue(sequence.trigger(kSettingsUpdate));
+    assertTrue(checkExchanges(&sequence, exchanges, sizeof(exchanges)/sizeof(exchanges[0])));
+    assertFalse(sequence.pending());
+    assertEqual(sequence.roundTrips(), 12);
+}
+
+testF(SettingsSequenceTest, UpdateF) {
+    SettingsExchange exchanges[] = {
+        EXCHANGE_ENTER_F,
+        {REQ_F(0x03, 0x3B, 0x01, 0x01, 0xFF, 0xFF, 0xFF, 0xFF), RESP_F(0x02, 0x7B, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)},
+        EXCHANGE_STATE_F,
+        EXCHANGE_EXIT_F,
+    };
+    SettingsSequence sequence(SETTINGS_FRAME_F, &timers);
+    assertTrue(sequence.queue(0x01, 0x01));
+    assertTrue(sequence.trigger(kSettingsUpdate));
+    assertTrue(checkExchanges(&sequence, exchanges, sizeof(exchanges)/sizeof(exchanges[0])));
+}
+
+testF(SettingsSequenceTest, ResetE) {
+    SettingsExchange exchanges[] = {
+        EXCHANGE_ENTER_E,
+        {REQ_E(0x03, 0x3B, 0x1F, 0x00, 0xFF, 0xFF, 0xFF, 0xFF), RESP_E(0x02, 0x7B, 0x1F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)},
+        EXCHANGE_STATE_E,
+        EXCHANGE_EXIT_E,
+    };
+    SettingsSequence sequence(SETTINGS_FRAME_E, &timers);
+    assertTrue(sequence.trigger(kSettingsReset));
+    assertTrue(checkExchanges(&sequence, exchanges, sizeof(exchanges)/sizeof(exchanges[0])));
+}
+
+testF(SettingsSequenceTest, ResetF) {
+    SettingsExchange exchanges[] = {
+        EXCHANGE_ENTER_F,
+        {REQ_F(0x03, 0x3B, 0x1F, 0x00, 0xFF, 0xFF, 0xFF, 0xFF), RESP_F(0x02, 0x7B, 0x1F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)},
+        EXCHANGE_STATE_F,
+        EXCHANGE_EXIT_F,
+    };
+    SettingsSequence sequence(SETTINGS_FRAME_F, &timers);
+    assertTrue(sequence.trigger(kSettingsReset));
+    assertTrue(checkExchanges(&sequence, exchanges, sizeof(exchanges)/sizeof(exchanges[0])));
+}
+
+testF(SettingsSequenceTest, IgnoreMismatch) {
+    Frame frame;
+    Frame enter = REQ_E(0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+    Frame wrong = RESP_E(0x02, 0x50, 0x81, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+    Frame other = RESP_F(0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+    Frame right = RESP_E(0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+
+    SettingsSequence sequence(SETTINGS_FRAME_E, &timers);
+    assertTrue(sequence.trigger(kSettingsRetrieve));
+    assertTrue(sequence.receive(&frame));
+    assertTrue(checkFrameEquals(frame, enter));
+
+    // Unmatched responses do not advance the sequence.
+    sequence.send(wrong);
+    sequence.send(other);
+    assertFalse(sequence.receive(&frame));
+
+    // Matched response advances the sequence.
+    sequence.send(right);
+    assertTrue(sequence.receive(&frame));
+    assertEqual(frame.data[1], 0x21);
+}
+
+testF(SettingsSequenceTest, RetryRequest) {
+    Frame frame;
+    Frame enter = REQ_E(0x02, 0x10, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+    Frame enter_response = RESP_E(0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+    SettingsExchange exchanges[] = {
+        EXCHANGE_STATE_E,
+        EXCHANGE_EXIT_E,
+    };
+
+    SettingsSequence sequence(SETTINGS_FRAME_E, &timers);
+    assertTrue(sequence.trigger(kSettingsRetrieve));
+    assertTrue(sequence.receive(&frame));
+    assertTrue(checkFrameEquals(frame, enter));
+
+    // Request is resent after each missed deadline.
+    for (uint8_t i = 0; i < SETTINGS_RESPONSE_RETRIES; i++) {
+        clock.delay(SETTINGS_RESPONSE_TIMEOUT - 1);
+        assertFalse(sequence.receive(&frame));
+        clock.delay(1);
+        assertTrue(sequence.receive(&frame));
+        assertTrue(checkFrameEquals(frame, enter));
+    }
+
+    // Session continues normally once the BCM responds.
+    clock.delay(10);
+    sequence.send(enter_response);
+    assertTrue(checkExchanges(&sequence, exchanges, sizeof(exchanges)/sizeof(exchanges[0])));
+    assertFalse(sequence.failed());
+
+    const SettingsLatency& latency = sequence.latency(REQUEST_SESSION);
+    assertEqual(latency.retries, SETTINGS_RESPONSE_RETRIES);
+    assertEqual(latency.failures, 0);
+    assertEqual(latency.count, 2);
+    assertEqual(latency.min, 0);
+    assertEqual(latency.max, 10);
+    assertEqual(latency.total, (uint32_t)10);
+}
+
+testF(SettingsSequenceTest, RetryDoesNotResetSession) {
+    Frame frame;
+    SettingsExchange exchanges[] = {
+        EXCHANGE_ENTER_E,
+        EXCHANGE_STATE_E,
+        EXCHANGE_EXIT_E,
+    };
+
+    // Each frame arrives within the deadline even though the session as a
+    // whole and the segmented STATE response take longer than the response
+    // timeout.
+    SettingsSequence sequence(SETTINGS_FRAME_E, &timers);
+    assertTrue(sequence.trigger(kSettingsRetrieve));
+    for (uint8_t i = 0; i < sizeof(exchanges)/sizeof(exchanges[0]); i++) {
+        const SettingsExchange& exchange = exchanges[i];
+        if (exchange.request.id != 0) {
+            assertTrue(sequence.receive(&frame));
+            assertTrue(checkFrameEquals(frame, exchange.request));
+        } else {
+            assertFalse(sequence.receive(&frame));
+        }
+        clock.delay(SETTINGS_RESPONSE_TIMEOUT / 2);
+        sequence.send(exchange.response);
+    }
+    assertTrue(sequence.ready());
+    assertFalse(sequence.failed());
+    assertEqual(sequence.duration(), (uint32_t)(5 * (SETTINGS_RESPONSE_TIMEOUT / 2)));
+    assertEqual(sequence.latency(REQUEST_READ).retries, 0);
+}
+
+testF(SettingsSequenceTest, FailureSendsExit) {
+    Frame frame;
+    Frame exit = REQ_E(0x02, 0x10, 0x81, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+    Frame exit_response = RESP_E(0x02, 0x50, 0x81, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+    Frame enter_response = RESP_E(0x02, 0x50, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+
+    SettingsSequence sequence(SETTINGS_FRAME_E, &timers);
+    assertTrue(sequence.queue(0x10, 0x01));
+    assertTrue(sequence.trigger(kSettingsUpdate));
+    assertTrue(sequence.receive(&frame));
+    sequence.send(enter_response);
+
+    // Update request is never answered.
+    for (uint8_t i = 0; i <= SETTINGS_RESPONSE_RETRIES; i++) {
+        assertTrue(sequence.receive(&frame));
+        assertEqual(frame.data[1], 0x3B);
+        clock.delay(SETTINGS_RESPONSE_TIMEOUT);
+    }
+
+    // Exit is sent in place of the remaining steps.
+    assertTrue(sequence.receive(&frame));
+    assertTrue(checkFrameEquals(frame, exit));
+    assertTrue(sequence.failed());
+    assertFalse(sequence.ready());
+    sequence.send(exit_response);
+    assertTrue(sequence.ready());
+    assertTrue(sequence.failed());
+
+    assertEqual(sequence.latency(REQUEST_WRITE).retries, SETTINGS_RESPONSE_RETRIES);
+    assertEqual(sequence.latency(REQUEST_WRITE).failures, 1);
+}
+
+testF(SettingsSequenceTest, Timeout) {
+    Frame frame;
+    SettingsSequence sequence(SETTINGS_FRAME_E, &timers);
+    assertTrue(sequence.trigger(kSettingsRetrieve));
+
+    // Enter fails and then exit fails.
+    for (uint8_t i = 0; i <= SETTINGS_RESPONSE_RETRIES; i++) {
+        assertTrue(sequence.receive(&frame));
+        assertEqual(frame.data[2], 0xC0);
+        clock.delay(SETTINGS_RESPONSE_TIMEOUT);
+    }
+    for (uint8_t i = 0; i <= SETTINGS_RESPONSE_RETRIES; i++) {
+        assertTrue(sequence.receive(&frame));
+        assertEqual(frame.data[2], 0x81);
+        clock.delay(SETTINGS_RESPONSE_TIMEOUT);
+    }
+    assertFalse(sequence.receive(&frame));
+    assertTrue(sequence.ready());
+    assertTrue(sequence.failed());
+    assertEqual(sequence.latency(REQUEST_SESSION).failures, 2);
+
+    // A new session may be started.
+    assertTrue(sequence.trigger(kSettingsRetrieve));
+    assertFalse(sequence.failed());
+}
+
 #endif  // __R51_TESTS_TEST_SETTINGS__
@@ -0,0 +1,142 @@
+#ifndef __R51_TESTS_TEST_SLCAN__
+#define __R51_TESTS_TEST_SLCAN__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_broadcast.h"
+#include "mock_clock.h"
+#include "mock_stream.h"
+#include "src/bus.h"
+#include "src/slcan.h"
+
+using namespace aunit;
+
+
+class SlcanTest : public TestOnce {
+    protected:
+        MockClock clock;
+        TimerWheel timers;
+        Slcan slcan;
+        FakeStream stream;
+        MockBroadcast cb;
+        char output[128];
+
+        SlcanTest() : timers(&clock), slcan(&timers), cb(4) {}
+
+        void setup() override {
+            clearOutput();
+            slcan.begin(&stream);
+        }
+
+        void clearOutput() {
+            memset(output, 0, sizeof(output));
+            stream.set((byte*)output, sizeof(output) - 1);
+        }
+
+        // Write input to the node and run a receive.
+        void input(const char* data) {
+            stream.setRead((byte*)data, strlen(data));
+            slcan.receive(cb.impl);
+        }
+
+        // Return true if the output matches and clear the output.
+        bool expectOutput(const char* expect) {
+            bool match = strcmp(output, expect) == 0;
+            clearOutput();
+            return match;
+        }
+};
+
+testF(SlcanTest, OpenClose) {
+    assertFalse(slcan.open());
+    input("V\rN\rS6\rO\r");
+    assertTrue(slcan.open());
+    assertTrue(expectOutput("V1013\rNR051\r\r\r"));
+
+    // Opening twice is an error.
+    input("O\r");
+    assertTrue(expectOutput("\a"));
+
+    input("C\r");
+    assertFalse(slcan.open());
+    assertTrue(expectOutput("\r"));
+}
+
+testF(SlcanTest, ReceiveFrames) {
+    // Frames are rejected while closed.
+    input("t1232AABB\r");
+    assertEqual(cb.count(), 0);
+    assertTrue(expectOutput("\a"));
+
+    input("O\rt1232AABB\rT00005400100\r");
+    assertTrue(expectOutput("\rz\rZ\r"));
+    assertEqual(cb.count(), 2);
+    Frame expect = {0x123, 2, {0xAA, 0xBB}};
+    assertTrue(frameEquals(cb.frames()[0], expect));
+    expect = {0x5400, 1, {}};
+    assertTrue(frameEquals(cb.frames()[1], expect));
+}
+
+testF(SlcanTest, ReceiveInvalid) {
+    input("O\r");
+    assertTrue(expectOutput("\r"));
+    input("t1232AA\rt12\rt1239\rT1231AA\rt12G0\rx\r");
+    assertEqual(cb.count(), 0);
+    assertTrue(expectOutput("\a\a\a\a\a\a"));
+
+    // Commands which overflow the buffer are dropped.
+    input("t12380011223344556677889900112233\r");
+    assertEqual(cb.count(), 0);
+    assertEqual(slcan.dropped(), (uint32_t)1);
+    assertTrue(expectOutput("\a"));
+}
+
+testF(SlcanTest, ListenOnly) {
+    input("L\rt1230\r");
+    assertTrue(slcan.open());
+    assertEqual(cb.count(), 0);
+    assertTrue(expectOutput("\r\a"));
+
+    Frame frame = {0x540, 1, {0x60}};
+    slcan.send(frame);
+    assertTrue(expectOutput("t540160\r"));
+}
+
+testF(SlcanTest, SendFrames) {
+    // Frames are not written while closed.
+    Frame frame = {0x540, 2, {0x60, 0x80}};
+    slcan.send(frame);
+    assertTrue(expectOutput(""));
+
+    input("O\r");
+    assertTrue(expectOutput("\r"));
+    slcan.send(frame);
+    assertTrue(expectOutput("t54026080\r"));
+
+    frame = {0x5400, 0, {}};
+    slcan.send(frame);
+    assertTrue(expectOutput("T000054000\r"));
+
+    frame = {0x5F00, 16, {}};
+    slcan.send(frame);
+    assertTrue(expectOutput(""));
+}
+
+testF(SlcanTest, Timestamps) {
+    input("O\rZ1\r");
+    assertTrue(expectOutput("\r\r"));
+
+    clock.set(61234);
+    timers.update();
+    Frame frame = {0x540, 1, {0x60}};
+    slcan.send(frame);
+    assertTrue(expectOutput("t54016004D2\r"));
+
+    input("Z0\r");
+    assertTrue(expectOutput("\r"));
+    slcan.send(frame);
+    assertTrue(expectOutput("t540160\r"));
+}
+
+#endif  // __R51_TESTS_TEST_SLCAN__
@@ -0,0 +1,149 @@
+#ifndef __R51_TESTS_TEST_SNAPSHOT__
+#define __R51_TESTS_TEST_SNAPSHOT__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_broadcast.h"
+#include "mock_clock.h"
+#include "mock_storage.h"
+#include "src/bus.h"
+#include "src/config.h"
+#include "src/snapshot.h"
+#include "testing.h"
+
+using namespace aunit;
+
+
+test(SnapshotTest, Empty) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockStorage storage;
+    MockBroadcast cast(2);
+
+    Snapshot snapshot(&timers, &storage);
+    snapshot.begin();
+    snapshot.receive(cast.impl);
+    assertTrue(checkFrameCount(cast, 0));
+
+    clock.delay(SNAPSHOT_STALE_HB);
+    snapshot.receive(cast.impl);
+    assertTrue(checkFrameCount(cast, 0));
+}
+
+test(SnapshotTest, PersistAndRestore) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockStorage storage;
+    MockBroadcast cast(2);
+
+    Frame climate = {CLIMATE_STATE_FRAME_ID, 8, {0x27, 0x03, 0x49, 0x49, 0x00, 0x00, 0x00, 0x2C}};
+    Frame settings = {SETTINGS_STATE_FRAME_ID, 8, {0x05, 0x20, 0x11, 0x04, 0x00, 0x00, 0x00, 0x00}};
+    Frame stale_climate = {CLIMATE_STATE_FRAME_ID, 8, {0x27, 0x03, 0x49, 0x49, 0x00, 0x00, 0x80, 0x2C}};
+    Frame stale_settings = {SETTINGS_STATE_FRAME_ID, 8, {0x05, 0x20, 0x11, 0x04, 0x00, 0x00, 0x80, 0x00}};
+
+    // Record live frames and flush after the write interval.
+    Snapshot first(&timers, &storage);
+    first.begin();
+    first.send(climate);
+    first.send(settings);
+    first.receive(cast.impl);
+    assertEqual(storage.writes(), (uint32_t)0);
+    clock.delay(SNAPSHOT_WRITE_INTERVAL);
+    first.receive(cast.impl);
+    assertTrue(checkFrameCount(cast, 0));
+    assertMore(storage.writes(), (uint32_t)0);
+
+    // Restore the frames in a new instance.
+    Snapshot second(&timers, &storage);
+    second.begin();
+    second.receive(cast.impl);
+    assertTrue(checkFrameCount(cast, 2) &&
+        checkFrameEquals(cast.frames()[0], stale_climate) &&
+        checkFrameEquals(cast.frames()[1], stale_settings));
+    cast.reset();
+
+    // Stale frames are ignored when sent back to the node.
+    second.send(stale_climate);
+    clock.delay(SNAPSHOT_STALE_HB);
+    second.receive(cast.impl);
+    assertTrue(checkFrameCount(cast, 2));
+    cast.reset();
+
+    // Live frames replace the stale frames.
+    second.send(climate);
+    clock.delay(SNAPSHOT_STALE_HB);
+    second.receive(cast.impl);
+    assertTrue(checkFrameCount(cast, 1) &&
+        checkFrameEquals(cast.frames()[0], stale_settings));
+    cast.reset();
+
+    second.send(settings);
+    clock.delay(SNAPSHOT_STALE_HB);
+    second.receive(cast.impl);
+    assertTrue(checkFrameCount(cast, 0));
+}
+
+test(SnapshotTest, WriteOnlyOnChange) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockStorage storage;
+    MockBroadcast cast(2);
+
+    Frame climate = {CLIMATE_STATE_FRAME_ID, 8, {0x27, 0x03, 0x49, 0x49, 0x00, 0x00, 0x00, 0x2C}};
+
+    Snapshot snapshot(&timers, &storage);
+    snapshot.begin();
+    clock.delay(SNAPSHOT_WRITE_INTERVAL);
+    snapshot.send(climate);
+    snapshot.receive(cast.impl);
+    uint32_t writes = storage.writes();
+    assertMore(writes, (uint32_t)0);
+
+    // Changed frames are not written before the interval expires.
+    climate.data[7] = 0x2D;
+    snapshot.send(climate);
+    clock.delay(SNAPSHOT_WRITE_INTERVAL - 1);
+    snapshot.receive(cast.impl);
+    assertEqual(storage.writes(), writes);
+
+    // Only the changed byte and checksum are written.
+    clock.delay(1);
+    snapshot.receive(cast.impl);
+    assertEqual(storage.writes(), writes + 2);
+
+    // Unchanged frames are not written.
+    snapshot.send(climate);
+    clock.delay(SNAPSHOT_WRITE_INTERVAL);
+    snapshot.receive(cast.impl);
+    assertEqual(storage.writes(), writes + 2);
+}
+
+test(SnapshotTest, CorruptSlot) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockStorage storage;
+    MockBroadcast cast(2);
+
+    Frame climate = {CLIMATE_STATE_FRAME_ID, 8, {0x27, 0x03, 0x49, 0x49, 0x00, 0x00, 0x00, 0x2C}};
+
+    Snapshot first(&timers, &storage);
+    first.begin();
+    first.send(climate);
+    clock.delay(SNAPSHOT_WRITE_INTERVAL);
+    first.receive(cast.impl);
+
+    // Corrupt a data byte so the checksum no longer matches.
+    storage.write(SNAPSHOT_STORAGE_OFFSET + 3, 0x00);
+
+    Snapshot second(&timers, &storage);
+    second.begin();
+    second.receive(cast.impl);
+    assertTrue(checkFrameCount(cast, 0));
+}
+
+#endif  // __R51_TESTS_TEST_SNAPSHOT__
@@ -4,9 +4,10 @@
 #include <Arduino.h>
 #include <AUnit.h>
 
+#include "mock_analog.h"
 #include "mock_broadcast.h"
 #include "mock_clock.h"
-#include "mock_gpio.h"
+#include "mock_storage.h"
 #include "src/bus.h"
 #include "src/config.h"
 #include "src/steering.h"
@@ -20,7 +21,9 @@ class SteeringKeypadTest : public TestOnce {
 
         void assertButtonPress(uint32_t pin, uint32_t value, byte expect) {
             MockClock clock;
-            MockGPIO gpio;
+            TimerWheel timers(&clock);
+            clock.attach(&timers);
+            MockAnalogSampler sampler;
             MockBroadcast broadcast(1);
 
             Frame released = {
@@ -35,15 +38,23 @@ class SteeringKeypadTest : public TestOnce {
                 .id = 0x5800,
                 .len = 8,
                 .data = {
-                    expect, 0x00, 0x00, 0x00,
+                    expect, 0x00, 0x01, 0x00,
+                    0x00, 0x00, 0x00, 0x00,
+                },
+            };
+            Frame released_after = {
+                .id = 0x5800,
+                .len = 8,
+                .data = {
+                    0x00, 0x00, 0x01, 0x00,
                     0x00, 0x00, 0x00, 0x00,
                 },
             };
 
             // initialize keypad
-            SteeringKeypad keypad(&clock, &gpio);
-            gpio.analogWrite(STEERING_SWITCH_A_PIN, 1023);
-            gpio.analogWrite(STEERING_SWITCH_B_PIN, 1023);
+            SteeringKeypad keypad(&timers, &sampler);
+            sampler.write(STEERING_SWITCH_A_PIN, 1023);
+            sampler.write(STEERING_SWITCH_B_PIN, 1023);
 
             // receive heartbeat to ensure button not pressed
             clock.delay(501);
@@ -53,7 +64,7 @@ class SteeringKeypadTest : public TestOnce {
             broadcast.reset();
 
             // set analog value, check button, wait for debounce, check button again
-            gpio.analogWrite(pin, value);
+            sampler.write(pin, value);
             keypad.receive(broadcast.impl);
             assertEqual(broadcast.count(), 0);
             clock.delay(100);
@@ -63,13 +74,13 @@ class SteeringKeypadTest : public TestOnce {
             broadcast.reset();
 
             // release the button and advance time past the debounce
-            gpio.analogWrite(pin, 1023);
+            sampler.write(pin, 1023);
             keypad.receive(broadcast.impl);
             assertEqual(broadcast.count(), 0);
             clock.delay(100);
             keypad.receive(broadcast.impl);
             assertEqual(broadcast.count(), 1);
-            assertTrue(frameEquals(broadcast.frames()[0], released));
+            assertTrue(frameEquals(broadcast.frames()[0], released_after));
         }
 };
 
@@ -99,7 +110,9 @@ testF(SteeringKeypadTest, VolumeUp) {
 
 test(SteeringKeypad, Heartbeat) {
     MockClock clock;
-    MockGPIO gpio;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockAnalogSampler sampler;
     MockBroadcast broadcast(1);
 
     Frame expect = {
@@ -111,9 +124,9 @@ test(SteeringKeypad, Heartbeat) {
         },
     };
 
-    SteeringKeypad keypad(&clock, &gpio);
-    gpio.analogWrite(STEERING_SWITCH_A_PIN, 1023);
-    gpio.analogWrite(STEERING_SWITCH_B_PIN, 1023);
+    SteeringKeypad keypad(&timers, &sampler);
+    sampler.write(STEERING_SWITCH_A_PIN, 1023);
+    sampler.write(STEERING_SWITCH_B_PIN, 1023);
 
     clock.delay(501);
     keypad.receive(broadcast.impl);
@@ -127,4 +140,261 @@ test(SteeringKeypad, Heartbeat) {
     assertTrue(frameEquals(broadcast.frames()[0], expect));
 }
 
+test(SteeringKeypad, BackgroundSampling) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockAnalogSampler sampler;
+    MockStorage storage;
+    MockBroadcast broadcast(1);
+
+    SteeringKeypad keypad(&timers, &sampler, &storage);
+    keypad.begin();
+    assertTrue(sampler.started(STEERING_SWITCH_A_PIN));
+    assertTrue(sampler.started(STEERING_SWITCH_B_PIN));
+
+    // The keypad reads sampled values and never blocks on the ADC.
+    keypad.receive(broadcast.impl);
+    clock.delay(100);
+    keypad.receive(broadcast.impl);
+    assertEqual(sampler.reads(), (uint32_t)4);
+    assertEqual(broadcast.count(), 0);
+}
+
+test(SteeringKeypad, LongPressAndRepeat) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockAnalogSampler sampler;
+    MockBroadcast broadcast(1);
+    static constexpr const int values[] = STEERING_SWITCH_VALUES;
+
+    SteeringKeypad keypad(&timers, &sampler);
+    keypad.receive(broadcast.impl);
+    broadcast.reset();
+
+    // Press volume up.
+    sampler.write(STEERING_SWITCH_B_PIN, values[2]);
+    keypad.receive(broadcast.impl);
+    clock.delay(LadderInput::kDefaultDebounce + 1);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[0], 0x04);
+    assertEqual(broadcast.frames()[0].data[1], 0x00);
+    assertEqual(broadcast.frames()[0].data[2], 0x01);
+    assertEqual(broadcast.frames()[0].data[3], 0x00);
+    broadcast.reset();
+
+    // Hold duration is reported in 100ms units.
+    clock.delay(99);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 0);
+    clock.delay(1);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[3], 0x01);
+    broadcast.reset();
+
+    // Repeat begins after the repeat delay.
+    clock.delay(STEERING_SWITCH_REPEAT_DELAY - 100 - 1);
+    keypad.receive(broadcast.impl);
+    broadcast.reset();
+    clock.delay(1);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[2], 0x02);
+    assertEqual(broadcast.frames()[0].data[3], STEERING_SWITCH_REPEAT_DELAY / 100);
+    broadcast.reset();
+
+    clock.delay(STEERING_SWITCH_REPEAT);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[2], 0x03);
+    broadcast.reset();
+
+    // Long press is set after the long press duration.
+    clock.delay(STEERING_SWITCH_LONG_PRESS - STEERING_SWITCH_REPEAT_DELAY - STEERING_SWITCH_REPEAT - 1);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[1], 0x00);
+    broadcast.reset();
+    clock.delay(1);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[0], 0x04);
+    assertEqual(broadcast.frames()[0].data[1], 0x04);
+
+    uint8_t tick = broadcast.frames()[0].data[2];
+    broadcast.reset();
+
+    // Release clears long press and hold duration but keeps the tick.
+    sampler.write(STEERING_SWITCH_B_PIN, 1023);
+    keypad.receive(broadcast.impl);
+    clock.delay(LadderInput::kDefaultDebounce + 1);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[0], 0x00);
+    assertEqual(broadcast.frames()[0].data[1], 0x00);
+    assertEqual(broadcast.frames()[0].data[2], tick);
+    assertEqual(broadcast.frames()[0].data[3], 0x00);
+}
+
+test(SteeringKeypad, Chord) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockAnalogSampler sampler;
+    MockBroadcast broadcast(1);
+    static constexpr const int values[] = STEERING_SWITCH_VALUES;
+
+    SteeringKeypad keypad(&timers, &sampler);
+    keypad.receive(broadcast.impl);
+    broadcast.reset();
+
+    // Hold power and volume up together.
+    sampler.write(STEERING_SWITCH_A_PIN, values[0]);
+    sampler.write(STEERING_SWITCH_B_PIN, values[2]);
+    keypad.receive(broadcast.impl);
+    clock.delay(LadderInput::kDefaultDebounce + 1);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[0], 0x05);
+    assertEqual(broadcast.frames()[0].data[2], 0x02);
+}
+
+// Hold each button in turn for calibration. Readings on both ladders are
+// offset from the default values. The second button on each ladder reads
+// within the default range of the third.
+void calibrateSteeringKeypad(SteeringKeypad* keypad, MockClock* clock,
+        MockAnalogSampler* sampler, const Broadcast& broadcast, Frame* control) {
+    static constexpr const int values[] = STEERING_SWITCH_VALUES;
+    const uint8_t labels_a[] = {0x01, 0x20, 0x08};
+    const uint8_t labels_b[] = {0x02, 0x10, 0x04};
+
+    for (uint8_t i = 0; i <= STEERING_SWITCH_COUNT; i++) {
+        uint16_t value = i == 1 ? 470 : i < STEERING_SWITCH_COUNT ? values[i] + 20 : 900;
+        for (uint8_t j = 0; j < 2; j++) {
+            uint32_t pin = j == 0 ? STEERING_SWITCH_A_PIN : STEERING_SWITCH_B_PIN;
+            control->data[1] = i < STEERING_SWITCH_COUNT ? (j == 0 ? labels_a[i] : labels_b[i]) : 0;
+            keypad->send(*control);
+            sampler->write(STEERING_SWITCH_A_PIN, 900);
+            sampler->write(STEERING_SWITCH_B_PIN, 900);
+            sampler->write(pin, value);
+            for (uint8_t k = 0; k < 100; k++) {
+                keypad->receive(broadcast);
+                clock->delay(5);
+            }
+        }
+    }
+}
+
+test(SteeringKeypad, Calibration) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockAnalogSampler sampler;
+    MockStorage storage;
+    MockBroadcast broadcast(16);
+    Frame control = {STEERING_CALIBRATION_FRAME_ID, 8, {0}};
+
+    SteeringKeypad keypad(&timers, &sampler, &storage);
+    assertTrue(keypad.filter(STEERING_CALIBRATION_FRAME_ID));
+    keypad.begin();
+    sampler.write(STEERING_SWITCH_A_PIN, 900);
+    sampler.write(STEERING_SWITCH_B_PIN, 900);
+    keypad.receive(broadcast.impl);
+    broadcast.reset();
+
+    // Start calibration.
+    control.data[0] = 0x01;
+    keypad.send(control);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[4], 0x01);
+    broadcast.reset();
+
+    // Buttons are not reported while calibrating.
+    calibrateSteeringKeypad(&keypad, &clock, &sampler, broadcast.impl, &control);
+    assertMore(broadcast.count(), 0);
+    assertLessOrEqual(broadcast.count(), 16);
+    for (uint8_t i = 0; i < broadcast.count(); i++) {
+        assertEqual(broadcast.frames()[i].data[0], 0x00);
+    }
+    broadcast.reset();
+
+    // Save calibration.
+    control.data[0] ^= 0x02;
+    keypad.send(control);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[4], 0x02);
+    assertEqual(storage.read(STEERING_CALIBRATION_STORAGE_OFFSET), 0x53);
+    broadcast.reset();
+
+    // The idle threshold moved below the default. A reading which was
+    // previously volume up is now idle.
+    sampler.write(STEERING_SWITCH_B_PIN, 800);
+    keypad.receive(broadcast.impl);
+    clock.delay(100);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 0);
+
+    // A reading which was previously volume up is now seek up.
+    sampler.write(STEERING_SWITCH_B_PIN, 470);
+    keypad.receive(broadcast.impl);
+    clock.delay(100);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[0], 0x10);
+    sampler.write(STEERING_SWITCH_B_PIN, 800);
+    keypad.receive(broadcast.impl);
+    clock.delay(100);
+    keypad.receive(broadcast.impl);
+    broadcast.reset();
+
+    // Calibration is loaded on boot.
+    SteeringKeypad loaded(&timers, &sampler, &storage);
+    loaded.begin();
+    loaded.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[0], 0x00);
+    assertEqual(broadcast.frames()[0].data[4], 0x02);
+    broadcast.reset();
+
+    // Clearing restores the default thresholds.
+    control.data[0] = 0x08;
+    control.data[1] = 0x00;
+    loaded.send(control);
+    loaded.receive(broadcast.impl);
+    clock.delay(100);
+    loaded.receive(broadcast.impl);
+    assertEqual(broadcast.frames()[broadcast.count() - 1].data[0], 0x04);
+    assertEqual(broadcast.frames()[broadcast.count() - 1].data[4], 0x00);
+    assertNotEqual(storage.read(STEERING_CALIBRATION_STORAGE_OFFSET), 0x53);
+}
+
+test(SteeringKeypad, CalibrationFailure) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    clock.attach(&timers);
+    MockAnalogSampler sampler;
+    MockStorage storage;
+    MockBroadcast broadcast(1);
+    Frame control = {STEERING_CALIBRATION_FRAME_ID, 8, {0x01}};
+
+    SteeringKeypad keypad(&timers, &sampler, &storage);
+    keypad.begin();
+    keypad.send(control);
+    keypad.receive(broadcast.impl);
+    broadcast.reset();
+
+    // Save without recording any buttons.
+    control.data[0] ^= 0x02;
+    keypad.send(control);
+    keypad.receive(broadcast.impl);
+    assertEqual(broadcast.count(), 1);
+    assertEqual(broadcast.frames()[0].data[4], 0x04);
+    assertEqual(storage.writes(), (uint32_t)0);
+}
+
 #endif  // __R51_TESTS_TEST_STEERING__
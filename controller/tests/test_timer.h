@@ -0,0 +1,180 @@
+#ifndef __R51_TESTS_TEST_TIMER__
+#define __R51_TESTS_TEST_TIMER__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_analog.h"
+#include "mock_clock.h"
+#include "mock_gpio.h"
+#include "mock_storage.h"
+#include "src/bus.h"
+#include "src/climate.h"
+#include "src/settings.h"
+#include "src/snapshot.h"
+#include "src/steering.h"
+#include "src/timer.h"
+
+using namespace aunit;
+
+
+test(TimerWheelTest, OneShot) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    Timer timer;
+
+    timers.start(&timer, 100);
+    assertTrue(timer.active());
+    clock.delay(99);
+    assertEqual(timers.update(), 0);
+    assertFalse(timer.expired());
+
+    clock.delay(1);
+    assertEqual(timers.update(), 1);
+    assertFalse(timer.active());
+    assertTrue(timer.expired());
+    assertFalse(timer.expired());
+
+    clock.delay(100);
+    assertEqual(timers.update(), 0);
+    assertFalse(timer.expired());
+}
+
+test(TimerWheelTest, Periodic) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    Timer timer;
+
+    timers.startPeriodic(&timer, 10);
+    for (uint8_t i = 0; i < 5; i++) {
+        clock.delay(9);
+        timers.update();
+        assertFalse(timer.expired());
+        clock.delay(1);
+        timers.update();
+        assertTrue(timer.expired());
+        assertTrue(timer.active());
+    }
+
+    // Missed periods do not expire in a burst.
+    clock.delay(35);
+    assertEqual(timers.update(), 1);
+    assertTrue(timer.expired());
+    clock.delay(9);
+    assertEqual(timers.update(), 0);
+    clock.delay(1);
+    assertEqual(timers.update(), 1);
+}
+
+test(TimerWheelTest, RestartAndStop) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    Timer timer;
+
+    timers.start(&timer, 50);
+    clock.delay(40);
+    timers.update();
+    timers.start(&timer, 50);
+    clock.delay(40);
+    timers.update();
+    assertFalse(timer.expired());
+    clock.delay(10);
+    timers.update();
+    assertTrue(timer.expired());
+
+    timers.start(&timer, 50);
+    timers.stop(&timer);
+    assertFalse(timer.active());
+    clock.delay(100);
+    assertEqual(timers.update(), 0);
+    assertFalse(timer.expired());
+}
+
+test(TimerWheelTest, SharedSlots) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    Timer near;
+    Timer far;
+    Timer zero;
+
+    // Deadlines more than a rotation apart share a slot.
+    timers.start(&near, 5);
+    timers.start(&far, 5 + TimerWheel::kSlots * 3);
+    timers.start(&zero, 0);
+
+    timers.update();
+    assertTrue(zero.expired());
+
+    clock.delay(5);
+    assertEqual(timers.update(), 1);
+    assertTrue(near.expired());
+    assertTrue(far.active());
+
+    clock.delay(TimerWheel::kSlots * 3 - 1);
+    assertEqual(timers.update(), 0);
+    clock.delay(1);
+    assertEqual(timers.update(), 1);
+    assertTrue(far.expired());
+}
+
+test(TimerWheelTest, LongGap) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+    Timer group[4];
+
+    for (uint8_t i = 0; i < 4; i++) {
+        timers.start(&group[i], 10 + i * 17);
+    }
+    clock.delay(1000);
+    assertEqual(timers.update(), 4);
+    for (uint8_t i = 0; i < 4; i++) {
+        assertTrue(group[i].expired());
+    }
+}
+
+test(TimerWheelTest, ClockReadsPerLoop) {
+    MockClock clock;
+    MockGPIO gpio;
+    MockAnalogSampler sampler;
+    MockStorage storage;
+    TimerWheel timers(&clock);
+
+    Climate climate(&timers, &gpio);
+    Settings settings(&timers);
+    Snapshot snapshot(&timers, &storage);
+    SteeringKeypad keypad(&timers, &sampler, &storage);
+    Node* nodes[] = {&climate, &settings, &snapshot, &keypad};
+    Bus bus(nodes, 4, &timers);
+
+    // Nodes share the single clock read made by the timer wheel. Includes the
+    // settings transports while a session is running.
+    settings.init();
+    for (uint32_t i = 1; i <= 100; i++) {
+        bus.loop();
+        clock.delay(7);
+        assertEqual(clock.reads(), i);
+    }
+}
+
+test(TimerWheelTest, Tick) {
+    MockClock clock;
+    TimerWheel timers(&clock);
+
+    clock.delay(3);
+    clock.delayMicros(1500);
+    assertEqual(timers.now(), (uint32_t)0);
+    assertEqual(timers.micros(), (uint32_t)0);
+
+    // The tick changes only on update.
+    timers.update();
+    assertEqual(clock.reads(), (uint32_t)1);
+    assertEqual(timers.now(), (uint32_t)4);
+    assertEqual(timers.micros(), (uint32_t)4500);
+    clock.delayMicros(500);
+    assertEqual(timers.now(), (uint32_t)4);
+    timers.update();
+    assertEqual(timers.tick().millis, (uint32_t)5);
+    assertEqual(timers.tick().micros, (uint32_t)5000);
+}
+
+#endif  // __R51_TESTS_TEST_TIMER__
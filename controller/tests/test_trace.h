@@ -0,0 +1,80 @@
+#ifndef __R51_TESTS_TEST_TRACE__
+#define __R51_TESTS_TEST_TRACE__
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+#include "mock_clock.h"
+#include "mock_stream.h"
+#include "src/trace.h"
+
+using namespace aunit;
+
+
+test(TraceTest, Id) {
+    static_assert(traceId("a") == 0xE40C292C, "trace id must be FNV-1a");
+    assertEqual(traceId(""), (uint32_t)0x811C9DC5);
+    assertEqual(traceId(nullptr), (uint32_t)0);
+}
+
+test(TraceTest, Value) {
+    uint8_t buffer[64];
+    LogRing ring(buffer, sizeof(buffer));
+    MockClock clock;
+    clock.delayMicros(0x123456);
+    Trace trace(&ring, &clock);
+
+    byte actual[32];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set(actual, sizeof(actual));
+
+    assertTrue(trace.value(LOG_SETTINGS, LOG_LEVEL_ERROR, 0x11223344, 0xAABB, HEX));
+    byte expect[] = {
+        0xA5, 14,
+        0x44, 0x33, 0x22, 0x11,
+        0x56, 0x34, 0x12, 0x00,
+        0x51,
+        0x10, 0xBB, 0xAA, 0x00, 0x00,
+    };
+    assertEqual(ring.drain(&stream), sizeof(expect));
+    assertEqual(memcmp(actual, expect, sizeof(expect)), 0);
+}
+
+test(TraceTest, Frame) {
+    uint8_t buffer[64];
+    LogRing ring(buffer, sizeof(buffer));
+    MockClock clock;
+    Trace trace(&ring, &clock);
+
+    byte actual[32];
+    memset(actual, 0, sizeof(actual));
+    FakeWriteStream stream;
+    stream.set(actual, sizeof(actual));
+
+    Frame frame = {0x54A, 2, {0x01, 0x02}};
+    assertTrue(trace.frame(LOG_CLIMATE, LOG_LEVEL_INFO, 0x01020304, frame));
+    byte expect[] = {
+        0xA5, 17,
+        0x04, 0x03, 0x02, 0x01,
+        0x00, 0x00, 0x00, 0x00,
+        0x40,
+        0xF0, 0x4A, 0x05, 0x00, 0x00, 0x02, 0x01, 0x02,
+    };
+    assertEqual(ring.drain(&stream), sizeof(expect));
+    assertEqual(memcmp(actual, expect, sizeof(expect)), 0);
+}
+
+test(TraceTest, Dropped) {
+    uint8_t buffer[16];
+    LogRing ring(buffer, sizeof(buffer));
+    MockClock clock;
+    Trace trace(&ring, &clock);
+
+    assertTrue(trace.message(LOG_SYSTEM, LOG_LEVEL_INFO, 1));
+    assertFalse(trace.message(LOG_SYSTEM, LOG_LEVEL_INFO, 2));
+    assertEqual(ring.available(), 1u);
+    assertEqual(ring.dropped(), 1u);
+}
+
+#endif  // __R51_TESTS_TEST_TRACE__
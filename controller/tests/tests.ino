@@ -2,12 +2,28 @@
 #include <AUnit.h>
 
 #include "test_bus.h"
+#include "test_calibration.h"
+#include "test_candump.h"
 #include "test_climate_control.h"
 #include "test_climate_state.h"
+#include "test_diagnostics.h"
+#include "test_id_table.h"
+#include "test_isotp.h"
+#include "test_ladder.h"
+#include "test_log.h"
+#include "test_loop_monitor.h"
+#include "test_memory.h"
 #include "test_momentary_output.h"
+#include "test_profiler.h"
 #include "test_realdash.h"
+#include "test_recorder.h"
+#include "test_serial.h"
 #include "test_settings.h"
+#include "test_slcan.h"
+#include "test_snapshot.h"
 #include "test_steering.h"
+#include "test_timer.h"
+#include "test_trace.h"
 
 using namespace aunit;
 
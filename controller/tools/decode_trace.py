@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Decode binary trace records written by a TRACE_ENABLE build.
+
+The string table is rebuilt by hashing every message passed to the debug and
+trace macros in the controller source with the same FNV-1a hash used by
+traceId(). Records are read from a capture file or stdin. Bytes outside of
+records, such as log ring drop reports, are passed through as text.
+
+Usage:
+    decode_trace.py [--src DIR] [CAPTURE]
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+SYNC = 0xA5
+HEADER_LEN = 9
+ARG_FRAME = 0xF0
+LEVELS = {0: "INFO", 1: "ERROR"}
+MODULES = ["system", "can", "realdash", "serial", "climate", "settings",
+           "steering"]
+
+MACRO_RE = re.compile(
+    r'\b(?:INFO|ERROR|TRACE)_(?:MSG|FRAME)\w*\(\s*(?:LOG_LEVEL_\w+\s*,\s*)?'
+    r'"((?:[^"\\]|\\.)*)"')
+WAIT_RE = re.compile(r'\bWAIT_FOR_SERIAL\([^,]+,[^,]+,\s*"((?:[^"\\]|\\.)*)"')
+
+
+def trace_id(msg):
+    h = 0x811C9DC5
+    for b in msg.encode():
+        h = ((h ^ b) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def load_strings(src):
+    table = {}
+    for root, _, files in os.walk(src):
+        for name in files:
+            if not name.endswith((".h", ".cpp", ".ino")):
+                continue
+            with open(os.path.join(root, name)) as f:
+                text = f.read()
+            matches = list(MACRO_RE.finditer(text)) + list(WAIT_RE.finditer(text))
+            for match in matches:
+                msg = bytes(match.group(1), "utf-8").decode("unicode_escape")
+                msg_id = trace_id(msg)
+                if msg_id in table and table[msg_id] != msg:
+                    print("warning: trace id collision: %r and %r" %
+                          (table[msg_id], msg), file=sys.stderr)
+                table[msg_id] = msg
+    return table
+
+
+def format_arg(arg):
+    if not arg:
+        return ""
+    kind = arg[0]
+    if kind == ARG_FRAME and len(arg) >= 6:
+        frame_id, length = struct.unpack_from("<IB", arg, 1)
+        data = arg[6:6 + length]
+        return "%X#%s" % (frame_id, ":".join("%02X" % b for b in data))
+    if len(arg) == 5:
+        (value,) = struct.unpack_from("<I", arg, 1)
+        if kind == 16:
+            return "%X" % value
+        if kind == 8:
+            return "%o" % value
+        if kind == 2:
+            return "{:b}".format(value)
+        return str(struct.unpack("<i", struct.pack("<I", value))[0])
+    return "<invalid argument %s>" % arg.hex()
+
+
+def decode(data, table, out):
+    text = bytearray()
+    i = 0
+    while i < len(data):
+        if data[i] != SYNC or i + 2 > len(data) or data[i + 1] < HEADER_LEN:
+            text.append(data[i])
+            i += 1
+            continue
+        end = i + 2 + data[i + 1]
+        if end > len(data):
+            break
+        if text:
+            out.write(text.decode(errors="replace"))
+            text.clear()
+        msg_id, micros, flags = struct.unpack_from("<IIB", data, i + 2)
+        msg = table.get(msg_id, "<unknown %08X>" % msg_id)
+        level = flags & 0x0F
+        module = flags >> 4
+        out.write("%10.6f [%s] %-8s %s%s\n" % (
+            micros / 1e6, LEVELS.get(level, level),
+            MODULES[module] if module < len(MODULES) else module, msg,
+            format_arg(data[i + 2 + HEADER_LEN:end])))
+        i = end
+    if text:
+        out.write(text.decode(errors="replace"))
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--src", default=os.path.dirname(here),
+                        help="controller source directory")
+    parser.add_argument("capture", nargs="?", help="capture file, default stdin")
+    args = parser.parse_args()
+
+    table = load_strings(args.src)
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    decode(data, table, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()